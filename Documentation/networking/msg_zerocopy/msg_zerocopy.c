@@ -0,0 +1,339 @@
+/*
+ * Send a stream of buffers with and without MSG_ZEROCOPY and report
+ * throughput, CPU time and completion notifications.
+ *
+ * Start a receiver with -r, then a sender pointing at it:
+ *
+ *	msg_zerocopy -r [-4|-6] [-t tcp|udp] [-p port]
+ *	msg_zerocopy [-4|-6] [-t tcp|udp] [-p port] [-z] [-s size] [-l secs] host
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <linux/errqueue.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY		60
+#endif
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY		5
+#define SO_EE_CODE_ZEROCOPY_COPIED	1
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY		0x4000000
+#endif
+
+static int cfg_family = AF_INET;
+static int cfg_type = SOCK_STREAM;
+static int cfg_receiver;
+static int cfg_zerocopy;
+static int cfg_size = 65536;
+static int cfg_secs = 5;
+static const char *cfg_port = "8000";
+static const char *cfg_host;
+
+static unsigned long sends, completions, copied_completions;
+static unsigned long long bytes;
+static unsigned int next_completion;
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double cpu_secs(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+	       ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+static struct addrinfo *resolve(const char *host, int passive)
+{
+	struct addrinfo hints, *res;
+	int err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = cfg_family;
+	hints.ai_socktype = cfg_type;
+	hints.ai_flags = passive ? AI_PASSIVE : 0;
+
+	err = getaddrinfo(host, cfg_port, &hints, &res);
+	if (err) {
+		fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(err));
+		exit(1);
+	}
+	return res;
+}
+
+/* Read all queued completions, returns the number of sends they cover */
+static int read_completions(int fd)
+{
+	char control[128];
+	struct sock_extended_err *serr;
+	struct msghdr msg;
+	struct cmsghdr *cm;
+	unsigned int lo, hi;
+	int n = 0;
+
+	for (;;) {
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+			if (errno == EAGAIN)
+				return n;
+			die("recvmsg errqueue");
+		}
+
+		cm = CMSG_FIRSTHDR(&msg);
+		if (!cm) {
+			fprintf(stderr, "errqueue: no cmsg\n");
+			exit(1);
+		}
+		serr = (struct sock_extended_err *)CMSG_DATA(cm);
+		if (serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY ||
+		    serr->ee_errno) {
+			fprintf(stderr, "errqueue: origin %u errno %u\n",
+				serr->ee_origin, serr->ee_errno);
+			exit(1);
+		}
+
+		lo = serr->ee_info;
+		hi = serr->ee_data;
+		if (lo != next_completion)
+			fprintf(stderr, "completion gap: expected %u got %u\n",
+				next_completion, lo);
+		next_completion = hi + 1;
+
+		completions += hi - lo + 1;
+		if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+			copied_completions += hi - lo + 1;
+		n += hi - lo + 1;
+	}
+}
+
+static void do_sender(void)
+{
+	struct addrinfo *ai = resolve(cfg_host, 0);
+	int flags = cfg_zerocopy ? MSG_ZEROCOPY : 0;
+	double start, end, cpu;
+	struct pollfd pfd;
+	char *buf;
+	int fd, one = 1;
+
+	fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+	if (fd < 0)
+		die("socket");
+	if (cfg_zerocopy &&
+	    setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)))
+		die("setsockopt SO_ZEROCOPY");
+	if (connect(fd, ai->ai_addr, ai->ai_addrlen))
+		die("connect");
+	freeaddrinfo(ai);
+
+	buf = malloc(cfg_size);
+	if (!buf)
+		die("malloc");
+	memset(buf, 'a', cfg_size);
+
+	pfd.fd = fd;
+	pfd.events = 0;
+
+	cpu = cpu_secs();
+	start = now();
+	end = start + cfg_secs;
+
+	while (now() < end) {
+		int ret = send(fd, buf, cfg_size, flags);
+
+		if (ret < 0) {
+			/* too many outstanding sends: wait for completions */
+			if (errno == ENOBUFS && cfg_zerocopy) {
+				poll(&pfd, 1, 100);
+				read_completions(fd);
+				continue;
+			}
+			if (errno == ECONNREFUSED)
+				continue;
+			die("send");
+		}
+		bytes += ret;
+		sends++;
+
+		if (cfg_zerocopy)
+			read_completions(fd);
+	}
+
+	/* wait for the stragglers */
+	while (cfg_zerocopy && completions < sends) {
+		if (poll(&pfd, 1, 1000) != 1) {
+			fprintf(stderr, "timed out waiting for completions\n");
+			break;
+		}
+		read_completions(fd);
+	}
+
+	end = now() - start;
+	cpu = cpu_secs() - cpu;
+
+	printf("%s %s: %lu sends of %d bytes, %.1f MB/s, cpu %.2fs (%.1f%%)\n",
+	       cfg_type == SOCK_STREAM ? "tcp" : "udp",
+	       cfg_zerocopy ? "zerocopy" : "copy", sends, cfg_size,
+	       bytes / end / 1e6, cpu, 100.0 * cpu / end);
+	if (cfg_zerocopy)
+		printf("completions %lu, copied %lu\n",
+		       completions, copied_completions);
+
+	close(fd);
+	free(buf);
+}
+
+static void do_receiver(void)
+{
+	struct addrinfo *ai = resolve(NULL, 1);
+	double start = 0, last;
+	char *buf;
+	int fd, one = 1;
+	ssize_t ret;
+
+	fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+	if (fd < 0)
+		die("socket");
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+		die("setsockopt SO_REUSEADDR");
+	if (bind(fd, ai->ai_addr, ai->ai_addrlen))
+		die("bind");
+	freeaddrinfo(ai);
+
+	if (cfg_type == SOCK_STREAM) {
+		int lfd = fd;
+
+		if (listen(lfd, 1))
+			die("listen");
+		fd = accept(lfd, NULL, NULL);
+		if (fd < 0)
+			die("accept");
+		close(lfd);
+	}
+
+	buf = malloc(1 << 16);
+	if (!buf)
+		die("malloc");
+
+	last = now();
+	for (;;) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		/* udp has no end of stream: stop after a second of silence */
+		if (poll(&pfd, 1, bytes ? 1000 : -1) != 1)
+			break;
+		ret = recv(fd, buf, 1 << 16, 0);
+		if (ret < 0)
+			die("recv");
+		if (!ret)
+			break;
+		if (!bytes)
+			start = now();
+		bytes += ret;
+		last = now();
+	}
+
+	if (bytes && last > start)
+		printf("received %llu bytes, %.1f MB/s\n",
+		       bytes, bytes / (last - start) / 1e6);
+	close(fd);
+	free(buf);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-4|-6] [-t tcp|udp] [-p port] "
+		"(-r | [-z] [-s size] [-l secs] host)\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "46rzt:s:l:p:")) != -1) {
+		switch (c) {
+		case '4':
+			cfg_family = AF_INET;
+			break;
+		case '6':
+			cfg_family = AF_INET6;
+			break;
+		case 'r':
+			cfg_receiver = 1;
+			break;
+		case 'z':
+			cfg_zerocopy = 1;
+			break;
+		case 't':
+			if (!strcmp(optarg, "tcp"))
+				cfg_type = SOCK_STREAM;
+			else if (!strcmp(optarg, "udp"))
+				cfg_type = SOCK_DGRAM;
+			else
+				usage(argv[0]);
+			break;
+		case 's':
+			cfg_size = atoi(optarg);
+			break;
+		case 'l':
+			cfg_secs = atoi(optarg);
+			break;
+		case 'p':
+			cfg_port = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (cfg_size <= 0 || cfg_size > (1 << 24))
+		usage(argv[0]);
+
+	if (cfg_receiver) {
+		do_receiver();
+	} else {
+		if (optind != argc - 1)
+			usage(argv[0]);
+		cfg_host = argv[optind];
+		do_sender();
+	}
+	return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * vdso_bench.c: Compare the cost of reading the clocks through the vDSO
+ * and through the system calls.
+ * Subject to the GNU General Public License, version 2
+ *
+ * Build statically so the binary can be copied into any root filesystem,
+ * for example one booted under qemu-system-arm:
+ *
+ * arm-linux-gnueabi-gcc -std=gnu99 -O2 -static \
+ *     vdso_bench.c parse_vdso.c -o vdso_bench
+ *
+ * and run it as "vdso_bench [iterations]".  qemu user mode emulation
+ * does not map the guest kernel's vDSO, so a full system emulation is
+ * needed to see it.  On a kernel without a vDSO only the syscall rows
+ * are printed, which gives the "before" numbers.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+
+extern void *vdso_sym(const char *version, const char *name);
+extern void vdso_init_from_auxv(void *auxv);
+
+#ifndef CLOCK_REALTIME_COARSE
+#define CLOCK_REALTIME_COARSE	5
+#endif
+
+#ifndef CLOCK_MONOTONIC_COARSE
+#define CLOCK_MONOTONIC_COARSE	6
+#endif
+
+typedef long (*vdso_gettime_t)(clockid_t clk, struct timespec *ts);
+typedef long (*vdso_gtod_t)(struct timeval *tv, struct timezone *tz);
+
+static vdso_gettime_t vdso_gettime;
+static vdso_gtod_t vdso_gtod;
+
+static const struct {
+	clockid_t id;
+	const char *name;
+} clocks[] = {
+	{ CLOCK_REALTIME,		"CLOCK_REALTIME" },
+	{ CLOCK_MONOTONIC,		"CLOCK_MONOTONIC" },
+	{ CLOCK_REALTIME_COARSE,	"CLOCK_REALTIME_COARSE" },
+	{ CLOCK_MONOTONIC_COARSE,	"CLOCK_MONOTONIC_COARSE" },
+};
+
+/* Always time the runs with the syscall, so both sides use one clock. */
+static double now(void)
+{
+	struct timespec ts;
+
+	syscall(__NR_clock_gettime, CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *how, const char *what, unsigned long loops,
+		   double start, long ret)
+{
+	double secs = now() - start;
+
+	if (ret) {
+		printf("%-8s %-24s failed: %ld\n", how, what, ret);
+		return;
+	}
+
+	printf("%-8s %-24s %12.0f calls/sec %8.1f ns/call\n", how, what,
+	       loops / secs, secs * 1e9 / loops);
+}
+
+static void bench_clock_gettime(clockid_t clk, const char *name,
+				unsigned long loops)
+{
+	struct timespec ts;
+	unsigned long i;
+	double start;
+	long ret = 0;
+
+	start = now();
+	for (i = 0; i < loops && !ret; i++)
+		ret = syscall(__NR_clock_gettime, clk, &ts);
+	report("syscall", name, loops, start, ret);
+
+	if (!vdso_gettime)
+		return;
+
+	start = now();
+	for (i = 0; i < loops && !ret; i++)
+		ret = vdso_gettime(clk, &ts);
+	report("vdso", name, loops, start, ret);
+}
+
+static void bench_gettimeofday(unsigned long loops)
+{
+	struct timeval tv;
+	unsigned long i;
+	double start;
+	long ret = 0;
+
+	start = now();
+	for (i = 0; i < loops && !ret; i++)
+		ret = syscall(__NR_gettimeofday, &tv, NULL);
+	report("syscall", "gettimeofday", loops, start, ret);
+
+	if (!vdso_gtod)
+		return;
+
+	start = now();
+	for (i = 0; i < loops && !ret; i++)
+		ret = vdso_gtod(&tv, NULL);
+	report("vdso", "gettimeofday", loops, start, ret);
+}
+
+int main(int argc, char **argv, char **envp)
+{
+	unsigned long loops = 1000000;
+	unsigned int i;
+
+	if (argc > 1)
+		loops = strtoul(argv[1], NULL, 0);
+	if (!loops) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	/* auxv follows the environment on the initial stack. */
+	while (*envp)
+		envp++;
+	vdso_init_from_auxv(envp + 1);
+
+	vdso_gettime = (vdso_gettime_t)vdso_sym("LINUX_2.6",
+						"__vdso_clock_gettime");
+	vdso_gtod = (vdso_gtod_t)vdso_sym("LINUX_2.6", "__vdso_gettimeofday");
+
+	if (!vdso_gettime && !vdso_gtod)
+		printf("no vDSO found, timing the system calls only\n");
+
+	for (i = 0; i < sizeof(clocks) / sizeof(clocks[0]); i++)
+		bench_clock_gettime(clocks[i].id, clocks[i].name, loops);
+	bench_gettimeofday(loops);
+
+	return 0;
+}
@@ -0,0 +1,682 @@
+#!/usr/bin/env python
+#
+# Generates aesbs-core.S_shipped, the NEON bit sliced AES core:
+#
+#	python aesbs-gen.py > aesbs-core.S_shipped
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License version 2 as
+# published by the Free Software Foundation.
+#
+# Eight blocks are processed at once.  After loading them into q0-q7 an
+# 8x8 bit matrix transposition turns them into eight bit planes: byte n
+# of plane i holds bit i of byte n of each of the eight blocks.  In that
+# form
+#
+#  - SubBytes is a boolean circuit evaluated with veor/vand on whole
+#    planes.  It computes the inversion in GF(2^8) in a tower field
+#    representation GF(((2^2)^2)^2) (36 ANDs), with the basis changes
+#    and the affine transform folded into the linear layers around it.
+#    The circuit is derived and checked against the S-box below.
+#  - ShiftRows is a vtbl permutation of each plane.
+#  - MixColumns rotates the bytes within each column with vshr/vsli and
+#    vrev32, and multiplies by x by renaming planes plus three veors.
+#  - The round keys are expanded to 128 bytes each by the C code, with
+#    the S-box constant 0x63 folded into all but the first one, so that
+#    the circuits here are purely linear outside of the inversion.
+#
+# Everything is written in terms of values and a simple allocator maps
+# them onto the sixteen q registers, spilling to the stack when needed.
+
+import itertools
+import random
+import sys
+
+# ---------------------------------------------------------------------------
+# GF(2^8) and the S-box
+
+def gmul(a, b):
+    r = 0
+    while b:
+        if b & 1:
+            r ^= a
+        a <<= 1
+        if a & 0x100:
+            a ^= 0x11b
+        b >>= 1
+    return r
+
+def rotl8(x, n):
+    return ((x << n) | (x >> (8 - n))) & 0xff
+
+def affine(y):
+    return y ^ rotl8(y, 1) ^ rotl8(y, 2) ^ rotl8(y, 3) ^ rotl8(y, 4)
+
+INV = [0] * 256
+for a in range(1, 256):
+    for b in range(1, 256):
+        if gmul(a, b) == 1:
+            INV[a] = b
+            break
+SBOX = [affine(INV[x]) ^ 0x63 for x in range(256)]
+INV_SBOX = [0] * 256
+for x in range(256):
+    INV_SBOX[SBOX[x]] = x
+
+# ---------------------------------------------------------------------------
+# Tower field GF(((2^2)^2)^2), all in polynomial bases:
+#   GF(4)   = GF(2)[x]/(x^2 + x + 1)
+#   GF(16)  = GF(4)[y]/(y^2 + y + N)
+#   GF(256) = GF(16)[z]/(z^2 + z + L)
+
+def mul4_num(a, b):
+    a1, a0, b1, b0 = a >> 1, a & 1, b >> 1, b & 1
+    p, q, r = a1 & b1, a0 & b0, (a1 ^ a0) & (b1 ^ b0)
+    return ((r ^ q) << 1) | (p ^ q)
+
+class Tower(object):
+    def __init__(self, n, l):
+        self.n, self.l = n, l
+
+    def mul16(self, a, b):
+        p = mul4_num(a >> 2, b >> 2)
+        q = mul4_num(a & 3, b & 3)
+        r = mul4_num((a >> 2) ^ (a & 3), (b >> 2) ^ (b & 3))
+        return ((r ^ q) << 2) | (mul4_num(self.n, p) ^ q)
+
+    def mul256(self, a, b):
+        p = self.mul16(a >> 4, b >> 4)
+        q = self.mul16(a & 15, b & 15)
+        r = self.mul16((a >> 4) ^ (a & 15), (b >> 4) ^ (b & 15))
+        return ((r ^ q) << 4) | (self.mul16(self.l, p) ^ q)
+
+def towers():
+    for n in range(4):
+        if any(mul4_num(y, y) ^ y == n for y in range(4)):
+            continue
+        t = Tower(n, 0)
+        for l in range(16):
+            if all(t.mul16(y, y) ^ y != l for y in range(16)):
+                yield Tower(n, l)
+
+# linear maps are lists of columns (the images of the basis vectors)
+def matvec(cols, v):
+    r = 0
+    for i, c in enumerate(cols):
+        if v >> i & 1:
+            r ^= c
+    return r
+
+def matinv(cols):
+    img = dict((matvec(cols, v), v) for v in range(256))
+    if len(img) != 256:
+        return None
+    return [img[1 << i] for i in range(8)]
+
+def matmul(a, b):
+    return [matvec(a, c) for c in b]
+
+def lincols(f, n):
+    return [f(1 << i) for i in range(n)]
+
+AFFINE = lincols(affine, 8)
+
+def isomorphisms(t):
+    """maps from the AES polynomial basis into the tower t"""
+    for beta in range(2, 256):
+        p = [1]
+        for i in range(8):
+            p.append(t.mul256(p[-1], beta))
+        # beta must be a root of x^8 + x^4 + x^3 + x + 1
+        if p[8] == p[4] ^ p[3] ^ p[1] ^ p[0] and matinv(p[:8]):
+            yield p[:8]
+
+# ---------------------------------------------------------------------------
+# Code in terms of values.  Each value is written once.
+
+class Seg(object):
+    def __init__(self, live_in):
+        self.ops = []
+        self.nvals = 0
+        self.live_in = []
+        for r in live_in:
+            v = self.new()
+            self.live_in.append((v, r))
+
+    def new(self):
+        self.nvals += 1
+        return self.nvals - 1
+
+    def op(self, name, *args):
+        d = self.new()
+        self.ops.append((name, d) + args)
+        return d
+
+    def side(self, name, *args):
+        self.ops.append((name, None) + args)
+
+    def xor(self, a, b):
+        return self.op('veor', a, b)
+
+    def state(self):
+        return [v for v, r in self.live_in]
+
+# ---------------------------------------------------------------------------
+# SubBytes.  Signals are handled as bit masks over a list of values,
+# standing for the XOR of those; linear maps then become sets of masks,
+# which are turned into XORs with Paar's greedy algorithm.  The S-box is
+# computed in stages that each only need a few of the earlier values, to
+# keep the number of live registers down.
+
+def popcount(x):
+    return bin(x).count('1')
+
+def linear(s, vals, targets):
+    """values for the XORs of vals selected by the masks in targets"""
+    avail = dict((1 << i, v) for i, v in enumerate(vals))
+    reps = [set(1 << i for i in range(len(vals)) if t >> i & 1)
+            for t in targets]
+    while any(len(r) > 1 for r in reps):
+        cnt = {}
+        for r in reps:
+            for p in itertools.combinations(sorted(r), 2):
+                cnt[p] = cnt.get(p, 0) + 1
+        a, b = max(sorted(cnt), key=lambda p: cnt[p])
+        if a ^ b not in avail:
+            avail[a ^ b] = s.xor(avail[a], avail[b])
+        for r in reps:
+            if a in r and b in r:
+                r -= set((a, b))
+                r.add(a ^ b)
+    return [avail[t] for t in targets]
+
+def apply(cols, v):
+    """linear map given by its columns applied to a vector of masks"""
+    out = [0] * len(cols)
+    for i in range(len(cols)):
+        for j in range(len(cols)):
+            if cols[i] >> j & 1:
+                out[j] ^= v[i]
+    return out
+
+# The operands of the nine ANDs of a GF(16) product, as masks over the
+# four bits of a factor: GF(4) products (x1, x0, x1 + x0) of the high
+# halves, the low halves and their sums.
+MUL16_OPERANDS = [8, 4, 12, 2, 1, 3, 10, 5, 15]
+
+def mul4(s, a, b):
+    """GF(4) products of the operand triples in a and b, each reduced to
+    its two bits right away so that only those stay live"""
+    res = []
+    for k in range(0, len(a), 3):
+        p, q, r = [s.op('vand', a[k + i], b[k + i]) for i in range(3)]
+        res += [s.xor(p, q), s.xor(r, q)]
+    return res
+
+def mul16(s, t, x, y, xops=MUL16_OPERANDS):
+    """The three GF(4) products of a GF(16) multiplication, see mul16_sum"""
+    return mul4(s, linear(s, x, xops), linear(s, y, MUL16_OPERANDS))
+
+def mul16_sum(t, base=0):
+    """masks of the GF(16) product over the six values from mul16"""
+    p, q, r = [[1 << (base + 2 * k), 1 << (base + 2 * k + 1)] for k in range(3)]
+    n = lincols(lambda v: mul4_num(t.n, v), 2)
+    return [a ^ b for a, b in zip(apply(n, p), q)] + \
+        [a ^ b for a, b in zip(r, q)]
+
+def sub_bytes(s, u, sbox):
+    t, inmap, outmap = sbox
+    x = linear(s, u, apply(inmap, [1 << i for i in range(8)]))
+    h, l = x[4:], x[:4]
+
+    # d = L h^2 + h l + l^2
+    hl = mul16(s, t, h, l)
+    sq = lincols(lambda v: t.mul16(v, v), 4)
+    lsq = lincols(lambda v: t.mul16(t.l, t.mul16(v, v)), 4)
+    d = [a ^ b ^ c for a, b, c in zip(apply(lsq, [1, 2, 4, 8]),
+                                      apply(sq, [16, 32, 64, 128]),
+                                      mul16_sum(t, 8))]
+    d = linear(s, h + l + hl, d)
+
+    # the inverse of d in GF(16), the same way one level down:
+    # e = N d1^2 + d1 d0 + d0^2, 1/d = (d0 + d1) / e + d1 / e y
+    n2 = lincols(lambda v: mul4_num(t.n, mul4_num(v, v)), 2)
+    sq4 = lincols(lambda v: mul4_num(v, v), 2)
+    d1d0 = mul4(s, linear(s, d, [8, 4, 12]), linear(s, d, [2, 1, 3]))
+    e = [a ^ b ^ c for a, b, c in zip(apply(n2, [4, 8]), apply(sq4, [1, 2]),
+                                      [16, 32])]
+    e = linear(s, d + d1d0, apply(sq4, e))	# 1/e = e^2 in GF(4)
+    di = mul4(s, linear(s, d, [10, 5, 15, 8, 4, 12]),
+              linear(s, e, [2, 1, 3, 2, 1, 3]))
+
+    # 1/x = (h + l) / d + h / d z
+    y = mul16(s, t, h + l, di, [m | m << 4 for m in MUL16_OPERANDS]) + \
+        mul16(s, t, h, di)
+    return linear(s, y, apply(outmap, mul16_sum(t) + mul16_sum(t, 6)))
+
+def sbox_variants(inverse):
+    for t in towers():
+        for m in isomorphisms(t):
+            if inverse:
+                yield t, matmul(m, matinv(AFFINE)), matinv(m)
+            else:
+                yield t, m, matmul(AFFINE, matinv(m))
+
+def check_sbox(sbox, inverse):
+    """evaluate the circuit on all inputs at once, bit x of a value
+    standing for input x"""
+    s = Seg(STATE)
+    outs = sub_bytes(s, s.state(), sbox)
+    val = dict((v, sum(1 << x for x in range(256) if x >> i & 1))
+               for i, v in enumerate(s.state()))
+    for op in s.ops:
+        a, b = val[op[2]], val[op[3]]
+        val[op[1]] = a & b if op[0] == 'vand' else a ^ b
+    for j, v in enumerate(outs):
+        for x in range(256):
+            want = INV_SBOX[x ^ 0x63] if inverse else SBOX[x] ^ 0x63
+            assert (val[v] >> x & 1) == (want >> j & 1)
+    return len(s.ops)
+
+SR = [4 * ((i // 4 + i % 4) % 4) + i % 4 for i in range(16)]
+ISR = [4 * ((i // 4 - i % 4) % 4) + i % 4 for i in range(16)]
+
+def shift_rows(s, x, table):
+    idx = s.op('vldsr', table)
+    return [s.op('vtbl', v, idx) for v in x]
+
+def xtime(s, t):
+    """multiply by x, bit plane i of the result is t[i - 1] ^ 0x1b[i] t[7]"""
+    return [t[7], s.xor(t[0], t[7]), t[1], s.xor(t[2], t[7]),
+            s.xor(t[3], t[7]), t[4], t[5], t[6]]
+
+def mix_columns(s, a):
+    """a[r] ^= x * (a[r] ^ a[r+1]) ^ a[r+1] ^ a[r+2] ^ a[r+3]"""
+    r1 = [s.op('rot1', v) for v in a]
+    t = [s.xor(v, w) for v, w in zip(a, r1)]
+    xt = xtime(s, t)
+    return [s.xor(s.xor(xt[i], r1[i]), s.op('rot2', t[i])) for i in range(8)]
+
+def inv_mix_columns(s, a):
+    """multiply by {04,00,05,00} first, then as MixColumns"""
+    t = [s.xor(v, s.op('rot2', v)) for v in a]
+    u = xtime(s, xtime(s, t))
+    return mix_columns(s, [s.xor(v, w) for v, w in zip(a, u)])
+
+def add_round_key(s, x):
+    return [s.xor(v, s.op('vldk')) for v in x]
+
+def transpose(s, x):
+    """8x8 bit matrix transposition within each byte lane"""
+    x = list(x)
+    for n, m in ((1, 0x55), (2, 0x33), (4, 0x0f)):
+        mask = s.op('vmovi', m)
+        for i in range(8):
+            j = i + n
+            if i & n:
+                continue
+            # swapmove(x[j], x[i], n, m)
+            t = s.op('vand', s.xor(s.op('vshr', x[i], n), x[j]), mask)
+            x[j] = s.xor(x[j], t)
+            x[i] = s.xor(x[i], s.op('vshl', t, n))
+    return x
+
+# ---------------------------------------------------------------------------
+# Register allocation
+
+NSRC = {'veor': 2, 'vand': 2, 'rot1': 1, 'rot2': 1, 'vshr': 1, 'vshl': 1,
+        'vtbl': 2, 'vldk': 0, 'vld': 0, 'vst': 1, 'vmovi': 0, 'vldsr': 0}
+
+class Allocator(object):
+    def __init__(self, seg, live_out, spill_base):
+        self.seg = seg
+        self.live_out = live_out
+        self.out = []
+        self.reg = {}		# value -> q register
+        self.owner = {}		# q register -> value
+        self.slot = {}		# value -> stack slot
+        self.free_slots = []
+        self.nslots = spill_base
+        self.remat = {}
+        self.spills = 0
+
+    def emit(self, s):
+        self.out.append('\t' + s)
+
+    def nextuse(self, v, pos):
+        for p in self.uses.get(v, ()):
+            if p >= pos:
+                return p
+        return 1 << 30
+
+    def store(self, v):
+        if v in self.slot or v in self.remat:
+            return
+        if self.free_slots:
+            self.slot[v] = self.free_slots.pop()
+        else:
+            self.slot[v] = self.nslots
+            self.nslots += 1
+        r = self.reg[v]
+        self.emit('vstr\td%d, [sp, #%d]' % (2 * r, 16 * self.slot[v]))
+        self.emit('vstr\td%d, [sp, #%d]' % (2 * r + 1, 16 * self.slot[v] + 8))
+        self.spills += 1
+
+    def getreg(self, pos, keep):
+        for r in range(16):
+            if r not in self.owner:
+                return r
+        cands = [r for r in range(16) if self.owner[r] not in keep]
+        r = max(cands, key=lambda r: (self.nextuse(self.owner[r], pos),
+                                      self.owner[r] in self.remat))
+        v = self.owner[r]
+        if self.nextuse(v, pos) < (1 << 30):
+            self.store(v)
+        del self.reg[v]
+        del self.owner[r]
+        return r
+
+    def load(self, v, pos, keep):
+        if v in self.reg:
+            return self.reg[v]
+        r = self.getreg(pos, keep)
+        if v in self.remat:
+            self.define(v, r, self.remat[v])
+        else:
+            self.emit('vldr\td%d, [sp, #%d]' % (2 * r, 16 * self.slot[v]))
+            self.emit('vldr\td%d, [sp, #%d]' % (2 * r + 1, 16 * self.slot[v] + 8))
+            self.spills += 1
+        self.reg[v] = r
+        self.owner[r] = v
+        return r
+
+    def define(self, v, r, op):
+        name = op[0]
+        if name == 'vmovi':
+            self.emit('vmov.i8\tq%d, #0x%02x' % (r, op[2]))
+        elif name == 'vldsr':
+            self.emit('vld1.8\t{d%d-d%d}, [%s]' % (2 * r, 2 * r + 1, op[2]))
+
+    def release(self, v):
+        if v in self.reg:
+            del self.owner[self.reg[v]]
+            del self.reg[v]
+        if v in self.slot:
+            self.free_slots.append(self.slot.pop(v))
+
+    @staticmethod
+    def sources(op):
+        """the operands of op that are values"""
+        return list(op[2:2 + NSRC[op[0]]])
+
+    def run(self):
+        ops = self.seg.ops
+        self.uses = {}
+        for pos, op in enumerate(ops):
+            for a in self.sources(op):
+                self.uses.setdefault(a, []).append(pos)
+        end = len(ops)
+        for v, r in self.live_out:
+            self.uses.setdefault(v, []).append(end)
+        for v, r in self.seg.live_in:
+            self.reg[v] = r
+            self.owner[r] = v
+
+        for pos, op in enumerate(ops):
+            name, d = op[0], op[1]
+            if name in ('vmovi', 'vldsr'):
+                # constants, only loaded when used
+                self.remat[d] = op
+                continue
+            args = self.sources(op)
+            srcs = [self.load(a, pos, args) for a in args]
+            dead = [a for a in args if self.nextuse(a, pos + 1) == 1 << 30]
+            # rot1 and vtbl write their result in two steps, so the
+            # destination must not overlap a source
+            clobber = name in ('rot1', 'vtbl')
+            if not clobber:
+                for a in dead:
+                    self.release(a)
+            r = None
+            if d is not None:
+                r = self.getreg(pos, args)
+                self.reg[d] = r
+                self.owner[r] = d
+            if clobber:
+                for a in dead:
+                    self.release(a)
+            self.gen(op, r, srcs)
+            if d is not None and d not in self.uses:
+                self.release(d)
+
+        self.place_outputs(end)
+        return self.out
+
+    def gen(self, op, r, s):
+        name = op[0]
+        if name in ('veor', 'vand'):
+            self.emit('%s\tq%d, q%d, q%d' % (name, r, s[0], s[1]))
+        elif name == 'rot1':
+            self.emit('vshr.u32\tq%d, q%d, #8' % (r, s[0]))
+            self.emit('vsli.32\tq%d, q%d, #24' % (r, s[0]))
+        elif name == 'rot2':
+            self.emit('vrev32.16\tq%d, q%d' % (r, s[0]))
+        elif name in ('vshr', 'vshl'):
+            self.emit('%s.u64\tq%d, q%d, #%d' % (name, r, s[0], op[3]))
+        elif name == 'vtbl':
+            for h in (0, 1):
+                self.emit('vtbl.8\td%d, {d%d-d%d}, d%d' %
+                          (2 * r + h, 2 * s[0], 2 * s[0] + 1, 2 * s[1] + h))
+        elif name == 'vldk':
+            self.emit('vld1.8\t{d%d-d%d}, [rk]!' % (2 * r, 2 * r + 1))
+        elif name == 'vld':
+            self.emit('vld1.8\t{d%d-d%d}, [in]!' % (2 * r, 2 * r + 1))
+        elif name == 'vst':
+            self.emit('vst1.8\t{d%d-d%d}, [out]!' % (2 * s[0], 2 * s[0] + 1))
+        else:
+            raise ValueError(name)
+
+    def place_outputs(self, end):
+        want = dict((v, r) for v, r in self.live_out)
+        # values that have to move, resolved as a parallel move
+        while True:
+            pending = [(v, r) for v, r in want.items()
+                       if self.reg.get(v) != r]
+            if not pending:
+                break
+            progress = False
+            for v, r in pending:
+                if r not in self.owner or self.owner[r] not in want:
+                    if r in self.owner:
+                        self.release(self.owner[r])
+                    if v in self.reg:
+                        self.emit('vmov\tq%d, q%d' % (r, self.reg[v]))
+                        del self.owner[self.reg[v]]
+                    else:
+                        self.emit('vldr\td%d, [sp, #%d]' % (2 * r, 16 * self.slot[v]))
+                        self.emit('vldr\td%d, [sp, #%d]' % (2 * r + 1, 16 * self.slot[v] + 8))
+                    self.reg[v] = r
+                    self.owner[r] = v
+                    progress = True
+            if not progress:
+                # a cycle: break it through a free register
+                v, r = pending[0]
+                t = [x for x in range(16) if x not in self.owner][0]
+                self.emit('vmov\tq%d, q%d' % (t, self.reg[v]))
+                del self.owner[self.reg[v]]
+                self.reg[v] = t
+                self.owner[t] = v
+
+# ---------------------------------------------------------------------------
+
+STATE = list(range(8))
+TRIES = 1
+SPREAD = 0
+
+def schedule(s, live_out, rng):
+    """Reorder the operations to keep as few values live as possible:
+    repeatedly pick the ready operation that frees the most registers,
+    preferring the ones using recently computed values.  Loads and stores
+    keep their order since they post-increment the pointers."""
+    ops = s.ops
+    left = {}
+    for op in ops:
+        for a in Allocator.sources(op):
+            left[a] = left.get(a, 0) + 1
+    for v in live_out:
+        left[v] = left.get(v, 0) + 1
+    defined = set(v for v, r in s.live_in)
+    born = dict((v, 0) for v in defined)
+    last = {}
+    prev = {}
+    for i, op in enumerate(ops):
+        if op[0] in ('vldk', 'vld', 'vst'):
+            prev[i] = last.get(op[0])
+            last[op[0]] = i
+    done = set()
+    order = []
+    while len(order) < len(ops):
+        best = None
+        for i, op in enumerate(ops):
+            if i in done or prev.get(i) not in done and prev.get(i) is not None:
+                continue
+            srcs = Allocator.sources(op)
+            if not all(a in defined for a in srcs):
+                continue
+            if op[0] in ('vmovi', 'vldsr'):
+                best = (1 << 20, 0, -i)
+                break
+            freed = sum(1 for a in set(srcs) if left[a] == srcs.count(a))
+            grow = 1 if op[1] is not None else 0
+            recent = max([born[a] for a in srcs] or [0])
+            key = (freed - grow, recent + rng[i], -i)
+            if best is None or key > best:
+                best = key
+        i = -best[2]
+        op = ops[i]
+        done.add(i)
+        order.append(op)
+        for a in Allocator.sources(op):
+            left[a] -= 1
+        if op[1] is not None:
+            defined.add(op[1])
+            born[op[1]] = len(order)
+    s.ops = order
+
+def segment(build, live_in=STATE, live_out=STATE):
+    best = None
+    for seed in range(TRIES):
+        s = Seg(live_in)
+        x = build(s, s.state())
+        r = random.Random(seed)
+        schedule(s, x, [r.random() * SPREAD * (seed > 0) for op in s.ops])
+        a = Allocator(s, list(zip(x, live_out)), 0)
+        code = a.run()
+        if best is None or len(code) < len(best[0]):
+            best = code, a.nslots
+    return best
+
+def load_blocks(s, x):
+    return transpose(s, [s.op('vld') for i in range(8)])
+
+def store_blocks(s, x):
+    for v in transpose(s, x):
+        s.side('vst', v)
+    return []
+
+def gen_cipher(name, inverse, out):
+    circuit = min(sbox_variants(inverse), key=lambda v: check_sbox(v, inverse))
+    sr = '.Lisr' if inverse else '.Lsr'
+
+    def first(s, x):
+        return add_round_key(s, load_blocks(s, x))
+
+    def enc_round(s, x):
+        x = shift_rows(s, sub_bytes(s, x, circuit), 'ip')
+        return add_round_key(s, mix_columns(s, x))
+
+    def dec_round(s, x):
+        x = sub_bytes(s, shift_rows(s, x, 'ip'), circuit)
+        return inv_mix_columns(s, add_round_key(s, x))
+
+    def enc_last(s, x):
+        x = shift_rows(s, sub_bytes(s, x, circuit), 'ip')
+        return store_blocks(s, add_round_key(s, x))
+
+    def dec_last(s, x):
+        x = sub_bytes(s, shift_rows(s, x, 'ip'), circuit)
+        return store_blocks(s, add_round_key(s, x))
+
+    pre, n0 = segment(first, [], STATE)
+    body, n1 = segment(dec_round if inverse else enc_round)
+    post, n2 = segment(dec_last if inverse else enc_last, STATE, [])
+    frame = 16 * max(n0, n1, n2)
+
+    out.append('\t.align\t4')
+    out.append('%s:' % sr)
+    out.append('\t.byte\t' + ', '.join('%d' % i for i in (ISR if inverse else SR)))
+    out.append('')
+    out.append('ENTRY(%s)' % name)
+    out.append('\tvpush\t{q4-q7}')
+    if frame:
+        out.append('\tsub\tsp, sp, #%d' % frame)
+    out.append('\tadr\tip, %s' % sr)
+    out.extend(pre)
+    if inverse:
+        out.append('\tsub\trk, rk, #256')
+    out.append('\tsub\trounds, rounds, #1')
+    out.append('1:')
+    out.extend(body)
+    if inverse:
+        out.append('\tsub\trk, rk, #256')
+    out.append('\tsubs\trounds, rounds, #1')
+    out.append('\tbne\t1b')
+    out.extend(post)
+    if frame:
+        out.append('\tadd\tsp, sp, #%d' % frame)
+    out.append('\tvpop\t{q4-q7}')
+    out.append('\tbx\tlr')
+    out.append('ENDPROC(%s)' % name)
+    return len([l for l in body if not l.endswith(':')])
+
+HEADER = '''\
+/*
+ * Bit sliced AES using NEON instructions
+ *
+ * Generated by aesbs-gen.py, do not edit.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/linkage.h>
+#include <asm/assembler.h>
+
+	out	.req	r0
+	in	.req	r1
+	rk	.req	r2
+	rounds	.req	r3
+
+	.text
+	.fpu	neon
+
+/*
+ * void aesbs_encrypt8(u8 out[], u8 const in[], u8 const rk[], int rounds)
+ * void aesbs_decrypt8(u8 out[], u8 const in[], u8 const rk[], int rounds)
+ *
+ * Encrypt or decrypt eight consecutive blocks.  rk points to the bit
+ * sliced key schedule, (rounds + 1) * 128 bytes; decryption starts at
+ * its end, rk + rounds * 128.
+ */
+'''
+
+def main():
+    out = [HEADER]
+    n = gen_cipher('aesbs_encrypt8', False, out)
+    out.append('')
+    m = gen_cipher('aesbs_decrypt8', True, out)
+    sys.stdout.write('\n'.join(out) + '\n')
+    sys.stderr.write('round: %d (enc), %d (dec) instructions\n' % (n, m))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,15 @@
+#ifndef __ASM_ARM_AES_H
+#define __ASM_ARM_AES_H
+
+#include <linux/crypto.h>
+#include <crypto/aes.h>
+
+/*
+ * Single block AES on a crypto_aes_ctx, using the ARM assembler version.
+ * dst and src must be 32-bit aligned.
+ */
+void crypto_aes_encrypt_arm(struct crypto_aes_ctx *ctx, u8 *dst,
+			    const u8 *src);
+void crypto_aes_decrypt_arm(struct crypto_aes_ctx *ctx, u8 *dst,
+			    const u8 *src);
+#endif
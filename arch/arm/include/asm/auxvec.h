@@ -0,0 +1,12 @@
+#ifndef __ASMARM_AUXVEC_H
+#define __ASMARM_AUXVEC_H
+
+/* Location of the vDSO ELF header, passed to the dynamic linker. */
+#define AT_SYSINFO_EHDR	33
+
+#ifdef __KERNEL__
+/* entries in ARCH_DLINFO */
+#define AT_VECTOR_SIZE_ARCH	1
+#endif
+
+#endif
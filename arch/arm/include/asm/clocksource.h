@@ -0,0 +1,13 @@
+#ifndef _ASM_CLOCKSOURCE_H
+#define _ASM_CLOCKSOURCE_H
+
+/*
+ * Set vdso_direct when the counter behind the clocksource is the CP15
+ * virtual counter (CNTVCT) and userspace is allowed to read it, so the
+ * vDSO can serve the high resolution clocks without entering the kernel.
+ */
+struct arch_clocksource_data {
+	bool vdso_direct;
+};
+
+#endif
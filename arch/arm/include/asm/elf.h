@@ -130,8 +130,18 @@ struct mm_struct;
 extern unsigned long arch_randomize_brk(struct mm_struct *mm);
 #define arch_randomize_brk arch_randomize_brk
 
+struct linux_binprm;
 extern int vectors_user_mapping(void);
-#define arch_setup_additional_pages(bprm, uses_interp) vectors_user_mapping()
+extern int arch_setup_additional_pages(struct linux_binprm *bprm,
+				       int uses_interp);
 #define ARCH_HAS_SETUP_ADDITIONAL_PAGES
 
+#ifdef CONFIG_VDSO
+#define ARCH_DLINFO							\
+do {									\
+	NEW_AUX_ENT(AT_SYSINFO_EHDR,					\
+		    (elf_addr_t)current->mm->context.vdso);		\
+} while (0)
+#endif
+
 #endif
@@ -9,6 +9,9 @@ typedef struct {
 	raw_spinlock_t id_lock;
 #endif
 	unsigned int kvm_seq;
+#ifdef CONFIG_VDSO
+	unsigned long vdso;	/* address of the vDSO ELF header */
+#endif
 } mm_context_t;
 
 #ifdef CONFIG_CPU_HAS_ASID
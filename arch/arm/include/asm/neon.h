@@ -0,0 +1,46 @@
+/*
+ * linux/arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <linux/percpu.h>
+#include <linux/types.h>
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * NEON code must live in its own compilation unit (normally a .S file)
+ * and only be called between kernel_neon_begin() and kernel_neon_end().
+ *
+ * kernel_neon_begin() saves any user VFP/NEON state held in the hardware
+ * and enables the unit for the kernel.  It must not be called from
+ * interrupt context, and preemption stays disabled until the matching
+ * kernel_neon_end(), so the kernel's register contents never need to be
+ * preserved across a context switch.
+ */
+void kernel_neon_begin(void);
+void kernel_neon_end(void);
+
+DECLARE_PER_CPU(bool, kernel_neon_busy);
+
+/*
+ * kernel_neon_begin()/kernel_neon_end() sections do not nest.  Code that
+ * can be reached from inside one, such as the string routines, must
+ * check this and fall back to integer code when it returns true.
+ *
+ * Preemption is disabled throughout a section, so a task that is inside
+ * one always reads its own CPU's flag.
+ */
+static inline bool kernel_neon_in_use(void)
+{
+	return this_cpu_read(kernel_neon_busy);
+}
+
+#endif
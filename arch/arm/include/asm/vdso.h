@@ -0,0 +1,31 @@
+#ifndef __ASM_VDSO_H
+#define __ASM_VDSO_H
+
+#ifdef __KERNEL__
+
+#ifndef __ASSEMBLY__
+
+struct mm_struct;
+
+#ifdef CONFIG_VDSO
+
+int arm_install_vdso(struct mm_struct *mm);
+
+extern char vdso_start, vdso_end;
+
+#else /* CONFIG_VDSO */
+
+static inline int arm_install_vdso(struct mm_struct *mm)
+{
+	return 0;
+}
+
+#endif /* CONFIG_VDSO */
+
+#endif /* __ASSEMBLY__ */
+
+#define VDSO_DATA_SIZE	PAGE_SIZE
+
+#endif /* __KERNEL__ */
+
+#endif /* __ASM_VDSO_H */
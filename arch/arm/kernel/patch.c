@@ -0,0 +1,75 @@
+#include <linux/kernel.h>
+#include <linux/kprobes.h>
+#include <linux/stop_machine.h>
+
+#include <asm/cacheflush.h>
+#include <asm/smp_plat.h>
+
+#include "patch.h"
+
+struct patch {
+	void *addr;
+	unsigned int insn;
+};
+
+/*
+ * Write a 32-bit instruction, as returned by the arm_gen_* helpers,
+ * and make it visible to instruction fetch. A Thumb-2 instruction may
+ * only be halfword aligned, in which case it is written one halfword
+ * at a time.
+ */
+void __kprobes __patch_text(void *addr, unsigned int insn)
+{
+	if (IS_ENABLED(CONFIG_THUMB2_KERNEL) && ((uintptr_t)addr & 2)) {
+		u16 *addrh = addr;
+
+		addrh[0] = insn & 0xffff;
+		addrh[1] = insn >> 16;
+	} else {
+		*(u32 *)addr = insn;
+	}
+
+	flush_icache_range((uintptr_t)(addr),
+			   (uintptr_t)(addr) + sizeof(u32));
+}
+
+static int __kprobes patch_text_stop_machine(void *data)
+{
+	struct patch *patch = data;
+
+	__patch_text(patch->addr, patch->insn);
+
+	return 0;
+}
+
+/*
+ * Patch live kernel text.
+ *
+ * An aligned word store of a branch or NOP may be done while other
+ * CPUs are executing the code, and flush_icache_range() already
+ * reaches all CPUs when the hardware broadcasts cache maintenance.
+ * Otherwise every online CPU writes the instruction and flushes its
+ * own I-cache under stop_machine(), as kprobes does. A Thumb-2
+ * instruction that straddles a word boundary is written with two
+ * stores, so no CPU may run in between: stop_machine() is needed then
+ * too, but only one CPU has to do the write.
+ */
+void __kprobes patch_text(void *addr, unsigned int insn)
+{
+	struct patch patch = {
+		.addr = addr,
+		.insn = insn,
+	};
+
+	if (cache_ops_need_broadcast()) {
+		stop_machine(patch_text_stop_machine, &patch, cpu_online_mask);
+	} else {
+		bool straddles_word = IS_ENABLED(CONFIG_THUMB2_KERNEL)
+				      && ((uintptr_t)addr & 2);
+
+		if (straddles_word)
+			stop_machine(patch_text_stop_machine, &patch, NULL);
+		else
+			__patch_text(addr, insn);
+	}
+}
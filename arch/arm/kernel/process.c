@@ -39,6 +39,7 @@
 #include <asm/thread_notify.h>
 #include <asm/stacktrace.h>
 #include <asm/mach/time.h>
+#include <asm/vdso.h>
 
 #ifdef CONFIG_CC_STACKPROTECTOR
 #include <linux/stackprotector.h>
@@ -545,8 +546,32 @@ int vectors_user_mapping(void)
 				       NULL);
 }
 
+/*
+ * Called at exec time: map the vectors page, then the vDSO (if
+ * configured) at an address of the kernel's choosing.
+ */
+int arch_setup_additional_pages(struct linux_binprm *bprm, int uses_interp)
+{
+	struct mm_struct *mm = current->mm;
+	int ret;
+
+	down_write(&mm->mmap_sem);
+	ret = vectors_user_mapping();
+	if (!ret)
+		ret = arm_install_vdso(mm);
+	up_write(&mm->mmap_sem);
+
+	return ret;
+}
+
 const char *arch_vma_name(struct vm_area_struct *vma)
 {
-	return (vma->vm_start == 0xffff0000) ? "[vectors]" : NULL;
+	if (vma->vm_start == 0xffff0000)
+		return "[vectors]";
+#ifdef CONFIG_VDSO
+	if (vma->vm_mm && vma->vm_start == vma->vm_mm->context.vdso - PAGE_SIZE)
+		return "[vdso]";
+#endif
+	return NULL;
 }
 #endif
@@ -0,0 +1,143 @@
+/*
+ *  linux/arch/arm/kernel/vdso.c
+ *
+ * Maps the vDSO into every process and keeps its data page in sync
+ * with the timekeeping core.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/clocksource.h>
+#include <linux/elf.h>
+#include <linux/err.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/linkage.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/time.h>
+
+#include <asm/cacheflush.h>
+#include <asm/page.h>
+#include <asm/vdso.h>
+#include <asm/vdso_datapage.h>
+
+static struct page **vdso_pagelist;
+static unsigned long vdso_total_pages;
+
+/*
+ * The vDSO data page.
+ */
+static union vdso_data_store vdso_data_store __page_aligned_data;
+static struct vdso_data *vdso_data = &vdso_data_store.data;
+
+static int __init vdso_init(void)
+{
+	unsigned long text_pages;
+	int i;
+
+	if (memcmp(&vdso_start, "\177ELF", 4)) {
+		pr_err("vDSO is not a valid ELF object!\n");
+		return -ENOEXEC;
+	}
+
+	text_pages = (&vdso_end - &vdso_start) >> PAGE_SHIFT;
+	pr_debug("vdso: %lu text pages at %p\n", text_pages, &vdso_start);
+
+	/* Allocate the vDSO pagelist, plus a page for the data. */
+	vdso_pagelist = kcalloc(text_pages + 1, sizeof(struct page *),
+				GFP_KERNEL);
+	if (vdso_pagelist == NULL)
+		return -ENOMEM;
+
+	/* Grab the vDSO data page. */
+	vdso_pagelist[0] = virt_to_page(vdso_data);
+
+	/* Grab the vDSO code pages. */
+	for (i = 0; i < text_pages; i++)
+		vdso_pagelist[i + 1] = virt_to_page(&vdso_start + i * PAGE_SIZE);
+
+	vdso_total_pages = text_pages + 1;
+
+	return 0;
+}
+arch_initcall(vdso_init);
+
+/*
+ * Map the data page followed by the vDSO text. The caller holds
+ * mm->mmap_sem for writing. A process without a vDSO still runs:
+ * its C library simply falls back to the syscalls.
+ */
+int arm_install_vdso(struct mm_struct *mm)
+{
+	unsigned long addr, len;
+	int ret;
+
+	if (vdso_pagelist == NULL)
+		return 0;
+
+	len = vdso_total_pages << PAGE_SHIFT;
+
+	addr = get_unmapped_area(NULL, 0, len, 0, 0);
+	if (IS_ERR_VALUE(addr))
+		return addr;
+
+	/*
+	 * VM_MAYWRITE is required to allow gdb to COW and set
+	 * breakpoints in the text.
+	 */
+	ret = install_special_mapping(mm, addr, len,
+				      VM_READ | VM_EXEC |
+				      VM_MAYREAD | VM_MAYWRITE | VM_MAYEXEC |
+				      VM_ALWAYSDUMP,
+				      vdso_pagelist);
+	if (ret)
+		return ret;
+
+	/* The ELF header follows the data page. */
+	mm->context.vdso = addr + PAGE_SIZE;
+
+	return 0;
+}
+
+/*
+ * Update the vDSO data page to keep in sync with kernel timekeeping.
+ * Called with xtime_lock held for writing, so only the vDSO readers
+ * need to be told about the update through seq_count.
+ */
+void update_vsyscall(struct timespec *ts, struct timespec *wtm,
+		     struct clocksource *c, u32 mult)
+{
+	++vdso_data->seq_count;
+	smp_wmb();
+
+	vdso_data->tk_is_cntvct		= c->archdata.vdso_direct;
+	vdso_data->xtime_coarse_sec	= ts->tv_sec;
+	vdso_data->xtime_coarse_nsec	= ts->tv_nsec;
+	vdso_data->wtm_clock_sec	= wtm->tv_sec;
+	vdso_data->wtm_clock_nsec	= wtm->tv_nsec;
+
+	if (vdso_data->tk_is_cntvct) {
+		vdso_data->cs_cycle_last	= c->cycle_last;
+		vdso_data->xtime_clock_sec	= ts->tv_sec;
+		vdso_data->xtime_clock_nsec	= ts->tv_nsec;
+		vdso_data->cs_mult		= mult;
+		vdso_data->cs_shift		= c->shift;
+		vdso_data->cs_mask		= c->mask;
+	}
+
+	smp_wmb();
+	++vdso_data->seq_count;
+
+	flush_dcache_page(virt_to_page(vdso_data));
+}
+
+void update_vsyscall_tz(void)
+{
+	vdso_data->tz_minuteswest	= sys_tz.tz_minuteswest;
+	vdso_data->tz_dsttime		= sys_tz.tz_dsttime;
+	flush_dcache_page(virt_to_page(vdso_data));
+}
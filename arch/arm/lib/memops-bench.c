@@ -0,0 +1,204 @@
+/*
+ *  linux/arch/arm/lib/memops-bench.c
+ *
+ *  Throughput of the integer and NEON memcpy, memset and copy_page
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  Load the module to run the benchmark; the results go to the kernel
+ *  log and the load then fails so it never stays resident:
+ *
+ *	insmod memops-bench.ko [bytes=<per test>]
+ *
+ *  Every NEON call is wrapped in its own kernel_neon_begin()/end() pair,
+ *  as done by the dispatch code, so the figures include that overhead.
+ *  The NEON results are also checked against the integer ones.
+ */
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#include "memops-neon.h"
+
+#define BENCH_MAX_SIZE	(1 << 20)
+#define BENCH_BUF_SIZE	(BENCH_MAX_SIZE + PAGE_SIZE)
+
+static unsigned int bytes = 32 << 20;
+module_param(bytes, uint, 0);
+MODULE_PARM_DESC(bytes, "Bytes to move per size/alignment test (default 32MB)");
+
+static const unsigned int bench_sizes[] = {
+	64, 256, 1024, 4096, 16384, 65536, 262144, BENCH_MAX_SIZE,
+};
+
+static const struct {
+	unsigned int dst, src;
+} bench_aligns[] = {
+	{ 0, 0 }, { 0, 1 }, { 1, 0 }, { 5, 3 },
+};
+
+enum bench_op {
+	BENCH_MEMCPY,
+	BENCH_MEMSET,
+	BENCH_COPY_PAGE,
+};
+
+static char *src_buf, *dst_buf, *ref_buf;
+
+static void bench_call(enum bench_op op, bool neon, void *dst, void *src,
+		       size_t size)
+{
+	if (neon)
+		kernel_neon_begin();
+
+	switch (op) {
+	case BENCH_MEMCPY:
+		if (neon)
+			__memcpy_neon(dst, src, size);
+		else
+			__memcpy_arm(dst, src, size);
+		break;
+	case BENCH_MEMSET:
+		if (neon)
+			__memset_neon(dst, 0xa5, size);
+		else
+			__memset_arm(dst, 0xa5, size);
+		break;
+	case BENCH_COPY_PAGE:
+		if (neon)
+			__copy_page_neon(dst, src);
+		else
+			__copy_page_arm(dst, src);
+		break;
+	}
+
+	if (neon)
+		kernel_neon_end();
+}
+
+/* Returns the throughput in MB/s */
+static unsigned long bench_run(enum bench_op op, bool neon, void *dst,
+			       void *src, size_t size)
+{
+	unsigned int i, loops = max_t(unsigned int, bytes / size, 1);
+	ktime_t start;
+	u64 ns;
+
+	/* warm up the caches and TLBs */
+	bench_call(op, neon, dst, src, size);
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		bench_call(op, neon, dst, src, size);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	cond_resched();
+
+	return ns ? div64_u64((u64)loops * size * 1000, ns) : 0;
+}
+
+/*
+ * Run both variants on the same buffers and check that the NEON one
+ * produced exactly what the integer one did, including the guard bytes
+ * either side of the destination.
+ */
+static int bench_case(const char *name, enum bench_op op, unsigned int dst_off,
+		      unsigned int src_off, size_t size)
+{
+	char *dst = dst_buf + dst_off, *src = src_buf + src_off;
+	unsigned long arm, neon;
+
+	memset(dst_buf, 0x5a, BENCH_BUF_SIZE);
+	arm = bench_run(op, false, dst, src, size);
+	memcpy(ref_buf, dst_buf, BENCH_BUF_SIZE);
+
+	memset(dst_buf, 0x5a, BENCH_BUF_SIZE);
+	neon = bench_run(op, true, dst, src, size);
+
+	if (memcmp(ref_buf, dst_buf, BENCH_BUF_SIZE)) {
+		pr_err("memops_bench: %s size %zu dst+%u src+%u: NEON result differs\n",
+		       name, size, dst_off, src_off);
+		return -EIO;
+	}
+
+	pr_info("memops_bench: %-9s size %7zu dst+%u src+%u: arm %5lu MB/s, neon %5lu MB/s\n",
+		name, size, dst_off, src_off, arm, neon);
+	return 0;
+}
+
+static int bench_all(void)
+{
+	unsigned int i, j;
+	int err;
+
+	for (i = 0; i < BENCH_MAX_SIZE + PAGE_SIZE; i++)
+		src_buf[i] = i * 7 + (i >> 8);
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_aligns); j++) {
+			err = bench_case("memcpy", BENCH_MEMCPY,
+					 bench_aligns[j].dst,
+					 bench_aligns[j].src, bench_sizes[i]);
+			if (err)
+				return err;
+		}
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bench_sizes); i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_aligns); j++) {
+			/* memset has no source, skip duplicate cases */
+			if (bench_aligns[j].src && !bench_aligns[j].dst)
+				continue;
+			err = bench_case("memset", BENCH_MEMSET,
+					 bench_aligns[j].dst, 0, bench_sizes[i]);
+			if (err)
+				return err;
+		}
+	}
+
+	return bench_case("copy_page", BENCH_COPY_PAGE, 0, 0, PAGE_SIZE);
+}
+
+static int __init memops_bench_init(void)
+{
+	int err = -ENOMEM;
+
+	if (!cpu_has_neon()) {
+		pr_err("memops_bench: NEON not available\n");
+		return -ENODEV;
+	}
+
+	src_buf = vmalloc(BENCH_BUF_SIZE);
+	dst_buf = vmalloc(BENCH_BUF_SIZE);
+	ref_buf = vmalloc(BENCH_BUF_SIZE);
+	if (!src_buf || !dst_buf || !ref_buf)
+		goto out;
+
+	err = bench_all();
+
+	/*
+	 * Like tcrypt, fail the load on purpose: there is nothing left
+	 * to do once the numbers are out.
+	 */
+	if (!err)
+		err = -EAGAIN;
+out:
+	vfree(ref_buf);
+	vfree(dst_buf);
+	vfree(src_buf);
+	return err;
+}
+module_init(memops_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Integer vs NEON memcpy/memset/copy_page throughput");
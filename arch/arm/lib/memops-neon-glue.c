@@ -0,0 +1,88 @@
+/*
+ *  linux/arch/arm/lib/memops-neon-glue.c
+ *
+ *  Route large memcpy, memset and copy_page requests to NEON
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ *
+ *  memcpy, memset, __memzero and copy_page branch here (with their
+ *  original arguments) once a request is at least NEON_MEMOPS_MIN bytes
+ *  long.  The NEON unit is only used when the CPU has one and we are
+ *  neither in interrupt context, nor running with interrupts disabled,
+ *  nor already inside a kernel_neon_begin() section (those do not nest);
+ *  everything else goes back to the integer code.
+ */
+#include <linux/export.h>
+#include <linux/hardirq.h>
+#include <linux/irqflags.h>
+#include <linux/kernel.h>
+
+#include <asm/neon.h>
+
+#include "memops-neon.h"
+
+/*
+ * elf_hwcap only gains HWCAP_NEON once vfp_init() has enabled the
+ * unit, so this also keeps early boot on the integer code.
+ */
+static inline bool neon_memops_usable(void)
+{
+	return cpu_has_neon() && !in_interrupt() && !irqs_disabled() &&
+	       !kernel_neon_in_use();
+}
+
+void *__memcpy_dispatch(void *dest, const void *src, size_t n)
+{
+	if (!neon_memops_usable())
+		return __memcpy_arm(dest, src, n);
+
+	kernel_neon_begin();
+	__memcpy_neon(dest, src, n);
+	kernel_neon_end();
+	return dest;
+}
+
+void *__memset_dispatch(void *s, int c, size_t n)
+{
+	if (!neon_memops_usable())
+		return __memset_arm(s, c, n);
+
+	kernel_neon_begin();
+	__memset_neon(s, c, n);
+	kernel_neon_end();
+	return s;
+}
+
+void __memzero_dispatch(void *s, size_t n)
+{
+	if (!neon_memops_usable()) {
+		__memzero_arm(s, n);
+		return;
+	}
+
+	kernel_neon_begin();
+	__memset_neon(s, 0, n);
+	kernel_neon_end();
+}
+
+void __copy_page_dispatch(void *to, const void *from)
+{
+	if (!neon_memops_usable()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(to, from);
+	kernel_neon_end();
+}
+
+/* For the benchmark module */
+EXPORT_SYMBOL_GPL(__memcpy_arm);
+EXPORT_SYMBOL_GPL(__memset_arm);
+EXPORT_SYMBOL_GPL(__copy_page_arm);
+EXPORT_SYMBOL_GPL(__memcpy_neon);
+EXPORT_SYMBOL_GPL(__memset_neon);
+EXPORT_SYMBOL_GPL(__copy_page_neon);
@@ -0,0 +1,33 @@
+/*
+ *  linux/arch/arm/lib/memops-neon.h
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+#ifndef __ARM_LIB_MEMOPS_NEON_H
+#define __ARM_LIB_MEMOPS_NEON_H
+
+/*
+ * memcpy/memset requests shorter than this stay on the integer code:
+ * below it the cost of kernel_neon_begin()/kernel_neon_end() eats the
+ * gain.  Must be a valid ARM immediate.
+ */
+#define NEON_MEMOPS_MIN		1024
+
+#ifndef __ASSEMBLY__
+
+/* Integer entry points, bypassing the NEON dispatch */
+extern void *__memcpy_arm(void *, const void *, __kernel_size_t);
+extern void *__memset_arm(void *, int, __kernel_size_t);
+extern void __memzero_arm(void *, __kernel_size_t);
+extern void __copy_page_arm(void *, const void *);
+
+/* NEON implementations, to be called between kernel_neon_begin/end */
+extern void __memcpy_neon(void *, const void *, __kernel_size_t);
+extern void __memset_neon(void *, int, __kernel_size_t);
+extern void __copy_page_neon(void *, const void *);
+
+#endif
+
+#endif
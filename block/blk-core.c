@@ -16,6 +16,7 @@
 #include <linux/backing-dev.h>
 #include <linux/bio.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/highmem.h>
 #include <linux/mm.h>
 #include <linux/kernel_stat.h>
@@ -29,11 +30,13 @@
 #include <linux/fault-inject.h>
 #include <linux/list_sort.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
 
 #define CREATE_TRACE_POINTS
 #include <trace/events/block.h>
 
 #include "blk.h"
+#include "blk-mq.h"
 
 EXPORT_TRACEPOINT_SYMBOL_GPL(block_bio_remap);
 EXPORT_TRACEPOINT_SYMBOL_GPL(block_rq_remap);
@@ -56,7 +59,7 @@ struct kmem_cache *blk_requestq_cachep;
  */
 static struct workqueue_struct *kblockd_workqueue;
 
-static void drive_stat_acct(struct request *rq, int new_io)
+void drive_stat_acct(struct request *rq, int new_io)
 {
 	struct hd_struct *part;
 	int rw = rq_data_dir(rq);
@@ -286,7 +289,16 @@ EXPORT_SYMBOL(blk_stop_queue);
 void blk_sync_queue(struct request_queue *q)
 {
 	del_timer_sync(&q->timeout);
-	cancel_delayed_work_sync(&q->delay_work);
+
+	if (q->mq_ops) {
+		struct blk_mq_hw_ctx *hctx;
+		int i;
+
+		queue_for_each_hw_ctx(q, hctx, i)
+			cancel_delayed_work_sync(&hctx->delayed_work);
+	} else {
+		cancel_delayed_work_sync(&q->delay_work);
+	}
 }
 EXPORT_SYMBOL(blk_sync_queue);
 
@@ -433,7 +445,9 @@ void blk_cleanup_queue(struct request_queue *q)
 	 * be trying to tear down @q before its elevator is initialized, in
 	 * which case we don't want to call into draining.
 	 */
-	if (q->elevator)
+	if (q->mq_ops)
+		blk_mq_drain_queue(q);
+	else if (q->elevator)
 		blk_drain_queue(q, true);
 
 	/* @q won't process any more request, flush async actions */
@@ -493,6 +507,7 @@ struct request_queue *blk_alloc_queue_node(gfp_t gfp_mask, int node_id)
 	q->backing_dev_info.capabilities = BDI_CAP_MAP_COPY;
 	q->backing_dev_info.name = "block";
 	q->node = node_id;
+	q->poll_nsec = -1;
 
 	err = bdi_init(&q->backing_dev_info);
 	if (err)
@@ -979,6 +994,9 @@ struct request *blk_get_request(struct request_queue *q, int rw, gfp_t gfp_mask)
 
 	BUG_ON(rw != READ && rw != WRITE);
 
+	if (q->mq_ops)
+		return blk_mq_alloc_request(q, rw, gfp_mask, false);
+
 	spin_lock_irq(q->queue_lock);
 	if (gfp_mask & __GFP_WAIT)
 		rq = get_request_wait(q, rw, NULL);
@@ -1126,6 +1144,12 @@ void __blk_put_request(struct request_queue *q, struct request *req)
 {
 	if (unlikely(!q))
 		return;
+
+	if (q->mq_ops) {
+		blk_mq_free_request(req);
+		return;
+	}
+
 	if (unlikely(--req->ref_count))
 		return;
 
@@ -1155,6 +1179,11 @@ void blk_put_request(struct request *req)
 	unsigned long flags;
 	struct request_queue *q = req->q;
 
+	if (q->mq_ops) {
+		blk_mq_free_request(req);
+		return;
+	}
+
 	spin_lock_irqsave(q->queue_lock, flags);
 	__blk_put_request(q, req);
 	spin_unlock_irqrestore(q->queue_lock, flags);
@@ -1193,8 +1222,8 @@ void blk_add_request_payload(struct request *rq, struct page *page,
 }
 EXPORT_SYMBOL_GPL(blk_add_request_payload);
 
-static bool bio_attempt_back_merge(struct request_queue *q, struct request *req,
-				   struct bio *bio)
+bool bio_attempt_back_merge(struct request_queue *q, struct request *req,
+			    struct bio *bio)
 {
 	const int ff = bio->bi_rw & REQ_FAILFAST_MASK;
 
@@ -1215,8 +1244,8 @@ static bool bio_attempt_back_merge(struct request_queue *q, struct request *req,
 	return true;
 }
 
-static bool bio_attempt_front_merge(struct request_queue *q,
-				    struct request *req, struct bio *bio)
+bool bio_attempt_front_merge(struct request_queue *q, struct request *req,
+			     struct bio *bio)
 {
 	const int ff = bio->bi_rw & REQ_FAILFAST_MASK;
 
@@ -1246,7 +1275,7 @@ static bool bio_attempt_front_merge(struct request_queue *q,
 }
 
 /**
- * attempt_plug_merge - try to merge with %current's plugged list
+ * blk_attempt_plug_merge - try to merge with %current's plugged list
  * @q: request_queue new bio is being queued at
  * @bio: new bio being queued
  * @request_count: out parameter for number of traversed plugged requests
@@ -1262,11 +1291,12 @@ static bool bio_attempt_front_merge(struct request_queue *q,
  * reliable access to the elevator outside queue lock.  Only check basic
  * merging parameters without querying the elevator.
  */
-static bool attempt_plug_merge(struct request_queue *q, struct bio *bio,
-			       unsigned int *request_count)
+bool blk_attempt_plug_merge(struct request_queue *q, struct bio *bio,
+			    unsigned int *request_count)
 {
 	struct blk_plug *plug;
 	struct request *rq;
+	struct list_head *plug_list;
 	bool ret = false;
 
 	plug = current->plug;
@@ -1274,7 +1304,12 @@ static bool attempt_plug_merge(struct request_queue *q, struct bio *bio,
 		goto out;
 	*request_count = 0;
 
-	list_for_each_entry_reverse(rq, &plug->list, queuelist) {
+	if (q->mq_ops)
+		plug_list = &plug->mq_list;
+	else
+		plug_list = &plug->list;
+
+	list_for_each_entry_reverse(rq, plug_list, queuelist) {
 		int el_ret;
 
 		(*request_count)++;
@@ -1336,7 +1371,7 @@ void blk_queue_bio(struct request_queue *q, struct bio *bio)
 	 * Check if we can merge with the plugged list before grabbing
 	 * any locks.
 	 */
-	if (attempt_plug_merge(q, bio, &request_count))
+	if (blk_attempt_plug_merge(q, bio, &request_count))
 		return;
 
 	spin_lock_irq(q->queue_lock);
@@ -1868,7 +1903,7 @@ static void blk_account_io_completion(struct request *req, unsigned int bytes)
 	}
 }
 
-static void blk_account_io_done(struct request *req)
+void blk_account_io_done(struct request *req)
 {
 	/*
 	 * Account IO completion.  flush_rq isn't accounted as a
@@ -2592,6 +2627,123 @@ int blk_lld_busy(struct request_queue *q)
 }
 EXPORT_SYMBOL_GPL(blk_lld_busy);
 
+static void blk_poll_stats_add(struct request_queue *q, ktime_t start)
+{
+	struct blk_poll_stats *ps = &q->poll_stats;
+	unsigned long nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	ps->hits++;
+
+	/* running average over roughly the last eight waits */
+	if (!ps->mean_nsec)
+		ps->mean_nsec = nsec;
+	else
+		ps->mean_nsec += (long)(nsec - ps->mean_nsec) / 8;
+}
+
+/*
+ * Sleep for part of the expected completion time before spinning, so a
+ * polled wait doesn't burn a whole cpu for slow requests. Returns true if
+ * we slept, in which case the caller has to recheck its wait condition.
+ */
+static bool blk_poll_hybrid_sleep(struct request_queue *q, ktime_t start)
+{
+	struct hrtimer_sleeper hs;
+	s64 nsec, elapsed;
+
+	if (q->poll_nsec > 0)
+		nsec = q->poll_nsec;
+	else if (!q->poll_nsec)
+		nsec = q->poll_stats.mean_nsec / 2;
+	else
+		return false;
+
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+	if (elapsed >= nsec)
+		return false;
+
+	q->poll_stats.sleeps++;
+
+	hrtimer_init_on_stack(&hs.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	hrtimer_set_expires(&hs.timer, ns_to_ktime(nsec - elapsed));
+	hrtimer_init_sleeper(&hs, current);
+
+	/*
+	 * The caller has already set the task state, so a completion that
+	 * raced with us has made us runnable and io_schedule() returns at
+	 * once. If we were woken before the timer fired, the IO is done.
+	 */
+	hrtimer_start_expires(&hs.timer, HRTIMER_MODE_REL);
+	if (hs.task)
+		io_schedule();
+	hrtimer_cancel(&hs.timer);
+	destroy_hrtimer_on_stack(&hs.timer);
+
+	if (hs.task)
+		blk_poll_stats_add(q, start);
+
+	__set_current_state(TASK_RUNNING);
+	return true;
+}
+
+/**
+ * blk_poll - poll the driver for the completion we are waiting for
+ * @q:		the queue the IO was submitted to
+ * @start:	when the caller started waiting
+ *
+ * Description:
+ *    Called by a task that has set itself TASK_UNINTERRUPTIBLE and is
+ *    about to io_schedule() until its IO completes. If polling is enabled
+ *    on @q, the driver's poll_fn is called until the completion wakes us
+ *    (leaving us TASK_RUNNING), we need to reschedule or the driver
+ *    reports an error. Depending on the io_poll_delay setting, we may
+ *    sleep for part of the expected completion time first.
+ *
+ * Return:
+ *    true  - We are running again, recheck the wait condition
+ *    false - No completion found, io_schedule() as usual
+ */
+bool blk_poll(struct request_queue *q, ktime_t start)
+{
+	struct blk_plug *plug;
+	long state;
+
+	if (!q->poll_fn || !blk_queue_io_poll(q))
+		return false;
+
+	/* we won't schedule, so nothing else will flush the plug */
+	plug = current->plug;
+	if (plug)
+		blk_flush_plug_list(plug, false);
+
+	if (blk_poll_hybrid_sleep(q, start))
+		return true;
+
+	state = current->state;
+	while (!need_resched()) {
+		int ret;
+
+		q->poll_stats.invoked++;
+		ret = q->poll_fn(q);
+
+		if (current->state == TASK_RUNNING) {
+			blk_poll_stats_add(q, start);
+			return true;
+		}
+		if (signal_pending_state(state, current)) {
+			__set_current_state(TASK_RUNNING);
+			return true;
+		}
+		if (ret < 0)
+			break;
+		cpu_relax();
+	}
+
+	q->poll_stats.misses++;
+	return false;
+}
+EXPORT_SYMBOL_GPL(blk_poll);
+
 /**
  * blk_rq_unprep_clone - Helper function to free all bios in a cloned request
  * @rq: the clone request to be cleaned up
@@ -2727,6 +2879,7 @@ void blk_start_plug(struct blk_plug *plug)
 
 	plug->magic = PLUG_MAGIC;
 	INIT_LIST_HEAD(&plug->list);
+	INIT_LIST_HEAD(&plug->mq_list);
 	INIT_LIST_HEAD(&plug->cb_list);
 	plug->should_sort = 0;
 
@@ -2816,6 +2969,10 @@ void blk_flush_plug_list(struct blk_plug *plug, bool from_schedule)
 	BUG_ON(plug->magic != PLUG_MAGIC);
 
 	flush_plug_callbacks(plug);
+
+	if (!list_empty(&plug->mq_list))
+		blk_mq_flush_plug_list(plug, from_schedule);
+
 	if (list_empty(&plug->list))
 		return;
 
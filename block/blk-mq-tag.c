@@ -0,0 +1,201 @@
+/*
+ * Tag allocation for blk-mq
+ *
+ * Each hardware queue owns a bitmap of nr_tags bits, one per preallocated
+ * request. The first nr_reserved_tags bits are set aside for callers that
+ * must always be able to get a request (error handling, for instance).
+ * Allocation starts the search from a per-cpu hint, so CPUs sharing a
+ * hardware queue tend to work on different words of the bitmap.
+ */
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bitops.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+
+#include <linux/blk-mq.h>
+#include "blk.h"
+#include "blk-mq.h"
+#include "blk-mq-tag.h"
+
+struct blk_mq_tags {
+	unsigned int nr_tags;
+	unsigned int nr_reserved_tags;
+
+	unsigned long *map;
+	unsigned int __percpu *hint;
+
+	wait_queue_head_t wait;
+};
+
+/*
+ * Find and claim a free bit in [start, end), beginning at hint and
+ * wrapping around once. Returns -1 if the range is full.
+ */
+static int __blk_mq_find_tag(unsigned long *map, unsigned int start,
+			     unsigned int end, unsigned int hint)
+{
+	unsigned int tag;
+
+	if (hint < start || hint >= end)
+		hint = start;
+
+	tag = hint;
+	while (1) {
+		tag = find_next_zero_bit(map, end, tag);
+		if (tag >= end) {
+			if (hint == start)
+				return -1;
+			/* wrap, and search what is left before the hint */
+			end = hint;
+			hint = tag = start;
+			continue;
+		}
+		if (!test_and_set_bit(tag, map))
+			return tag;
+		tag++;
+	}
+}
+
+static int __blk_mq_get_tag(struct blk_mq_tags *tags, bool reserved)
+{
+	int tag;
+
+	if (reserved) {
+		if (!tags->nr_reserved_tags)
+			return -1;
+		return __blk_mq_find_tag(tags->map, 0, tags->nr_reserved_tags,
+					 0);
+	}
+
+	tag = __blk_mq_find_tag(tags->map, tags->nr_reserved_tags,
+				tags->nr_tags, this_cpu_read(*tags->hint));
+	if (tag >= 0)
+		this_cpu_write(*tags->hint, tag + 1);
+
+	return tag;
+}
+
+unsigned int blk_mq_get_tag(struct blk_mq_tags *tags, gfp_t gfp, bool reserved)
+{
+	DEFINE_WAIT(wait);
+	int tag;
+
+	while (1) {
+		tag = __blk_mq_get_tag(tags, reserved);
+		if (tag >= 0 || !(gfp & __GFP_WAIT))
+			break;
+
+		prepare_to_wait(&tags->wait, &wait, TASK_UNINTERRUPTIBLE);
+
+		tag = __blk_mq_get_tag(tags, reserved);
+		if (tag >= 0)
+			break;
+
+		io_schedule();
+	}
+
+	finish_wait(&tags->wait, &wait);
+
+	if (tag < 0)
+		return BLK_MQ_TAG_FAIL;
+
+	return tag;
+}
+
+void blk_mq_wait_for_tags(struct blk_mq_tags *tags, bool reserved)
+{
+	unsigned int tag;
+
+	tag = blk_mq_get_tag(tags, __GFP_WAIT, reserved);
+	blk_mq_put_tag(tags, tag);
+}
+
+void blk_mq_put_tag(struct blk_mq_tags *tags, unsigned int tag)
+{
+	BUG_ON(tag >= tags->nr_tags);
+
+	clear_bit(tag, tags->map);
+	smp_mb__after_clear_bit();
+
+	if (waitqueue_active(&tags->wait))
+		wake_up(&tags->wait);
+}
+
+void blk_mq_tag_busy_iter(struct blk_mq_tags *tags,
+			  void (*fn)(void *, unsigned int), void *data)
+{
+	unsigned int tag;
+
+	for_each_set_bit(tag, tags->map, tags->nr_tags)
+		fn(data, tag);
+}
+
+unsigned int blk_mq_tag_busy(struct blk_mq_tags *tags)
+{
+	return bitmap_weight(tags->map, tags->nr_tags);
+}
+
+bool blk_mq_has_free_tags(struct blk_mq_tags *tags)
+{
+	if (!tags)
+		return true;
+
+	return find_next_zero_bit(tags->map, tags->nr_tags,
+				  tags->nr_reserved_tags) < tags->nr_tags;
+}
+
+struct blk_mq_tags *blk_mq_init_tags(unsigned int total_tags,
+				     unsigned int reserved_tags, int node)
+{
+	struct blk_mq_tags *tags;
+
+	if (total_tags > BLK_MQ_TAG_MAX) {
+		pr_err("blk-mq: tag depth too large\n");
+		return NULL;
+	}
+
+	tags = kzalloc_node(sizeof(*tags), GFP_KERNEL, node);
+	if (!tags)
+		return NULL;
+
+	tags->map = kzalloc_node(BITS_TO_LONGS(total_tags) * sizeof(long),
+				 GFP_KERNEL, node);
+	if (!tags->map)
+		goto err_map;
+
+	tags->hint = alloc_percpu(unsigned int);
+	if (!tags->hint)
+		goto err_hint;
+
+	tags->nr_tags = total_tags;
+	tags->nr_reserved_tags = reserved_tags;
+	init_waitqueue_head(&tags->wait);
+
+	return tags;
+
+err_hint:
+	kfree(tags->map);
+err_map:
+	kfree(tags);
+	return NULL;
+}
+
+void blk_mq_free_tags(struct blk_mq_tags *tags)
+{
+	free_percpu(tags->hint);
+	kfree(tags->map);
+	kfree(tags);
+}
+
+ssize_t blk_mq_tag_sysfs_show(struct blk_mq_tags *tags, char *page)
+{
+	if (!tags)
+		return 0;
+
+	return sprintf(page, "nr_tags=%u, reserved_tags=%u, busy=%u\n",
+		       tags->nr_tags, tags->nr_reserved_tags,
+		       blk_mq_tag_busy(tags));
+}
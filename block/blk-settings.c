@@ -99,6 +99,22 @@ void blk_queue_lld_busy(struct request_queue *q, lld_busy_fn *fn)
 }
 EXPORT_SYMBOL_GPL(blk_queue_lld_busy);
 
+/**
+ * blk_queue_poll - set driver completion poll function
+ * @q:		queue
+ * @fn:		function that reaps completed requests without waiting for
+ *		an interrupt. Returns the number of requests completed, or
+ *		a negative value if polling can't make progress.
+ *
+ * Polling is only used once enabled through the queue's io_poll sysfs
+ * attribute, see blk_poll().
+ */
+void blk_queue_poll(struct request_queue *q, poll_fn *fn)
+{
+	q->poll_fn = fn;
+}
+EXPORT_SYMBOL_GPL(blk_queue_poll);
+
 /**
  * blk_set_default_limits - reset limits to default values
  * @lim:  the queue_limits structure to reset
@@ -6107,16 +6107,16 @@ static struct cipher_testvec cast6_dec_tv_template[] = {
 /*
  * AES test vectors.
  */
-#define AES_ENC_TEST_VECTORS 3
-#define AES_DEC_TEST_VECTORS 3
-#define AES_CBC_ENC_TEST_VECTORS 4
-#define AES_CBC_DEC_TEST_VECTORS 4
+#define AES_ENC_TEST_VECTORS 4
+#define AES_DEC_TEST_VECTORS 4
+#define AES_CBC_ENC_TEST_VECTORS 5
+#define AES_CBC_DEC_TEST_VECTORS 5
 #define AES_LRW_ENC_TEST_VECTORS 8
 #define AES_LRW_DEC_TEST_VECTORS 8
 #define AES_XTS_ENC_TEST_VECTORS 5
 #define AES_XTS_DEC_TEST_VECTORS 5
-#define AES_CTR_ENC_TEST_VECTORS 3
-#define AES_CTR_DEC_TEST_VECTORS 3
+#define AES_CTR_ENC_TEST_VECTORS 4
+#define AES_CTR_DEC_TEST_VECTORS 4
 #define AES_OFB_ENC_TEST_VECTORS 1
 #define AES_OFB_DEC_TEST_VECTORS 1
 #define AES_CTR_3686_ENC_TEST_VECTORS 7
@@ -6164,6 +6164,52 @@ static struct cipher_testvec aes_enc_tv_template[] = {
 		.result	= "\x8e\xa2\xb7\xca\x51\x67\x45\xbf"
 			  "\xea\xfc\x49\x90\x4b\x49\x60\x89",
 		.rlen	= 16,
+	}, { /* Generated with a reference implementation */
+		.key	= "\x69\xec\x04\xe9\x56\x67\xe1\x91"
+			  "\x97\xcc\x02\x19\x6b\xec\xba\x58",
+		.klen	= 16,
+		.input	= "\x3a\x5d\x63\xbe\x21\x5a\x2b\x1c"
+			  "\x51\x81\xd8\xed\xc5\x8d\x36\x0a"
+			  "\xf1\x45\x2f\x94\xb3\x94\x54\x51"
+			  "\x6f\x91\x90\xb1\x3f\xb1\x46\x7e"
+			  "\x80\xaa\xa8\x33\x44\xca\xda\x8e"
+			  "\xe0\xd1\xef\x65\x31\xba\x8f\xc8"
+			  "\x39\x9e\x20\xa7\x96\xb1\x75\x2e"
+			  "\x4a\x10\x9a\x45\x43\x9b\xdd\x1c"
+			  "\xd5\x1d\x5e\x4e\xc6\x83\xd8\xd2"
+			  "\xc1\xab\x9a\xcc\xd4\x44\xa5\xc3"
+			  "\x74\x98\x94\xc6\x5f\xd6\x94\xda"
+			  "\x90\xe1\x76\xde\x53\x9b\x13\x96"
+			  "\x36\xa4\x8d\xc7\x5a\x91\xb1\xc0"
+			  "\x81\x48\x18\x53\x6b\x9b\x04\x7a"
+			  "\x67\x19\x7b\xb4\x95\xc3\x18\xb7"
+			  "\x5f\xc1\x71\xb2\xb4\x8a\xef\x83"
+			  "\xa4\xd3\x27\x44\x92\x63\xa4\x78"
+			  "\xcb\x87\xe0\xdf\x73\xa3\xf4\x80"
+			  "\x69\x34\x61\x2d\xdd\x7e\x84\xc0"
+			  "\x96\x38\x67\x54\xfb\xdd\xe7\xfb",
+		.ilen	= 160,
+		.result	= "\xac\x06\x94\x07\xea\x70\xf2\xdb"
+			  "\x7e\x8c\x76\x16\x9e\xb0\x8e\xa6"
+			  "\x19\x4a\xd5\x81\xe2\x35\xac\x1a"
+			  "\x7f\xe0\x9e\x45\x2a\x2d\x15\x8e"
+			  "\x4f\x60\x6a\x3e\x4f\x37\x08\xd1"
+			  "\x65\xea\xef\x25\xe3\x16\x1b\x2e"
+			  "\x65\xb4\x55\xd0\xee\x79\x8b\x3f"
+			  "\x64\xee\xdd\x2f\x91\x2c\x19\xc7"
+			  "\xba\x80\x67\xef\xd1\x8a\x52\x94"
+			  "\xf4\x2d\x19\xcc\xed\x8b\xe2\xba"
+			  "\x96\x55\x35\xd4\xda\x04\xf8\x0a"
+			  "\xdb\x5b\xd1\xc1\x0c\xc6\x43\x28"
+			  "\x74\x65\xe7\xce\xc6\x9d\xc2\x83"
+			  "\x65\x6f\x54\xa7\x82\xbb\x24\xee"
+			  "\x1e\x50\xbb\xf3\x8a\xe2\x0e\xf2"
+			  "\x6b\x1b\xa5\x0f\x1b\x0d\xca\x1f"
+			  "\x14\x0d\xfe\x70\x52\xd9\x50\x7f"
+			  "\x4a\x3e\x06\xe3\xb6\x79\xf7\x41"
+			  "\xda\x39\x18\x5c\x1b\x2a\xd2\xcb"
+			  "\x17\x13\xf8\x7e\xc7\x25\x4a\x95",
+		.rlen	= 160,
 	},
 };
 
@@ -6201,6 +6247,52 @@ static struct cipher_testvec aes_dec_tv_template[] = {
 		.result	= "\x00\x11\x22\x33\x44\x55\x66\x77"
 			  "\x88\x99\xaa\xbb\xcc\xdd\xee\xff",
 		.rlen	= 16,
+	}, { /* Generated with a reference implementation */
+		.key	= "\x69\xec\x04\xe9\x56\x67\xe1\x91"
+			  "\x97\xcc\x02\x19\x6b\xec\xba\x58",
+		.klen	= 16,
+		.input	= "\xac\x06\x94\x07\xea\x70\xf2\xdb"
+			  "\x7e\x8c\x76\x16\x9e\xb0\x8e\xa6"
+			  "\x19\x4a\xd5\x81\xe2\x35\xac\x1a"
+			  "\x7f\xe0\x9e\x45\x2a\x2d\x15\x8e"
+			  "\x4f\x60\x6a\x3e\x4f\x37\x08\xd1"
+			  "\x65\xea\xef\x25\xe3\x16\x1b\x2e"
+			  "\x65\xb4\x55\xd0\xee\x79\x8b\x3f"
+			  "\x64\xee\xdd\x2f\x91\x2c\x19\xc7"
+			  "\xba\x80\x67\xef\xd1\x8a\x52\x94"
+			  "\xf4\x2d\x19\xcc\xed\x8b\xe2\xba"
+			  "\x96\x55\x35\xd4\xda\x04\xf8\x0a"
+			  "\xdb\x5b\xd1\xc1\x0c\xc6\x43\x28"
+			  "\x74\x65\xe7\xce\xc6\x9d\xc2\x83"
+			  "\x65\x6f\x54\xa7\x82\xbb\x24\xee"
+			  "\x1e\x50\xbb\xf3\x8a\xe2\x0e\xf2"
+			  "\x6b\x1b\xa5\x0f\x1b\x0d\xca\x1f"
+			  "\x14\x0d\xfe\x70\x52\xd9\x50\x7f"
+			  "\x4a\x3e\x06\xe3\xb6\x79\xf7\x41"
+			  "\xda\x39\x18\x5c\x1b\x2a\xd2\xcb"
+			  "\x17\x13\xf8\x7e\xc7\x25\x4a\x95",
+		.ilen	= 160,
+		.result	= "\x3a\x5d\x63\xbe\x21\x5a\x2b\x1c"
+			  "\x51\x81\xd8\xed\xc5\x8d\x36\x0a"
+			  "\xf1\x45\x2f\x94\xb3\x94\x54\x51"
+			  "\x6f\x91\x90\xb1\x3f\xb1\x46\x7e"
+			  "\x80\xaa\xa8\x33\x44\xca\xda\x8e"
+			  "\xe0\xd1\xef\x65\x31\xba\x8f\xc8"
+			  "\x39\x9e\x20\xa7\x96\xb1\x75\x2e"
+			  "\x4a\x10\x9a\x45\x43\x9b\xdd\x1c"
+			  "\xd5\x1d\x5e\x4e\xc6\x83\xd8\xd2"
+			  "\xc1\xab\x9a\xcc\xd4\x44\xa5\xc3"
+			  "\x74\x98\x94\xc6\x5f\xd6\x94\xda"
+			  "\x90\xe1\x76\xde\x53\x9b\x13\x96"
+			  "\x36\xa4\x8d\xc7\x5a\x91\xb1\xc0"
+			  "\x81\x48\x18\x53\x6b\x9b\x04\x7a"
+			  "\x67\x19\x7b\xb4\x95\xc3\x18\xb7"
+			  "\x5f\xc1\x71\xb2\xb4\x8a\xef\x83"
+			  "\xa4\xd3\x27\x44\x92\x63\xa4\x78"
+			  "\xcb\x87\xe0\xdf\x73\xa3\xf4\x80"
+			  "\x69\x34\x61\x2d\xdd\x7e\x84\xc0"
+			  "\x96\x38\x67\x54\xfb\xdd\xe7\xfb",
+		.rlen	= 160,
 	},
 };
 
@@ -6283,6 +6375,55 @@ static struct cipher_testvec aes_cbc_enc_tv_template[] = {
 			  "\xb2\xeb\x05\xe2\xc3\x9b\xe9\xfc"
 			  "\xda\x6c\x19\x07\x8c\x6a\x9d\x1b",
 		.rlen	= 64,
+	}, { /* Generated with a reference implementation */
+		.key	= "\xa2\xd1\xcc\x92\x84\x02\xc1\x5c"
+			  "\xea\x74\x77\xc0\xa0\xf4\x6a\x00"
+			  "\x2e\xa2\xb2\x23\xdf\x32\xb1\x7f",
+		.klen	= 24,
+		.iv	= "\xfb\x53\xc2\x3d\x9a\xa9\x11\x3f"
+			  "\xe1\x49\x49\xff\xda\x69\xea\x36",
+		.input	= "\x8f\xe9\x5a\x0a\xe0\x2e\x71\xd1"
+			  "\xc9\xbd\x23\x9e\xd7\x86\xc2\xd1"
+			  "\x0a\xbc\x72\xdb\x38\x8b\xd7\xf8"
+			  "\x57\xd5\xe4\x30\x06\x58\xa0\xcd"
+			  "\xfb\x1a\x4d\xea\xdf\x53\x4e\xac"
+			  "\x3c\x91\xf2\x6a\x99\x19\xee\xdf"
+			  "\xdc\x69\x93\xf9\x78\x9a\xd8\xcc"
+			  "\xf6\xda\xd4\x64\x0a\xfb\x98\x80"
+			  "\x01\x6e\x52\x65\x83\x0d\xdc\x45"
+			  "\x66\xfd\x41\x88\xd7\xc4\x5b\x1d"
+			  "\x65\x04\x51\x52\x22\xcc\x1d\xf8"
+			  "\x6d\xf0\xfc\x1d\x75\x34\x59\x1a"
+			  "\xf3\x55\xb4\x54\xb2\x5a\x4f\x5b"
+			  "\x4f\xbc\xe2\xad\x86\x35\x90\xdf"
+			  "\xf1\xdb\xa0\x61\x61\xe6\x44\xdd"
+			  "\x19\xf7\x8b\xb6\x94\x08\x67\x51"
+			  "\xec\x60\x96\x03\x32\xb5\xc3\xba"
+			  "\x2a\x1c\x67\x9a\x87\x12\x51\x52"
+			  "\xe3\x9c\xe9\x83\x60\x65\x24\x90"
+			  "\x6c\x7a\x23\xaf\xa7\x7e\x72\xf6",
+		.ilen	= 160,
+		.result	= "\xf3\x15\x43\xca\xa6\x82\x24\x51"
+			  "\xcb\xfa\xd5\xbf\x17\xf3\x47\x77"
+			  "\x22\x08\x52\xab\x10\x2b\xea\x24"
+			  "\xb6\x2a\xd8\xfa\x95\xb4\x53\x35"
+			  "\x73\x38\xb3\xba\x02\x91\xec\x23"
+			  "\xd2\x9c\x45\xf8\x8e\x8b\x06\x60"
+			  "\x0c\x04\x51\x0a\x78\xd0\x92\x71"
+			  "\xd4\x46\xd3\x37\x0b\xae\x98\xec"
+			  "\xc1\x52\x49\x17\xce\x67\xeb\x85"
+			  "\xc4\x4a\xc3\xc5\x7c\xbe\x74\x38"
+			  "\xe0\x8a\x4d\x8c\xcc\xab\x03\xaa"
+			  "\x72\x2b\xa3\x3f\x56\xaa\x45\x4c"
+			  "\x58\x0d\xa2\xa0\xd2\x65\x81\x4a"
+			  "\x22\xb3\x3a\xe4\x20\x6c\x4c\x83"
+			  "\xd2\x2f\x2d\xad\x07\x51\xb4\x74"
+			  "\x71\x77\x1a\xd7\x71\xa7\x0e\x8d"
+			  "\x88\x4f\x08\x29\x30\xe3\x55\xf6"
+			  "\xa9\x50\xd1\xb0\xe7\x1b\x6e\xf0"
+			  "\xcc\xe1\x27\x97\x8c\x73\x40\x19"
+			  "\xe2\x6c\x58\x8c\xb9\x68\xbb\x33",
+		.rlen	= 160,
 	},
 };
 
@@ -6365,6 +6506,55 @@ static struct cipher_testvec aes_cbc_dec_tv_template[] = {
 			  "\xf6\x9f\x24\x45\xdf\x4f\x9b\x17"
 			  "\xad\x2b\x41\x7b\xe6\x6c\x37\x10",
 		.rlen	= 64,
+	}, { /* Generated with a reference implementation */
+		.key	= "\xa2\xd1\xcc\x92\x84\x02\xc1\x5c"
+			  "\xea\x74\x77\xc0\xa0\xf4\x6a\x00"
+			  "\x2e\xa2\xb2\x23\xdf\x32\xb1\x7f",
+		.klen	= 24,
+		.iv	= "\xfb\x53\xc2\x3d\x9a\xa9\x11\x3f"
+			  "\xe1\x49\x49\xff\xda\x69\xea\x36",
+		.input	= "\xf3\x15\x43\xca\xa6\x82\x24\x51"
+			  "\xcb\xfa\xd5\xbf\x17\xf3\x47\x77"
+			  "\x22\x08\x52\xab\x10\x2b\xea\x24"
+			  "\xb6\x2a\xd8\xfa\x95\xb4\x53\x35"
+			  "\x73\x38\xb3\xba\x02\x91\xec\x23"
+			  "\xd2\x9c\x45\xf8\x8e\x8b\x06\x60"
+			  "\x0c\x04\x51\x0a\x78\xd0\x92\x71"
+			  "\xd4\x46\xd3\x37\x0b\xae\x98\xec"
+			  "\xc1\x52\x49\x17\xce\x67\xeb\x85"
+			  "\xc4\x4a\xc3\xc5\x7c\xbe\x74\x38"
+			  "\xe0\x8a\x4d\x8c\xcc\xab\x03\xaa"
+			  "\x72\x2b\xa3\x3f\x56\xaa\x45\x4c"
+			  "\x58\x0d\xa2\xa0\xd2\x65\x81\x4a"
+			  "\x22\xb3\x3a\xe4\x20\x6c\x4c\x83"
+			  "\xd2\x2f\x2d\xad\x07\x51\xb4\x74"
+			  "\x71\x77\x1a\xd7\x71\xa7\x0e\x8d"
+			  "\x88\x4f\x08\x29\x30\xe3\x55\xf6"
+			  "\xa9\x50\xd1\xb0\xe7\x1b\x6e\xf0"
+			  "\xcc\xe1\x27\x97\x8c\x73\x40\x19"
+			  "\xe2\x6c\x58\x8c\xb9\x68\xbb\x33",
+		.ilen	= 160,
+		.result	= "\x8f\xe9\x5a\x0a\xe0\x2e\x71\xd1"
+			  "\xc9\xbd\x23\x9e\xd7\x86\xc2\xd1"
+			  "\x0a\xbc\x72\xdb\x38\x8b\xd7\xf8"
+			  "\x57\xd5\xe4\x30\x06\x58\xa0\xcd"
+			  "\xfb\x1a\x4d\xea\xdf\x53\x4e\xac"
+			  "\x3c\x91\xf2\x6a\x99\x19\xee\xdf"
+			  "\xdc\x69\x93\xf9\x78\x9a\xd8\xcc"
+			  "\xf6\xda\xd4\x64\x0a\xfb\x98\x80"
+			  "\x01\x6e\x52\x65\x83\x0d\xdc\x45"
+			  "\x66\xfd\x41\x88\xd7\xc4\x5b\x1d"
+			  "\x65\x04\x51\x52\x22\xcc\x1d\xf8"
+			  "\x6d\xf0\xfc\x1d\x75\x34\x59\x1a"
+			  "\xf3\x55\xb4\x54\xb2\x5a\x4f\x5b"
+			  "\x4f\xbc\xe2\xad\x86\x35\x90\xdf"
+			  "\xf1\xdb\xa0\x61\x61\xe6\x44\xdd"
+			  "\x19\xf7\x8b\xb6\x94\x08\x67\x51"
+			  "\xec\x60\x96\x03\x32\xb5\xc3\xba"
+			  "\x2a\x1c\x67\x9a\x87\x12\x51\x52"
+			  "\xe3\x9c\xe9\x83\x60\x65\x24\x90"
+			  "\x6c\x7a\x23\xaf\xa7\x7e\x72\xf6",
+		.rlen	= 160,
 	},
 };
 
@@ -7629,7 +7819,59 @@ static struct cipher_testvec aes_ctr_enc_tv_template[] = {
 			  "\xdf\xc9\xc5\x8d\xb6\x7a\xad\xa6"
 			  "\x13\xc2\xdd\x08\x45\x79\x41\xa6",
 		.rlen	= 64,
-	}
+	}, { /* Generated with a reference implementation */
+		.key	= "\x8b\x19\xaf\x9a\x46\x66\xab\xdf"
+			  "\x47\x79\x74\x5a\x63\x1c\x49\xf8"
+			  "\x66\x6c\x1e\x91\x4b\x7d\x35\x1f"
+			  "\xdf\x4a\x19\x8a\xf8\x24\x76\xac",
+		.klen	= 32,
+		.iv	= "\x2d\xd8\x56\x00\xd9\xc7\x29\xbc"
+			  "\xff\xff\xff\xff\xff\xff\xff\xfc",
+		.input	= "\xdc\x64\x30\xc1\x1e\x96\x1b\xb0"
+			  "\x7e\x35\xf1\x72\xa7\x05\x97\x47"
+			  "\xd0\xaf\x0d\x2f\x59\xdf\x22\x43"
+			  "\x5e\xab\x80\x53\x3f\x95\xa8\xcc"
+			  "\x24\x9d\xaa\xa4\x89\xe5\x2f\x43"
+			  "\x7f\x48\xbf\x32\x09\x72\xfe\xcb"
+			  "\xce\xd1\x8f\x19\xb3\x4a\x7a\x98"
+			  "\xcd\xea\x1c\x27\x19\x12\x23\x5e"
+			  "\x68\x89\x08\xbb\xfc\xa6\x2b\x65"
+			  "\x2f\x40\xd3\x7a\x80\x0d\x6c\xd6"
+			  "\x9b\x15\x16\xce\x7e\x19\x28\x22"
+			  "\x21\x23\x0f\xbc\x61\x0b\x65\x66"
+			  "\x6e\xa6\x2e\x3d\x38\x19\xd3\xdb"
+			  "\xaf\x3f\xbc\xcb\x9a\x0e\x79\x7a"
+			  "\x26\x46\x94\xe9\xb3\x5b\xb5\xfc"
+			  "\x9a\x5d\x21\x3f\xac\x05\x9f\xc8"
+			  "\x50\x4d\x9f\x43\xb3\xc6\xc3\xe7"
+			  "\x72\x79\x0f\x32\x38\x56\xd7\x9b"
+			  "\x3e\x7b\x18\xa9\x3f\x12\x7c\x76"
+			  "\x59\xfc\x71\xc3\x47\x9b\x61\xf2"
+			  "\xae\xac\x33",
+		.ilen	= 163,
+		.result	= "\x81\x98\x6b\x20\xb7\x01\xc7\x02"
+			  "\x02\x4f\x32\x58\x9d\xc3\x90\x22"
+			  "\x22\x97\x0f\xe8\xe1\x6c\xfe\xa8"
+			  "\x86\x7c\xf6\x13\x02\x2c\x4c\x5e"
+			  "\xf3\xca\x7a\x67\xcb\x9b\x44\xa3"
+			  "\x1e\x47\xdf\x82\xaf\xdc\xe6\xe8"
+			  "\x6c\xe0\xa6\xb0\x7d\x5d\x21\xe5"
+			  "\x75\xf2\x38\x29\xb3\x85\x9f\x85"
+			  "\xc1\xbd\xa2\xd7\xc5\xfb\xb2\xde"
+			  "\xbb\x45\xa4\x92\x02\x2c\x64\x2c"
+			  "\xcb\x23\xef\xa1\xc1\x40\xc7\x0c"
+			  "\xe5\x8e\x47\x5c\x74\x1f\x59\xba"
+			  "\x5a\xb1\xaa\xec\x25\x2f\xef\x98"
+			  "\x5b\xea\x99\x5b\xd1\x93\xf9\x9d"
+			  "\xc4\x3f\xf8\xab\xcc\xb3\x04\x63"
+			  "\xbd\x4f\x02\xcb\x5b\x8e\x35\x99"
+			  "\x32\x0d\xa5\x7e\x0a\xd7\x51\x4b"
+			  "\xc6\x0e\xc1\x95\xd0\x90\x89\xbb"
+			  "\x88\xd2\x4b\x65\xce\x65\xf6\x92"
+			  "\x6b\xaf\xf1\x79\x03\x27\x08\x86"
+			  "\x28\x32\x19",
+		.rlen	= 163,
+	},
 };
 
 static struct cipher_testvec aes_ctr_dec_tv_template[] = {
@@ -7708,7 +7950,59 @@ static struct cipher_testvec aes_ctr_dec_tv_template[] = {
 			  "\xf6\x9f\x24\x45\xdf\x4f\x9b\x17"
 			  "\xad\x2b\x41\x7b\xe6\x6c\x37\x10",
 		.rlen	= 64,
-	}
+	}, { /* Generated with a reference implementation */
+		.key	= "\x8b\x19\xaf\x9a\x46\x66\xab\xdf"
+			  "\x47\x79\x74\x5a\x63\x1c\x49\xf8"
+			  "\x66\x6c\x1e\x91\x4b\x7d\x35\x1f"
+			  "\xdf\x4a\x19\x8a\xf8\x24\x76\xac",
+		.klen	= 32,
+		.iv	= "\x2d\xd8\x56\x00\xd9\xc7\x29\xbc"
+			  "\xff\xff\xff\xff\xff\xff\xff\xfc",
+		.input	= "\x81\x98\x6b\x20\xb7\x01\xc7\x02"
+			  "\x02\x4f\x32\x58\x9d\xc3\x90\x22"
+			  "\x22\x97\x0f\xe8\xe1\x6c\xfe\xa8"
+			  "\x86\x7c\xf6\x13\x02\x2c\x4c\x5e"
+			  "\xf3\xca\x7a\x67\xcb\x9b\x44\xa3"
+			  "\x1e\x47\xdf\x82\xaf\xdc\xe6\xe8"
+			  "\x6c\xe0\xa6\xb0\x7d\x5d\x21\xe5"
+			  "\x75\xf2\x38\x29\xb3\x85\x9f\x85"
+			  "\xc1\xbd\xa2\xd7\xc5\xfb\xb2\xde"
+			  "\xbb\x45\xa4\x92\x02\x2c\x64\x2c"
+			  "\xcb\x23\xef\xa1\xc1\x40\xc7\x0c"
+			  "\xe5\x8e\x47\x5c\x74\x1f\x59\xba"
+			  "\x5a\xb1\xaa\xec\x25\x2f\xef\x98"
+			  "\x5b\xea\x99\x5b\xd1\x93\xf9\x9d"
+			  "\xc4\x3f\xf8\xab\xcc\xb3\x04\x63"
+			  "\xbd\x4f\x02\xcb\x5b\x8e\x35\x99"
+			  "\x32\x0d\xa5\x7e\x0a\xd7\x51\x4b"
+			  "\xc6\x0e\xc1\x95\xd0\x90\x89\xbb"
+			  "\x88\xd2\x4b\x65\xce\x65\xf6\x92"
+			  "\x6b\xaf\xf1\x79\x03\x27\x08\x86"
+			  "\x28\x32\x19",
+		.ilen	= 163,
+		.result	= "\xdc\x64\x30\xc1\x1e\x96\x1b\xb0"
+			  "\x7e\x35\xf1\x72\xa7\x05\x97\x47"
+			  "\xd0\xaf\x0d\x2f\x59\xdf\x22\x43"
+			  "\x5e\xab\x80\x53\x3f\x95\xa8\xcc"
+			  "\x24\x9d\xaa\xa4\x89\xe5\x2f\x43"
+			  "\x7f\x48\xbf\x32\x09\x72\xfe\xcb"
+			  "\xce\xd1\x8f\x19\xb3\x4a\x7a\x98"
+			  "\xcd\xea\x1c\x27\x19\x12\x23\x5e"
+			  "\x68\x89\x08\xbb\xfc\xa6\x2b\x65"
+			  "\x2f\x40\xd3\x7a\x80\x0d\x6c\xd6"
+			  "\x9b\x15\x16\xce\x7e\x19\x28\x22"
+			  "\x21\x23\x0f\xbc\x61\x0b\x65\x66"
+			  "\x6e\xa6\x2e\x3d\x38\x19\xd3\xdb"
+			  "\xaf\x3f\xbc\xcb\x9a\x0e\x79\x7a"
+			  "\x26\x46\x94\xe9\xb3\x5b\xb5\xfc"
+			  "\x9a\x5d\x21\x3f\xac\x05\x9f\xc8"
+			  "\x50\x4d\x9f\x43\xb3\xc6\xc3\xe7"
+			  "\x72\x79\x0f\x32\x38\x56\xd7\x9b"
+			  "\x3e\x7b\x18\xa9\x3f\x12\x7c\x76"
+			  "\x59\xfc\x71\xc3\x47\x9b\x61\xf2"
+			  "\xae\xac\x33",
+		.rlen	= 163,
+	},
 };
 
 static struct cipher_testvec aes_ctr_rfc3686_enc_tv_template[] = {
@@ -13256,6 +13550,166 @@ static struct comp_testvec lzo_decomp_tv_template[] = {
 	},
 };
 
+/*
+ * LZ4 test vectors.
+ */
+#define LZ4_COMP_TEST_VECTORS 2
+#define LZ4_DECOMP_TEST_VECTORS 2
+
+static struct comp_testvec lz4_comp_tv_template[] = {
+	{
+		.inlen	= 70,
+		.outlen	= 45,
+		.input	= "Join us now and share the software "
+			"Join us now and share the software ",
+		.output	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+	}, {
+		.inlen	= 159,
+		.outlen	= 125,
+		.input	= "This document describes a compression method based on the LZO "
+			"compression algorithm.  This document defines the application of "
+			"the LZO algorithm used in UBIFS.",
+		.output	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x4f\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x56\x00\x21\x6f\x66\x13\x00"
+			  "\x00\x49\x00\x05\x3d\x00\x20\x20"
+			  "\x75\x63\x00\x90\x69\x6e\x20\x55"
+			  "\x42\x49\x46\x53\x2e",
+	},
+};
+
+static struct comp_testvec lz4_decomp_tv_template[] = {
+	{
+		.inlen	= 125,
+		.outlen	= 159,
+		.input	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x4f\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x56\x00\x21\x6f\x66\x13\x00"
+			  "\x00\x49\x00\x05\x3d\x00\x20\x20"
+			  "\x75\x63\x00\x90\x69\x6e\x20\x55"
+			  "\x42\x49\x46\x53\x2e",
+		.output	= "This document describes a compression method based on the LZO "
+			"compression algorithm.  This document defines the application of "
+			"the LZO algorithm used in UBIFS.",
+	}, {
+		.inlen	= 45,
+		.outlen	= 70,
+		.input	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+		.output	= "Join us now and share the software "
+			"Join us now and share the software ",
+	},
+};
+
+/*
+ * LZ4HC test vectors.
+ */
+#define LZ4HC_COMP_TEST_VECTORS 2
+#define LZ4HC_DECOMP_TEST_VECTORS 2
+
+static struct comp_testvec lz4hc_comp_tv_template[] = {
+	{
+		.inlen	= 70,
+		.outlen	= 45,
+		.input	= "Join us now and share the software "
+			"Join us now and share the software ",
+		.output	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+	}, {
+		.inlen	= 159,
+		.outlen	= 122,
+		.input	= "This document describes a compression method based on the LZO "
+			"compression algorithm.  This document defines the application of "
+			"the LZO algorithm used in UBIFS.",
+		.output	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x4f\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x32\x00\x25\x6f\x66\x49\x00"
+			  "\x05\x3d\x00\x20\x20\x75\x63\x00"
+			  "\x90\x69\x6e\x20\x55\x42\x49\x46"
+			  "\x53\x2e",
+	},
+};
+
+static struct comp_testvec lz4hc_decomp_tv_template[] = {
+	{
+		.inlen	= 122,
+		.outlen	= 159,
+		.input	= "\xf9\x2e\x54\x68\x69\x73\x20\x64"
+			  "\x6f\x63\x75\x6d\x65\x6e\x74\x20"
+			  "\x64\x65\x73\x63\x72\x69\x62\x65"
+			  "\x73\x20\x61\x20\x63\x6f\x6d\x70"
+			  "\x72\x65\x73\x73\x69\x6f\x6e\x20"
+			  "\x6d\x65\x74\x68\x6f\x64\x20\x62"
+			  "\x61\x73\x65\x64\x20\x6f\x6e\x20"
+			  "\x74\x68\x65\x20\x4c\x5a\x4f\x24"
+			  "\x00\xcc\x61\x6c\x67\x6f\x72\x69"
+			  "\x74\x68\x6d\x2e\x20\x20\x56\x00"
+			  "\x51\x66\x69\x6e\x65\x73\x36\x00"
+			  "\x80\x61\x70\x70\x6c\x69\x63\x61"
+			  "\x74\x32\x00\x25\x6f\x66\x49\x00"
+			  "\x05\x3d\x00\x20\x20\x75\x63\x00"
+			  "\x90\x69\x6e\x20\x55\x42\x49\x46"
+			  "\x53\x2e",
+		.output	= "This document describes a compression method based on the LZO "
+			"compression algorithm.  This document defines the application of "
+			"the LZO algorithm used in UBIFS.",
+	}, {
+		.inlen	= 45,
+		.outlen	= 70,
+		.input	= "\xf0\x10\x4a\x6f\x69\x6e\x20\x75"
+			  "\x73\x20\x6e\x6f\x77\x20\x61\x6e"
+			  "\x64\x20\x73\x68\x61\x72\x65\x20"
+			  "\x74\x68\x65\x20\x73\x6f\x66\x74"
+			  "\x77\x0d\x00\x0f\x23\x00\x0b\x50"
+			  "\x77\x61\x72\x65\x20",
+		.output	= "Join us now and share the software "
+			"Join us now and share the software ",
+	},
+};
+
 /*
  * Michael MIC test vectors from IEEE 802.11i
  */
@@ -19,6 +19,8 @@
 #include <linux/err.h>
 #include <linux/dma-mapping.h>
 #include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/skbuff.h>
 
 #include "davinci_cpdma.h"
 
@@ -86,6 +88,20 @@ struct cpdma_desc_pool {
 	spinlock_t		lock;
 };
 
+/*
+ * Receive buffer pool: a small ring of pages carved into fixed size
+ * fragments.  Every fragment handed out holds a page reference, which the
+ * network stack drops once the skb built around it is freed.  When the
+ * ring wraps around to a page that nobody else references any more, the
+ * page is reused as is instead of going back to the page allocator.
+ */
+struct cpdma_frag_pool {
+	unsigned int		frag_size;
+	unsigned int		offset;
+	int			cur, nr_pages;
+	struct page		*pages[0];
+};
+
 enum cpdma_state {
 	CPDMA_STATE_IDLE,
 	CPDMA_STATE_ACTIVE,
@@ -109,10 +125,13 @@ struct cpdma_chan {
 	int				chan_num;
 	spinlock_t			lock;
 	struct cpdma_desc __iomem	*head, *tail;
+	bool				kick_pending;
 	int				count;
 	void __iomem			*hdp, *cp, *rxfree;
 	u32				mask;
 	cpdma_handler_fn		handler;
+	void				*ctx;
+	struct cpdma_frag_pool		*frag_pool;
 	enum dma_data_direction		dir;
 	struct cpdma_chan_stats		stats;
 	/* offsets into dmaregs */
@@ -474,7 +493,7 @@ void cpdma_ctlr_eoi(struct cpdma_ctlr *ctlr)
 }
 
 struct cpdma_chan *cpdma_chan_create(struct cpdma_ctlr *ctlr, int chan_num,
-				     cpdma_handler_fn handler)
+				     cpdma_handler_fn handler, void *ctx)
 {
 	struct cpdma_chan *chan;
 	int ret, offset = (chan_num % CPDMA_MAX_CHANNELS) * 4;
@@ -497,6 +516,7 @@ struct cpdma_chan *cpdma_chan_create(struct cpdma_ctlr *ctlr, int chan_num,
 	chan->state	= CPDMA_STATE_IDLE;
 	chan->chan_num	= chan_num;
 	chan->handler	= handler;
+	chan->ctx	= ctx;
 
 	if (is_rx_chan(chan)) {
 		chan->hdp	= ctlr->params.rxhdp + offset;
@@ -542,10 +562,107 @@ int cpdma_chan_destroy(struct cpdma_chan *chan)
 		cpdma_chan_stop(chan);
 	ctlr->channels[chan->chan_num] = NULL;
 	spin_unlock_irqrestore(&ctlr->lock, flags);
+	cpdma_chan_frag_pool_destroy(chan);
 	kfree(chan);
 	return 0;
 }
 
+int cpdma_chan_frag_pool_create(struct cpdma_chan *chan,
+				unsigned int frag_size, int nr_frags)
+{
+	struct cpdma_frag_pool *pool;
+	int frags_per_page, nr_pages;
+
+	if (!chan || chan->frag_pool)
+		return -EINVAL;
+
+	frag_size = SKB_DATA_ALIGN(frag_size);
+	if (!frag_size || frag_size > PAGE_SIZE)
+		return -EINVAL;
+
+	/*
+	 * Size the ring at twice the pages needed to back nr_frags buffers,
+	 * so that pages have had a full ring worth of receives to come back
+	 * from the stack before we look at them again.
+	 */
+	frags_per_page = PAGE_SIZE / frag_size;
+	nr_pages = 2 * DIV_ROUND_UP(nr_frags, frags_per_page);
+
+	pool = kzalloc(sizeof(*pool) + nr_pages * sizeof(struct page *),
+		       GFP_KERNEL);
+	if (!pool)
+		return -ENOMEM;
+
+	pool->frag_size = frag_size;
+	pool->nr_pages	= nr_pages;
+	pool->cur	= 0;
+	pool->offset	= PAGE_SIZE;	/* force a page switch on first use */
+	chan->frag_pool	= pool;
+	return 0;
+}
+
+void cpdma_chan_frag_pool_destroy(struct cpdma_chan *chan)
+{
+	struct cpdma_frag_pool *pool = chan->frag_pool;
+	int i;
+
+	if (!pool)
+		return;
+
+	for (i = 0; i < pool->nr_pages; i++)
+		if (pool->pages[i])
+			put_page(pool->pages[i]);
+	chan->frag_pool = NULL;
+	kfree(pool);
+}
+
+/*
+ * Pool fragments are handed out from the channel's receive path only (the
+ * initial fill happens before the channel is started), so no locking is
+ * needed here.
+ */
+void *cpdma_chan_frag_alloc(struct cpdma_chan *chan, gfp_t gfp_mask)
+{
+	struct cpdma_frag_pool *pool = chan->frag_pool;
+	struct page *page;
+
+	if (WARN_ON(!pool))
+		return NULL;
+
+	if (pool->offset + pool->frag_size > PAGE_SIZE) {
+		pool->cur = (pool->cur + 1) % pool->nr_pages;
+		page = pool->pages[pool->cur];
+
+		if (page && page_count(page) == 1) {
+			chan->stats.frag_recycled++;
+		} else {
+			if (page)
+				put_page(page);
+			page = alloc_page(gfp_mask | __GFP_COLD);
+			pool->pages[pool->cur] = page;
+			if (!page) {
+				chan->stats.frag_alloc_fail++;
+				/* retry this slot on the next call */
+				pool->cur = (pool->cur + pool->nr_pages - 1) %
+					    pool->nr_pages;
+				return NULL;
+			}
+			chan->stats.frag_page_alloc++;
+		}
+		pool->offset = 0;
+	}
+
+	page = pool->pages[pool->cur];
+	get_page(page);
+	pool->offset += pool->frag_size;
+	return page_address(page) + pool->offset - pool->frag_size;
+}
+
+void cpdma_chan_frag_free(void *frag)
+{
+	put_page(virt_to_head_page(frag));
+}
+
 int cpdma_chan_get_stats(struct cpdma_chan *chan,
 			 struct cpdma_chan_stats *stats)
 {
@@ -601,13 +718,30 @@ int cpdma_chan_dump(struct cpdma_chan *chan)
 		 chan->stats.requeue);
 	dev_info(dev, "\tstats teardown_dequeue: %d\n",
 		 chan->stats.teardown_dequeue);
+	dev_info(dev, "\tstats kick_deferred: %d\n",
+		 chan->stats.kick_deferred);
+	if (chan->frag_pool) {
+		dev_info(dev, "\tstats frag_recycled: %d\n",
+			 chan->stats.frag_recycled);
+		dev_info(dev, "\tstats frag_page_alloc: %d\n",
+			 chan->stats.frag_page_alloc);
+		dev_info(dev, "\tstats frag_alloc_fail: %d\n",
+			 chan->stats.frag_alloc_fail);
+	}
 
 	spin_unlock_irqrestore(&chan->lock, flags);
 	return 0;
 }
 
+static void __cpdma_chan_kick(struct cpdma_chan *chan)
+{
+	if (chan->kick_pending && chan->state == CPDMA_STATE_ACTIVE)
+		chan_write(chan, hdp, desc_phys(chan->ctlr->pool, chan->head));
+	chan->kick_pending = false;
+}
+
 static void __cpdma_chan_submit(struct cpdma_chan *chan,
-				struct cpdma_desc __iomem *desc)
+				struct cpdma_desc __iomem *desc, bool more)
 {
 	struct cpdma_ctlr		*ctlr = chan->ctlr;
 	struct cpdma_desc __iomem	*prev = chan->tail;
@@ -617,13 +751,21 @@ static void __cpdma_chan_submit(struct cpdma_chan *chan,
 
 	desc_dma = desc_phys(pool, desc);
 
-	/* simple case - idle channel */
+	/*
+	 * simple case - idle channel.  If the caller has more descriptors
+	 * coming, hold off the head pointer write until the last one is
+	 * chained, so that the hardware is started once for the batch.
+	 */
 	if (!chan->head) {
 		chan->stats.head_enqueue++;
 		chan->head = desc;
 		chan->tail = desc;
-		if (chan->state == CPDMA_STATE_ACTIVE)
+		if (more) {
+			chan->kick_pending = true;
+			chan->stats.kick_deferred++;
+		} else if (chan->state == CPDMA_STATE_ACTIVE) {
 			chan_write(chan, hdp, desc_dma);
+		}
 		return;
 	}
 
@@ -640,10 +782,13 @@ static void __cpdma_chan_submit(struct cpdma_chan *chan,
 		chan_write(chan, hdp, desc_dma);
 		chan->stats.misqueued++;
 	}
+
+	if (!more)
+		__cpdma_chan_kick(chan);
 }
 
 int cpdma_chan_submit(struct cpdma_chan *chan, void *token, void *data,
-		      int len, gfp_t gfp_mask)
+		      int len, gfp_t gfp_mask, bool more)
 {
 	struct cpdma_ctlr		*ctlr = chan->ctlr;
 	struct cpdma_desc __iomem	*desc;
@@ -662,6 +807,7 @@ int cpdma_chan_submit(struct cpdma_chan *chan, void *token, void *data,
 	desc = cpdma_desc_alloc(ctlr->pool, 1);
 	if (!desc) {
 		chan->stats.desc_alloc_fail++;
+		__cpdma_chan_kick(chan);
 		ret = -ENOMEM;
 		goto unlock_ret;
 	}
@@ -682,7 +828,7 @@ int cpdma_chan_submit(struct cpdma_chan *chan, void *token, void *data,
 	desc_write(desc, sw_buffer, buffer);
 	desc_write(desc, sw_len,    len);
 
-	__cpdma_chan_submit(chan, desc);
+	__cpdma_chan_submit(chan, desc, more);
 
 	if (chan->state == CPDMA_STATE_ACTIVE && chan->rxfree)
 		chan_write(chan, rxfree, 1);
@@ -694,6 +840,19 @@ unlock_ret:
 	return ret;
 }
 
+/*
+ * Start the hardware on descriptors queued with @more set, for when the
+ * caller ends up not submitting the rest of a batch.
+ */
+void cpdma_chan_kick(struct cpdma_chan *chan)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->lock, flags);
+	__cpdma_chan_kick(chan);
+	spin_unlock_irqrestore(&chan->lock, flags);
+}
+
 static void __cpdma_chan_free(struct cpdma_chan *chan,
 			      struct cpdma_desc __iomem *desc,
 			      int outlen, int status)
@@ -710,7 +869,7 @@ static void __cpdma_chan_free(struct cpdma_chan *chan,
 
 	dma_unmap_single(ctlr->dev, buff_dma, origlen, chan->dir);
 	cpdma_desc_free(pool, desc, 1);
-	(*chan->handler)(token, outlen, status);
+	(*chan->handler)(token, outlen, status, chan->ctx);
 }
 
 static int __cpdma_chan_process(struct cpdma_chan *chan)
@@ -794,6 +953,7 @@ int cpdma_chan_start(struct cpdma_chan *chan)
 	}
 	dma_reg_write(ctlr, chan->int_set, chan->mask);
 	chan->state = CPDMA_STATE_ACTIVE;
+	chan->kick_pending = false;
 	if (chan->head) {
 		chan_write(chan, hdp, desc_phys(pool, chan->head));
 		if (chan->rxfree)
@@ -819,6 +979,7 @@ int cpdma_chan_stop(struct cpdma_chan *chan)
 	}
 
 	chan->state = CPDMA_STATE_TEARDOWN;
+	chan->kick_pending = false;
 	dma_reg_write(ctlr, chan->int_clear, chan->mask);
 
 	/* trigger teardown */
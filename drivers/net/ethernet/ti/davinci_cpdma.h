@@ -59,12 +59,16 @@ struct cpdma_chan_stats {
 	u32			good_dequeue;
 	u32			requeue;
 	u32			teardown_dequeue;
+	u32			kick_deferred;
+	u32			frag_recycled;
+	u32			frag_page_alloc;
+	u32			frag_alloc_fail;
 };
 
 struct cpdma_ctlr;
 struct cpdma_chan;
 
-typedef void (*cpdma_handler_fn)(void *token, int len, int status);
+typedef void (*cpdma_handler_fn)(void *token, int len, int status, void *ctx);
 
 struct cpdma_ctlr *cpdma_ctlr_create(struct cpdma_params *params);
 int cpdma_ctlr_destroy(struct cpdma_ctlr *ctlr);
@@ -73,16 +77,23 @@ int cpdma_ctlr_stop(struct cpdma_ctlr *ctlr);
 int cpdma_ctlr_dump(struct cpdma_ctlr *ctlr);
 
 struct cpdma_chan *cpdma_chan_create(struct cpdma_ctlr *ctlr, int chan_num,
-				     cpdma_handler_fn handler);
+				     cpdma_handler_fn handler, void *ctx);
 int cpdma_chan_destroy(struct cpdma_chan *chan);
 int cpdma_chan_start(struct cpdma_chan *chan);
 int cpdma_chan_stop(struct cpdma_chan *chan);
 int cpdma_chan_dump(struct cpdma_chan *chan);
 
+int cpdma_chan_frag_pool_create(struct cpdma_chan *chan,
+				unsigned int frag_size, int nr_frags);
+void cpdma_chan_frag_pool_destroy(struct cpdma_chan *chan);
+void *cpdma_chan_frag_alloc(struct cpdma_chan *chan, gfp_t gfp_mask);
+void cpdma_chan_frag_free(void *frag);
+
 int cpdma_chan_get_stats(struct cpdma_chan *chan,
 			 struct cpdma_chan_stats *stats);
 int cpdma_chan_submit(struct cpdma_chan *chan, void *token, void *data,
-		      int len, gfp_t gfp_mask);
+		      int len, gfp_t gfp_mask, bool more);
+void cpdma_chan_kick(struct cpdma_chan *chan);
 int cpdma_chan_process(struct cpdma_chan *chan, int quota);
 
 int cpdma_ctlr_int_ctrl(struct cpdma_ctlr *ctlr, bool enable);
@@ -0,0 +1,416 @@
+/*
+ * Texas Instruments CPDMA Driver - software test
+ *
+ * Runs the receive side of the CPDMA driver against a software stand-in
+ * for the DMA engine: the registers live in plain memory, and the test
+ * plays the part of the hardware by completing the descriptors the head
+ * descriptor pointer names.  This exercises descriptor queueing, EOQ and
+ * misqueue handling, teardown, and the page fragment pool and build_skb()
+ * path of the receive handler without an EMAC.
+ *
+ * The driver is built into this module (see the #include below), so that
+ * the test can reach the descriptor pool.  Results go to the kernel log;
+ * loading the module fails if any check fails.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation version 2.
+ */
+#include <linux/module.h>
+#include <linux/platform_device.h>
+
+#include "davinci_cpdma.c"
+
+/* the driver's shorthands for ctlr->params would mangle ours */
+#undef dmaregs
+#undef num_chan
+
+#define TEST_NUM_DESC		64	/* receive ring size */
+#define TEST_BURST		16	/* frames per simulated interrupt */
+#define TEST_ROUNDS		64
+#define TEST_NUM_HELD		(4 * TEST_NUM_DESC)
+#define TEST_FRAME_LEN		1000
+#define TEST_MAX_FRAME_SIZE	(1500 + 14 + 4 + 4)
+
+/* same layout as davinci_emac */
+#define TEST_HEADROOM		(NET_SKB_PAD + NET_IP_ALIGN)
+#define TEST_FRAG_SIZE		(SKB_DATA_ALIGN(TEST_HEADROOM + \
+				 TEST_MAX_FRAME_SIZE) + \
+				 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
+/* register file of the stand-in, one channel of each direction */
+struct cpdma_test_regs {
+	u32			dma[0x100 / 4];
+	u32			txhdp[1], rxhdp[1];
+	u32			txcp[1], rxcp[1];
+	u32			rxthresh[1], rxfree[1];
+};
+
+struct cpdma_test {
+	struct platform_device	*pdev;
+	struct cpdma_test_regs	*regs;
+	struct cpdma_ctlr	*ctlr;
+	struct cpdma_chan	*rxchan;
+
+	/* receive handler behaviour */
+	bool			refill;
+	bool			hold;
+	struct sk_buff		*held[TEST_NUM_HELD];
+	int			nr_held;
+
+	int			received;
+	int			torn_down;
+	int			errors;
+};
+
+#define CHECK(t, cond)							\
+	do {								\
+		if (!(cond)) {						\
+			pr_err("cpdma_test: %s:%d: check failed: %s\n",	\
+			       __func__, __LINE__, #cond);		\
+			(t)->errors++;					\
+		}							\
+	} while (0)
+
+static int test_rx_submit(struct cpdma_test *t, void *frag, gfp_t gfp_mask)
+{
+	return cpdma_chan_submit(t->rxchan, frag, frag + TEST_HEADROOM,
+				 TEST_MAX_FRAME_SIZE, gfp_mask, false);
+}
+
+/* modelled on emac_rx_handler(), minus the network device */
+static void test_rx_handler(void *token, int len, int status, void *ctx)
+{
+	struct cpdma_test *t = ctx;
+	void *frag = token;
+	struct sk_buff *skb;
+
+	if (status < 0) {
+		t->torn_down++;
+		cpdma_chan_frag_free(frag);
+		return;
+	}
+
+	CHECK(t, len == TEST_FRAME_LEN);
+
+	skb = build_skb(frag, TEST_FRAG_SIZE);
+	if (!skb) {
+		t->errors++;
+		cpdma_chan_frag_free(frag);
+		return;
+	}
+	skb_reserve(skb, TEST_HEADROOM);
+	skb_put(skb, len);
+	CHECK(t, skb->head == frag && skb->head_frag);
+	CHECK(t, skb_end_pointer(skb) + sizeof(struct skb_shared_info) <=
+		 (unsigned char *)frag + TEST_FRAG_SIZE);
+	t->received++;
+
+	/* a held skb stands for one still sitting in a socket queue */
+	if (t->hold && t->nr_held < TEST_NUM_HELD)
+		t->held[t->nr_held++] = skb;
+	else
+		kfree_skb(skb);
+
+	if (!t->refill)
+		return;
+
+	frag = cpdma_chan_frag_alloc(t->rxchan, GFP_ATOMIC);
+	if (!frag) {
+		t->errors++;
+		return;
+	}
+	if (test_rx_submit(t, frag, GFP_ATOMIC)) {
+		t->errors++;
+		cpdma_chan_frag_free(frag);
+	}
+}
+
+/*
+ * The hardware side: receive up to @nr frames into the descriptors
+ * starting at the one in the head descriptor pointer, and leave that
+ * pointer at the first descriptor not used.  Like the EMAC, mark the
+ * last descriptor of the queue with EOQ when running off its end.
+ */
+static int test_hw_receive(struct cpdma_test *t, int nr)
+{
+	struct cpdma_desc_pool *pool = t->ctlr->pool;
+	struct cpdma_desc __iomem *desc, *next;
+	u32 mode;
+	int done = 0;
+
+	desc = desc_from_phys(pool, __raw_readl(&t->regs->rxhdp[0]));
+	while (desc && done < nr) {
+		mode = desc_read(desc, hw_mode);
+		if (!(mode & CPDMA_DESC_OWNER))
+			break;
+
+		next = desc_from_phys(pool, desc_read(desc, hw_next));
+		mode &= ~(CPDMA_DESC_OWNER | 0x7ff);
+		mode |= TEST_FRAME_LEN;
+		if (!next)
+			mode |= CPDMA_DESC_EOQ;
+		desc_write(desc, hw_mode, mode);
+
+		desc = next;
+		done++;
+	}
+	__raw_writel(desc_phys(pool, desc), &t->regs->rxhdp[0]);
+	return done;
+}
+
+static void test_release_held(struct cpdma_test *t)
+{
+	while (t->nr_held)
+		kfree_skb(t->held[--t->nr_held]);
+}
+
+static void test_run_rounds(struct cpdma_test *t, int rounds)
+{
+	int i, nr;
+
+	for (i = 0; i < rounds; i++) {
+		nr = test_hw_receive(t, TEST_BURST);
+		CHECK(t, nr == TEST_BURST);
+		CHECK(t, cpdma_chan_process(t->rxchan, TEST_BURST) == nr);
+	}
+	CHECK(t, t->rxchan->count == TEST_NUM_DESC);
+}
+
+static void test_fill(struct cpdma_test *t, int fill_pages)
+{
+	struct cpdma_chan_stats stats;
+	void *frag;
+	int i;
+
+	for (i = 0; i < TEST_NUM_DESC; i++) {
+		frag = cpdma_chan_frag_alloc(t->rxchan, GFP_KERNEL);
+		if (!frag) {
+			t->errors++;
+			return;
+		}
+		if (test_rx_submit(t, frag, GFP_KERNEL)) {
+			t->errors++;
+			cpdma_chan_frag_free(frag);
+			return;
+		}
+	}
+
+	cpdma_chan_get_stats(t->rxchan, &stats);
+	CHECK(t, stats.frag_page_alloc == fill_pages);
+	CHECK(t, stats.frag_recycled == 0);
+	CHECK(t, stats.head_enqueue == 1);
+	CHECK(t, stats.tail_enqueue == TEST_NUM_DESC - 1);
+
+	/* nothing may reach the hardware before the channel is started */
+	CHECK(t, __raw_readl(&t->regs->rxhdp[0]) == 0);
+}
+
+/* the stack frees every frame at once: pages must come back to the pool */
+static void test_recycle(struct cpdma_test *t)
+{
+	struct cpdma_chan_stats stats;
+
+	test_run_rounds(t, TEST_ROUNDS);
+
+	cpdma_chan_get_stats(t->rxchan, &stats);
+	CHECK(t, stats.frag_recycled > 0);
+	CHECK(t, stats.frag_page_alloc <= t->rxchan->frag_pool->nr_pages);
+	CHECK(t, stats.frag_alloc_fail == 0);
+	pr_info("cpdma_test: %d frames, %u pages recycled, %u allocated\n",
+		t->received, stats.frag_recycled, stats.frag_page_alloc);
+}
+
+/* the stack holds on to frames: the pool must fall back to new pages */
+static void test_held(struct cpdma_test *t)
+{
+	struct cpdma_chan_stats before, after;
+
+	cpdma_chan_get_stats(t->rxchan, &before);
+
+	t->hold = true;
+	test_run_rounds(t, TEST_NUM_HELD / TEST_BURST);
+	t->hold = false;
+	CHECK(t, t->nr_held == TEST_NUM_HELD);
+
+	cpdma_chan_get_stats(t->rxchan, &after);
+	CHECK(t, after.frag_page_alloc > before.frag_page_alloc);
+
+	/* once they are freed, recycling resumes */
+	test_release_held(t);
+	before = after;
+	test_run_rounds(t, TEST_ROUNDS);
+	cpdma_chan_get_stats(t->rxchan, &after);
+	CHECK(t, after.frag_recycled > before.frag_recycled);
+	CHECK(t, after.frag_alloc_fail == 0);
+}
+
+/*
+ * The hardware runs off the end of the queue while the last descriptor
+ * is still unprocessed: a new submit must notice the EOQ and restart
+ * the channel on itself.
+ */
+static void test_misqueue(struct cpdma_test *t)
+{
+	struct cpdma_chan_stats before, after;
+	void *frag;
+
+	cpdma_chan_get_stats(t->rxchan, &before);
+
+	t->refill = false;
+	CHECK(t, test_hw_receive(t, TEST_NUM_DESC) == TEST_NUM_DESC);
+	CHECK(t, __raw_readl(&t->regs->rxhdp[0]) == 0);
+	CHECK(t, cpdma_chan_process(t->rxchan, TEST_NUM_DESC - 1) ==
+		 TEST_NUM_DESC - 1);
+	t->refill = true;
+
+	frag = cpdma_chan_frag_alloc(t->rxchan, GFP_KERNEL);
+	if (!frag) {
+		t->errors++;
+		return;
+	}
+	CHECK(t, test_rx_submit(t, frag, GFP_KERNEL) == 0);
+
+	cpdma_chan_get_stats(t->rxchan, &after);
+	CHECK(t, after.misqueued == before.misqueued + 1);
+	CHECK(t, __raw_readl(&t->regs->rxhdp[0]) ==
+		 desc_phys(t->ctlr->pool, t->rxchan->tail));
+
+	/* the submit cleared the EOQ, so no second restart from here */
+	CHECK(t, cpdma_chan_process(t->rxchan, 1) == 1);
+	cpdma_chan_get_stats(t->rxchan, &after);
+	CHECK(t, after.requeue == before.requeue);
+	CHECK(t, t->rxchan->count == 2);
+
+	/* top the ring back up and make sure it still runs */
+	while (t->rxchan->count < TEST_NUM_DESC) {
+		frag = cpdma_chan_frag_alloc(t->rxchan, GFP_KERNEL);
+		if (!frag) {
+			t->errors++;
+			return;
+		}
+		if (test_rx_submit(t, frag, GFP_KERNEL)) {
+			t->errors++;
+			cpdma_chan_frag_free(frag);
+			return;
+		}
+	}
+	test_run_rounds(t, TEST_ROUNDS);
+}
+
+/* every buffer still queued comes back through the handler */
+static void test_teardown(struct cpdma_test *t)
+{
+	int queued = t->rxchan->count;
+
+	/* the stand-in acknowledges the teardown right away */
+	__raw_writel(CPDMA_TEARDOWN_VALUE, &t->regs->rxcp[0]);
+	CHECK(t, cpdma_ctlr_stop(t->ctlr) == 0);
+	CHECK(t, t->torn_down == queued);
+	CHECK(t, t->rxchan->head == NULL);
+	CHECK(t, t->ctlr->pool->used_desc == 0);
+}
+
+static int __init cpdma_test_init(void)
+{
+	struct cpdma_params params;
+	struct cpdma_test *t;
+	int fill_pages, ret;
+
+	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	if (!t)
+		return -ENOMEM;
+
+	ret = -ENOMEM;
+	t->regs = kzalloc(sizeof(*t->regs), GFP_KERNEL);
+	if (!t->regs)
+		goto err_regs;
+
+	t->pdev = platform_device_register_simple("cpdma-test", -1, NULL, 0);
+	if (IS_ERR(t->pdev)) {
+		ret = PTR_ERR(t->pdev);
+		goto err_pdev;
+	}
+	t->pdev->dev.coherent_dma_mask = DMA_BIT_MASK(32);
+	t->pdev->dev.dma_mask = &t->pdev->dev.coherent_dma_mask;
+
+	memset(&params, 0, sizeof(params));
+	params.dev		= &t->pdev->dev;
+	params.dmaregs		= (void __iomem *)t->regs->dma;
+	params.txhdp		= (void __iomem *)t->regs->txhdp;
+	params.rxhdp		= (void __iomem *)t->regs->rxhdp;
+	params.txcp		= (void __iomem *)t->regs->txcp;
+	params.rxcp		= (void __iomem *)t->regs->rxcp;
+	params.rxthresh		= (void __iomem *)t->regs->rxthresh;
+	params.rxfree		= (void __iomem *)t->regs->rxfree;
+	params.num_chan		= 1;
+	params.min_packet_size	= 60;
+	params.desc_align	= 16;
+	/* the pool bitmap wants a multiple of BITS_PER_LONG descriptors */
+	params.desc_mem_size	= 2 * TEST_NUM_DESC * ALIGN(sizeof(struct cpdma_desc),
+							    params.desc_align);
+
+	t->ctlr = cpdma_ctlr_create(&params);
+	if (!t->ctlr)
+		goto err_ctlr;
+
+	t->rxchan = cpdma_chan_create(t->ctlr, rx_chan_num(0),
+				      test_rx_handler, t);
+	if (IS_ERR_OR_NULL(t->rxchan)) {
+		ret = t->rxchan ? PTR_ERR(t->rxchan) : -EINVAL;
+		goto err_chan;
+	}
+
+	ret = cpdma_chan_frag_pool_create(t->rxchan, TEST_FRAG_SIZE,
+					  TEST_NUM_DESC);
+	if (ret)
+		goto err_chan;
+
+	fill_pages = DIV_ROUND_UP(TEST_NUM_DESC,
+				  PAGE_SIZE / SKB_DATA_ALIGN(TEST_FRAG_SIZE));
+	t->refill = true;
+
+	test_fill(t, fill_pages);
+	CHECK(t, cpdma_ctlr_start(t->ctlr) == 0);
+	CHECK(t, __raw_readl(&t->regs->rxhdp[0]) ==
+		 desc_phys(t->ctlr->pool, t->rxchan->head));
+	CHECK(t, __raw_readl(&t->regs->rxfree[0]) == TEST_NUM_DESC);
+	if (!t->errors)
+		test_recycle(t);
+	if (!t->errors)
+		test_held(t);
+	if (!t->errors)
+		test_misqueue(t);
+	test_teardown(t);
+
+	if (t->errors) {
+		cpdma_chan_dump(t->rxchan);
+		pr_err("cpdma_test: %d checks failed\n", t->errors);
+		ret = -EINVAL;
+	} else {
+		pr_info("cpdma_test: all tests passed, %d frames received\n",
+			t->received);
+		ret = 0;
+	}
+
+err_chan:
+	test_release_held(t);
+	cpdma_ctlr_destroy(t->ctlr);
+err_ctlr:
+	platform_device_unregister(t->pdev);
+err_pdev:
+	kfree(t->regs);
+err_regs:
+	kfree(t);
+	return ret;
+}
+
+static void __exit cpdma_test_exit(void)
+{
+}
+
+module_init(cpdma_test_init);
+module_exit(cpdma_test_exit);
+
+MODULE_DESCRIPTION("TI CPDMA software test");
+MODULE_LICENSE("GPL");
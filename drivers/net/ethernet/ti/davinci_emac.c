@@ -59,6 +59,8 @@
 #include <linux/uaccess.h>
 #include <linux/davinci_emac.h>
 
+#include <net/busy_poll.h>
+
 #include <asm/irq.h>
 #include <asm/page.h>
 
@@ -120,6 +122,12 @@ static const char emac_version_string[] = "TI DaVinci EMAC Linux v6.1";
 #define EMAC_DEF_MAX_RX_CH		(1) /* Max RX channels configured */
 #define EMAC_POLL_WEIGHT		(64) /* Default NAPI poll weight */
 
+/* RX buffers are page fragments wrapped with build_skb() on completion */
+#define EMAC_RX_HEADROOM		(NET_SKB_PAD + NET_IP_ALIGN)
+#define EMAC_RX_FRAG_SIZE		(SKB_DATA_ALIGN(EMAC_RX_HEADROOM + \
+					 EMAC_DEF_MAX_FRAME_SIZE) + \
+					 SKB_DATA_ALIGN(sizeof(struct skb_shared_info)))
+
 /* Buffer descriptor parameters */
 #define EMAC_DEF_TX_MAX_SERVICE		(32) /* TX max service BD's */
 #define EMAC_DEF_RX_MAX_SERVICE		(64) /* should = netdev->weight */
@@ -614,6 +622,72 @@ static int emac_set_coalesce(struct net_device *ndev,
 }
 
 
+static const char emac_ethtool_stats_keys[][ETH_GSTRING_LEN] = {
+	"rx_frag_recycled",
+	"rx_frag_page_alloc",
+	"rx_frag_alloc_fail",
+};
+
+#define EMAC_NUM_ETHTOOL_STATS	ARRAY_SIZE(emac_ethtool_stats_keys)
+
+/**
+ * emac_get_sset_count: Get number of EMAC ethtool strings
+ * @ndev: The DaVinci EMAC network adapter
+ * @sset: string set queried
+ *
+ * Returns the number of driver specific statistics
+ *
+ */
+static int emac_get_sset_count(struct net_device *ndev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return EMAC_NUM_ETHTOOL_STATS;
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/**
+ * emac_get_strings: Get EMAC ethtool strings
+ * @ndev: The DaVinci EMAC network adapter
+ * @stringset: string set requested
+ * @data: buffer to copy the strings to
+ *
+ */
+static void emac_get_strings(struct net_device *ndev, u32 stringset, u8 *data)
+{
+	switch (stringset) {
+	case ETH_SS_STATS:
+		memcpy(data, emac_ethtool_stats_keys,
+		       sizeof(emac_ethtool_stats_keys));
+		break;
+	}
+}
+
+/**
+ * emac_get_ethtool_stats: Get EMAC driver specific statistics
+ * @ndev: The DaVinci EMAC network adapter
+ * @stats: ethtool stats request
+ * @data: buffer to fill in
+ *
+ * Reports how well the RX page fragment pool is recycling its pages
+ *
+ */
+static void emac_get_ethtool_stats(struct net_device *ndev,
+				   struct ethtool_stats *stats, u64 *data)
+{
+	struct emac_priv *priv = netdev_priv(ndev);
+	struct cpdma_chan_stats chan_stats;
+
+	memset(&chan_stats, 0, sizeof(chan_stats));
+	cpdma_chan_get_stats(priv->rxchan, &chan_stats);
+
+	data[0] = chan_stats.frag_recycled;
+	data[1] = chan_stats.frag_page_alloc;
+	data[2] = chan_stats.frag_alloc_fail;
+}
+
 /**
  * ethtool_ops: DaVinci EMAC Ethtool structure
  *
@@ -627,6 +701,9 @@ static const struct ethtool_ops ethtool_ops = {
 	.get_link = ethtool_op_get_link,
 	.get_coalesce = emac_get_coalesce,
 	.set_coalesce =  emac_set_coalesce,
+	.get_sset_count = emac_get_sset_count,
+	.get_strings = emac_get_strings,
+	.get_ethtool_stats = emac_get_ethtool_stats,
 };
 
 /**
@@ -990,27 +1067,24 @@ static irqreturn_t emac_irq(int irq, void *dev_id)
 	return IRQ_HANDLED;
 }
 
-static struct sk_buff *emac_rx_alloc(struct emac_priv *priv)
+static int emac_rx_submit(struct emac_priv *priv, void *frag, gfp_t gfp_mask)
 {
-	struct sk_buff *skb = dev_alloc_skb(priv->rx_buf_size);
-	if (WARN_ON(!skb))
-		return NULL;
-	skb->dev = priv->ndev;
-	skb_reserve(skb, NET_IP_ALIGN);
-	return skb;
+	return cpdma_chan_submit(priv->rxchan, frag, frag + EMAC_RX_HEADROOM,
+				 priv->rx_buf_size, gfp_mask, false);
 }
 
-static void emac_rx_handler(void *token, int len, int status)
+static void emac_rx_handler(void *token, int len, int status, void *ctx)
 {
-	struct sk_buff		*skb = token;
-	struct net_device	*ndev = skb->dev;
+	void			*frag = token;
+	struct net_device	*ndev = ctx;
 	struct emac_priv	*priv = netdev_priv(ndev);
 	struct device		*emac_dev = &ndev->dev;
+	struct sk_buff		*skb;
 	int			ret;
 
 	/* free and bail if we are shutting down */
 	if (unlikely(!netif_running(ndev) || !netif_carrier_ok(ndev))) {
-		dev_kfree_skb_any(skb);
+		cpdma_chan_frag_free(frag);
 		return;
 	}
 
@@ -1020,35 +1094,42 @@ static void emac_rx_handler(void *token, int len, int status)
 		goto recycle;
 	}
 
-	/* feed received packet up the stack */
+	/* wrap the fragment and feed received packet up the stack */
+	skb = build_skb(frag, EMAC_RX_FRAG_SIZE);
+	if (unlikely(!skb)) {
+		ndev->stats.rx_dropped++;
+		goto recycle;
+	}
+	skb_reserve(skb, EMAC_RX_HEADROOM);
 	skb_put(skb, len);
 	skb->protocol = eth_type_trans(skb, ndev);
+	skb_mark_napi_id(skb, &priv->napi);
 	netif_receive_skb(skb);
 	ndev->stats.rx_bytes += len;
 	ndev->stats.rx_packets++;
 
-	/* alloc a new packet for receive */
-	skb = emac_rx_alloc(priv);
-	if (!skb) {
+	/* take a new fragment for receive */
+	frag = cpdma_chan_frag_alloc(priv->rxchan, GFP_ATOMIC);
+	if (!frag) {
 		if (netif_msg_rx_err(priv) && net_ratelimit())
 			dev_err(emac_dev, "failed rx buffer alloc\n");
 		return;
 	}
 
 recycle:
-	ret = cpdma_chan_submit(priv->rxchan, skb, skb->data,
-			skb_tailroom(skb), GFP_KERNEL);
+	ret = emac_rx_submit(priv, frag, GFP_ATOMIC);
 	if (WARN_ON(ret < 0))
-		dev_kfree_skb_any(skb);
+		cpdma_chan_frag_free(frag);
 }
 
-static void emac_tx_handler(void *token, int len, int status)
+static void emac_tx_handler(void *token, int len, int status, void *ctx)
 {
 	struct sk_buff		*skb = token;
-	struct net_device	*ndev = skb->dev;
+	struct net_device	*ndev = ctx;
 	struct emac_priv	*priv = netdev_priv(ndev);
 
 	atomic_dec(&priv->cur_tx);
+	netdev_completed_queue(ndev, 1, skb->len);
 
 	if (unlikely(netif_queue_stopped(ndev)))
 		netif_start_queue(ndev);
@@ -1072,6 +1153,8 @@ static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
 	struct device *emac_dev = &ndev->dev;
 	int ret_code;
 	struct emac_priv *priv = netdev_priv(ndev);
+	unsigned int len;
+	bool more;
 
 	/* If no link, return */
 	if (unlikely(!priv->link)) {
@@ -1089,22 +1172,37 @@ static int emac_dev_xmit(struct sk_buff *skb, struct net_device *ndev)
 
 	skb_tx_timestamp(skb);
 
-	ret_code = cpdma_chan_submit(priv->txchan, skb, skb->data, skb->len,
-				     GFP_KERNEL);
+	/* the skb may complete and be freed as soon as it is submitted */
+	len = skb->len;
+	more = skb->xmit_more;
+
+	/* let the stack batch up the head pointer write (skb->xmit_more) */
+	ret_code = cpdma_chan_submit(priv->txchan, skb, skb->data, len,
+				     GFP_KERNEL, more);
 	if (unlikely(ret_code != 0)) {
 		if (netif_msg_tx_err(priv) && net_ratelimit())
 			dev_err(emac_dev, "DaVinci EMAC: desc submit failed");
 		goto fail_tx;
 	}
+	netdev_sent_queue(ndev, len);
 
 	if (atomic_inc_return(&priv->cur_tx) >= EMAC_DEF_TX_NUM_DESC)
 		netif_stop_queue(ndev);
 
+	/*
+	 * Nothing more is handed over once the queue is stopped, be it by
+	 * us or by BQL in netdev_sent_queue(), so a start deferred for
+	 * xmit_more has to be flushed now.
+	 */
+	if (!more || netif_xmit_stopped(netdev_get_tx_queue(ndev, 0)))
+		cpdma_chan_kick(priv->txchan);
+
 	return NETDEV_TX_OK;
 
 fail_tx:
 	ndev->stats.tx_dropped++;
 	netif_stop_queue(ndev);
+	cpdma_chan_kick(priv->txchan);
 	return NETDEV_TX_BUSY;
 }
 
@@ -1131,6 +1229,7 @@ static void emac_dev_tx_timeout(struct net_device *ndev)
 	ndev->stats.tx_errors++;
 	emac_int_disable(priv);
 	cpdma_chan_stop(priv->txchan);
+	netdev_reset_queue(ndev);
 	cpdma_chan_start(priv->txchan);
 	emac_int_enable(priv);
 }
@@ -1538,7 +1637,7 @@ static int emac_dev_open(struct net_device *ndev)
 		ndev->dev_addr[cnt] = priv->mac_addr[cnt];
 
 	/* Configuration items */
-	priv->rx_buf_size = EMAC_DEF_MAX_FRAME_SIZE + NET_IP_ALIGN;
+	priv->rx_buf_size = EMAC_DEF_MAX_FRAME_SIZE;
 
 	priv->mac_hash1 = 0;
 	priv->mac_hash2 = 0;
@@ -1546,15 +1645,16 @@ static int emac_dev_open(struct net_device *ndev)
 	emac_write(EMAC_MACHASH2, 0);
 
 	for (i = 0; i < EMAC_DEF_RX_NUM_DESC; i++) {
-		struct sk_buff *skb = emac_rx_alloc(priv);
+		void *frag = cpdma_chan_frag_alloc(priv->rxchan, GFP_KERNEL);
 
-		if (!skb)
+		if (!frag)
 			break;
 
-		ret = cpdma_chan_submit(priv->rxchan, skb, skb->data,
-					skb_tailroom(skb), GFP_KERNEL);
-		if (WARN_ON(ret < 0))
+		ret = emac_rx_submit(priv, frag, GFP_KERNEL);
+		if (WARN_ON(ret < 0)) {
+			cpdma_chan_frag_free(frag);
 			break;
+		}
 	}
 
 	/* Request IRQ */
@@ -1670,6 +1770,7 @@ static int emac_dev_stop(struct net_device *ndev)
 	netif_carrier_off(ndev);
 	emac_int_disable(priv);
 	cpdma_ctlr_stop(priv->dma);
+	netdev_reset_queue(ndev);
 	emac_write(EMAC_SOFTRESET, 1);
 
 	if (priv->phydev)
@@ -1880,14 +1981,21 @@ static int __devinit davinci_emac_probe(struct platform_device *pdev)
 	}
 
 	priv->txchan = cpdma_chan_create(priv->dma, tx_chan_num(EMAC_DEF_TX_CH),
-				       emac_tx_handler);
+				       emac_tx_handler, ndev);
 	priv->rxchan = cpdma_chan_create(priv->dma, rx_chan_num(EMAC_DEF_RX_CH),
-				       emac_rx_handler);
+				       emac_rx_handler, ndev);
 	if (WARN_ON(!priv->txchan || !priv->rxchan)) {
 		rc = -ENOMEM;
 		goto no_irq_res;
 	}
 
+	rc = cpdma_chan_frag_pool_create(priv->rxchan, EMAC_RX_FRAG_SIZE,
+					 EMAC_DEF_RX_NUM_DESC);
+	if (rc) {
+		dev_err(&pdev->dev, "error creating rx buffer pool\n");
+		goto no_irq_res;
+	}
+
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 0);
 	if (!res) {
 		dev_err(&pdev->dev, "error getting irq res\n");
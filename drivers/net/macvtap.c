@@ -615,6 +615,8 @@ static int macvtap_skb_to_vnet_hdr(const struct sk_buff *skb,
 			vnet_hdr->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
 		else if (sinfo->gso_type & SKB_GSO_UDP)
 			vnet_hdr->gso_type = VIRTIO_NET_HDR_GSO_UDP;
+		else if (sinfo->gso_type & SKB_GSO_UDP_L4)
+			return -EINVAL;	/* no virtio equivalent */
 		else
 			BUG();
 		if (sinfo->gso_type & SKB_GSO_TCP_ECN)
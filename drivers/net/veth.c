@@ -13,9 +13,11 @@
 #include <linux/ethtool.h>
 #include <linux/etherdevice.h>
 #include <linux/u64_stats_sync.h>
+#include <linux/hrtimer.h>
 
 #include <net/dst.h>
 #include <net/xfrm.h>
+#include <net/busy_poll.h>
 #include <linux/veth.h>
 #include <linux/module.h>
 
@@ -37,8 +39,24 @@ struct veth_net_stats {
 struct veth_priv {
 	struct net_device *peer;
 	struct veth_net_stats __percpu *stats;
+	struct napi_struct napi;
+	struct sk_buff_head rxq;
+	struct hrtimer irq_timer;
 };
 
+/*
+ * With napi_delay set, frames are not handed to netif_rx(). They are
+ * queued to the peer instead and delivered from the peer's own napi
+ * context, which a timer schedules napi_delay usecs later, standing in
+ * for the receive interrupt of a real NIC. That context has a napi id,
+ * so sockets fed through it can busy poll it and pick frames up before
+ * the "interrupt" fires.
+ */
+static unsigned int napi_delay;
+module_param(napi_delay, uint, 0444);
+MODULE_PARM_DESC(napi_delay, "Receive through NAPI, with this emulated "
+		 "interrupt latency in usecs (0 = use netif_rx)");
+
 /*
  * ethtool interface
  */
@@ -111,12 +129,33 @@ static const struct ethtool_ops veth_ethtool_ops = {
  * xmit
  */
 
+static int veth_forward_napi(struct net_device *rcv, struct sk_buff *skb)
+{
+	struct veth_priv *rcv_priv = netdev_priv(rcv);
+
+	if (__dev_forward_skb(rcv, skb))
+		return NET_RX_DROP;
+
+	if (skb_queue_len(&rcv_priv->rxq) >= netdev_max_backlog) {
+		atomic_long_inc(&rcv->rx_dropped);
+		kfree_skb(skb);
+		return NET_RX_DROP;
+	}
+	skb_queue_tail(&rcv_priv->rxq, skb);
+
+	if (!hrtimer_active(&rcv_priv->irq_timer))
+		hrtimer_start(&rcv_priv->irq_timer,
+			      ns_to_ktime((u64)napi_delay * NSEC_PER_USEC),
+			      HRTIMER_MODE_REL);
+	return NET_RX_SUCCESS;
+}
+
 static netdev_tx_t veth_xmit(struct sk_buff *skb, struct net_device *dev)
 {
 	struct net_device *rcv = NULL;
 	struct veth_priv *priv, *rcv_priv;
 	struct veth_net_stats *stats, *rcv_stats;
-	int length;
+	int length, ret;
 
 	priv = netdev_priv(dev);
 	rcv = priv->peer;
@@ -132,7 +171,11 @@ static netdev_tx_t veth_xmit(struct sk_buff *skb, struct net_device *dev)
 		skb->ip_summed = CHECKSUM_UNNECESSARY;
 
 	length = skb->len;
-	if (dev_forward_skb(rcv, skb) != NET_RX_SUCCESS)
+	if (napi_delay)
+		ret = veth_forward_napi(rcv, skb);
+	else
+		ret = dev_forward_skb(rcv, skb);
+	if (ret != NET_RX_SUCCESS)
 		goto rx_drop;
 
 	u64_stats_update_begin(&stats->syncp);
@@ -154,6 +197,40 @@ rx_drop:
 	return NETDEV_TX_OK;
 }
 
+/*
+ * receive, napi_delay mode only
+ */
+
+static enum hrtimer_restart veth_irq_timer(struct hrtimer *timer)
+{
+	struct veth_priv *priv = container_of(timer, struct veth_priv,
+					      irq_timer);
+
+	napi_schedule(&priv->napi);
+	return HRTIMER_NORESTART;
+}
+
+static int veth_poll(struct napi_struct *napi, int budget)
+{
+	struct veth_priv *priv = container_of(napi, struct veth_priv, napi);
+	struct sk_buff *skb;
+	int done = 0;
+
+	while (done < budget && (skb = skb_dequeue(&priv->rxq)) != NULL) {
+		skb_mark_napi_id(skb, napi);
+		netif_receive_skb(skb);
+		done++;
+	}
+
+	if (done < budget) {
+		napi_complete(napi);
+		/* the timer may have fired while we still owned the context */
+		if (!skb_queue_empty(&priv->rxq))
+			napi_schedule(napi);
+	}
+	return done;
+}
+
 /*
  * general routines
  */
@@ -196,6 +273,9 @@ static int veth_open(struct net_device *dev)
 	if (priv->peer == NULL)
 		return -ENOTCONN;
 
+	if (napi_delay)
+		napi_enable(&priv->napi);
+
 	if (priv->peer->flags & IFF_UP) {
 		netif_carrier_on(dev);
 		netif_carrier_on(priv->peer);
@@ -210,6 +290,12 @@ static int veth_close(struct net_device *dev)
 	netif_carrier_off(dev);
 	netif_carrier_off(priv->peer);
 
+	if (napi_delay) {
+		napi_disable(&priv->napi);
+		hrtimer_cancel(&priv->irq_timer);
+		skb_queue_purge(&priv->rxq);
+	}
+
 	return 0;
 }
 
@@ -237,6 +323,12 @@ static int veth_dev_init(struct net_device *dev)
 
 	priv = netdev_priv(dev);
 	priv->stats = stats;
+
+	skb_queue_head_init(&priv->rxq);
+	hrtimer_init(&priv->irq_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	priv->irq_timer.function = veth_irq_timer;
+	if (napi_delay)
+		netif_napi_add(dev, &priv->napi, veth_poll, 64);
 	return 0;
 }
 
@@ -245,6 +337,8 @@ static void veth_dev_free(struct net_device *dev)
 	struct veth_priv *priv;
 
 	priv = netdev_priv(dev);
+	hrtimer_cancel(&priv->irq_timer);
+	skb_queue_purge(&priv->rxq);
 	free_percpu(priv->stats);
 	free_netdev(dev);
 }
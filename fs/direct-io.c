@@ -130,6 +130,7 @@ struct dio {
 	unsigned long refcount;		/* direct_io_worker() and bios */
 	struct bio *bio_list;		/* singly linked via bi_private */
 	struct task_struct *waiter;	/* waiting task (NULL if none) */
+	struct block_device *bio_bdev;	/* device to poll for completions */
 
 	/* AIO related stuff */
 	struct kiocb *iocb;		/* kiocb */
@@ -423,6 +424,8 @@ static inline void dio_bio_submit(struct dio *dio, struct dio_submit *sdio)
 	if (dio->is_async && dio->rw == READ)
 		bio_set_pages_dirty(bio);
 
+	dio->bio_bdev = bio->bi_bdev;
+
 	if (sdio->submit_io)
 		sdio->submit_io(dio->rw, bio, dio->inode,
 			       sdio->logical_offset_in_bio);
@@ -451,8 +454,22 @@ static inline void dio_cleanup(struct dio *dio, struct dio_submit *sdio)
  */
 static struct bio *dio_await_one(struct dio *dio)
 {
+	struct request_queue *q = NULL;
 	unsigned long flags;
 	struct bio *bio = NULL;
+	ktime_t start = ktime_set(0, 0);
+
+	/*
+	 * Poll the device of the most recently submitted bio if its queue
+	 * has polling enabled, otherwise sleep until the irq wakes us.
+	 */
+	if (dio->bio_bdev) {
+		q = bdev_get_queue(dio->bio_bdev);
+		if (blk_queue_io_poll(q))
+			start = ktime_get();
+		else
+			q = NULL;
+	}
 
 	spin_lock_irqsave(&dio->bio_lock, flags);
 
@@ -466,7 +483,8 @@ static struct bio *dio_await_one(struct dio *dio)
 		__set_current_state(TASK_UNINTERRUPTIBLE);
 		dio->waiter = current;
 		spin_unlock_irqrestore(&dio->bio_lock, flags);
-		io_schedule();
+		if (!q || !blk_poll(q, start))
+			io_schedule();
 		/* wake up sets us TASK_RUNNING */
 		spin_lock_irqsave(&dio->bio_lock, flags);
 		dio->waiter = NULL;
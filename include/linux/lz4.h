@@ -0,0 +1,68 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+/*
+ *  LZ4 Kernel Interface
+ *
+ *  LZ4 is a byte oriented LZ77 compressor: a stream of sequences, each
+ *  made of a run of literals followed by a back reference of at least
+ *  four bytes into the last 64KB of output.  See lib/lz4/lz4defs.h for
+ *  the block format.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#define LZ4_MEM_COMPRESS	(4096 * sizeof(u32))
+#define LZ4HC_MEM_COMPRESS	((1 << 15) * sizeof(u32) + 65536 * sizeof(u16))
+
+/*
+ * lz4_compressbound()
+ * Provides the maximum size that LZ4 may output in a "worst case" scenario
+ * (input data not compressible)
+ */
+static inline size_t lz4_compressbound(size_t isize)
+{
+	return isize + (isize / 255) + 16;
+}
+
+/*
+ * lz4_compress()
+ *	src     : source address of the original data
+ *	src_len : size of the original data
+ *	dst	: output buffer address of the compressed data
+ *	dst_len : is the output size, which is returned after compress done;
+ *		  on entry it holds the size of the output buffer, which
+ *		  should be at least lz4_compressbound(src_len)
+ *	workmem : address of the working memory.
+ *		This requires 'workmem' of size LZ4_MEM_COMPRESS.
+ *	return  : Success if return 0
+ *		  Error if return (< 0)
+ */
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+/*
+ * lz4hc_compress()
+ *	 Same as lz4_compress() but searches harder for matches: slower,
+ *	 with a better ratio, and decompressed by the same decoder.
+ *	 This requires 'workmem' of size LZ4HC_MEM_COMPRESS.
+ */
+int lz4hc_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem);
+
+/*
+ * lz4_decompress_safe()
+ *	src     : source address of the compressed data
+ *	src_len : is the input size, the whole compressed block
+ *	dst	: output buffer address of the decompressed data
+ *	dst_len : on entry the size of the output buffer, on return the
+ *		  number of bytes decompressed into it
+ *	return  : Success if return 0
+ *		  Error if return (< 0)
+ *	note :  Never reads or writes outside the given buffers, so
+ *		it is safe to use on untrusted input.
+ */
+int lz4_decompress_safe(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len);
+#endif
@@ -348,12 +348,17 @@ struct napi_struct {
 	struct list_head	dev_list;
 	struct sk_buff		*gro_list;
 	struct sk_buff		*skb;
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	struct hlist_node	napi_hash_node;
+	unsigned int		napi_id;
+#endif
 };
 
 enum {
 	NAPI_STATE_SCHED,	/* Poll is scheduled */
 	NAPI_STATE_DISABLE,	/* Disable pending */
 	NAPI_STATE_NPSVC,	/* Netpoll - don't dequeue from poll_list */
+	NAPI_STATE_HASHED,	/* In NAPI hash (busy polling possible) */
 };
 
 enum gro_result {
@@ -753,6 +758,10 @@ struct netdev_fcoe_hbainfo {
  *	Must return NETDEV_TX_OK , NETDEV_TX_BUSY.
  *        (can also return NETDEV_TX_LOCKED iff NETIF_F_LLTX)
  *	Required can not be NULL.
+ *	If skb->xmit_more is set, the stack is about to hand over another
+ *	packet for the same queue and the driver may postpone telling the
+ *	hardware about this one.  It must still do so if it stops the
+ *	queue or fails the transmit.
  *
  * u16 (*ndo_select_queue)(struct net_device *dev, struct sk_buff *skb);
  *	Called to decide which queue to when device supports multiple
@@ -1463,6 +1472,17 @@ void netif_napi_add(struct net_device *dev, struct napi_struct *napi,
  */
 void netif_napi_del(struct napi_struct *napi);
 
+#ifdef CONFIG_NET_RX_BUSY_POLL
+/**
+ *	napi_by_id - look up a napi context by its id
+ *	@napi_id: id handed out when the context was added
+ *
+ * Must be called under rcu_read_lock(). Used by socket busy polling to
+ * find the napi context that last fed a socket.
+ */
+extern struct napi_struct *napi_by_id(unsigned int napi_id);
+#endif
+
 struct napi_gro_cb {
 	/* Virtual address of skb_shinfo(skb)->frags[0].page + offset. */
 	void *frag0;
@@ -1893,6 +1913,22 @@ static inline int netif_xmit_frozen_or_stopped(const struct netdev_queue *dev_qu
 	return dev_queue->state & QUEUE_STATE_ANY_XOFF_OR_FROZEN;
 }
 
+/**
+ *	netdev_start_xmit - hand one packet to the driver
+ *	@skb: packet to transmit
+ *	@dev: network device
+ *	@more: more packets for the same queue follow this one
+ *
+ *	Calls ndo_start_xmit() with skb->xmit_more set from @more.
+ *	Caller must hold the tx queue lock (unless the device is LLTX).
+ */
+static inline netdev_tx_t netdev_start_xmit(struct sk_buff *skb,
+					    struct net_device *dev, bool more)
+{
+	skb->xmit_more = more ? 1 : 0;
+	return dev->netdev_ops->ndo_start_xmit(skb, dev);
+}
+
 static inline void netdev_tx_sent_queue(struct netdev_queue *dev_queue,
 					unsigned int bytes)
 {
@@ -2136,9 +2172,18 @@ extern int		dev_set_mtu(struct net_device *, int);
 extern void		dev_set_group(struct net_device *, int);
 extern int		dev_set_mac_address(struct net_device *,
 					    struct sockaddr *);
+extern struct sk_buff	*validate_xmit_skb(struct sk_buff *skb,
+					   struct net_device *dev);
+extern int		__dev_hard_start_xmit(struct sk_buff *skb,
+					      struct net_device *dev,
+					      struct netdev_queue *txq,
+					      bool more);
 extern int		dev_hard_start_xmit(struct sk_buff *skb,
 					    struct net_device *dev,
-					    struct netdev_queue *txq);
+					    struct netdev_queue *txq,
+					    bool more);
+extern int		__dev_forward_skb(struct net_device *dev,
+					  struct sk_buff *skb);
 extern int		dev_forward_skb(struct net_device *dev,
 					struct sk_buff *skb);
 
@@ -2622,6 +2667,7 @@ static inline int net_gso_ok(netdev_features_t features, int gso_type)
 	BUILD_BUG_ON(SKB_GSO_TCP_ECN != (NETIF_F_TSO_ECN >> NETIF_F_GSO_SHIFT));
 	BUILD_BUG_ON(SKB_GSO_TCPV6   != (NETIF_F_TSO6 >> NETIF_F_GSO_SHIFT));
 	BUILD_BUG_ON(SKB_GSO_FCOE    != (NETIF_F_FSO >> NETIF_F_GSO_SHIFT));
+	BUILD_BUG_ON(SKB_GSO_UDP_L4  != (NETIF_F_GSO_UDP_L4 >> NETIF_F_GSO_SHIFT));
 
 	return (features & feature) == feature;
 }
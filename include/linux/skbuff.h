@@ -231,11 +231,19 @@ enum {
  * The callback notifies userspace to release buffers when skb DMA is done in
  * lower device, the skb last reference should be 0 when calling this.
  * The desc is used to track userspace buffer index.
+ *
+ * MSG_ZEROCOPY sends share one ubuf_info between all skbs carrying data of
+ * the same sendmsg() call: refcnt counts them, id/len name the range of
+ * sends to report and zerocopy is cleared once any of the data got copied.
  */
 struct ubuf_info {
 	void (*callback)(void *);
 	void *arg;
 	unsigned long desc;
+	atomic_t refcnt;
+	u32 id;
+	u32 len;
+	bool zerocopy;
 };
 
 /* This data is invariant across clones and lives at
@@ -299,6 +307,9 @@ enum {
 	SKB_GSO_TCPV6 = 1 << 4,
 
 	SKB_GSO_FCOE = 1 << 5,
+
+	/* UDP_SEGMENT: split into whole datagrams, not IP fragments */
+	SKB_GSO_UDP_L4 = 1 << 6,
 };
 
 #if BITS_PER_LONG > 32
@@ -361,6 +372,10 @@ typedef unsigned char *sk_buff_data_t;
  *		ports.
  *	@wifi_acked_valid: wifi_acked was set
  *	@wifi_acked: whether frame was acked on wifi or not
+ *	@head_frag: skb->head is a page fragment, not a kmalloc() area
+ *	@xmit_more: more packets for this tx queue follow, the driver may
+ *		defer its doorbell (see ndo_start_xmit)
+ *	@napi_id: id of the NAPI struct this skb came from
  *	@dma_cookie: a cookie to one of several possible DMA operations
  *		done by skb DMA functions
  *	@secmark: security marking
@@ -456,11 +471,16 @@ struct sk_buff {
 	__u8			l4_rxhash:1;
 	__u8			wifi_acked_valid:1;
 	__u8			wifi_acked:1;
-	/* 10/12 bit hole (depending on ndisc_nodetype presence) */
+	__u8			head_frag:1;
+	__u8			xmit_more:1;
+	/* 8/10 bit hole (depending on ndisc_nodetype presence) */
 	kmemcheck_bitfield_end(flags2);
 
-#ifdef CONFIG_NET_DMA
-	dma_cookie_t		dma_cookie;
+#if defined CONFIG_NET_DMA || defined CONFIG_NET_RX_BUSY_POLL
+	union {
+		unsigned int	napi_id;
+		dma_cookie_t	dma_cookie;
+	};
 #endif
 #ifdef CONFIG_NETWORK_SECMARK
 	__u32			secmark;
@@ -550,7 +570,7 @@ extern void consume_skb(struct sk_buff *skb);
 extern void	       __kfree_skb(struct sk_buff *skb);
 extern struct sk_buff *__alloc_skb(unsigned int size,
 				   gfp_t priority, int fclone, int node);
-extern struct sk_buff *build_skb(void *data);
+extern struct sk_buff *build_skb(void *data, unsigned int frag_size);
 static inline struct sk_buff *alloc_skb(unsigned int size,
 					gfp_t priority)
 {
@@ -568,6 +588,15 @@ extern bool skb_recycle_check(struct sk_buff *skb, int skb_size);
 
 extern struct sk_buff *skb_morph(struct sk_buff *dst, struct sk_buff *src);
 extern int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask);
+extern struct ubuf_info *sock_zerocopy_alloc(struct sock *sk);
+extern void sock_zerocopy_callback(void *arg);
+extern void sock_zerocopy_put_abort(struct ubuf_info *uarg);
+extern int skb_zerocopy_clone(struct sk_buff *nskb, struct sk_buff *orig,
+			      gfp_t gfp_mask);
+extern int skb_zerocopy_add_user(struct sk_buff *skb, const void __user *from,
+				 int len);
+extern int skb_zerocopy_add_iovec(struct sk_buff *skb, const struct iovec *iov,
+				  int offset, int len);
 extern struct sk_buff *skb_clone(struct sk_buff *skb,
 				 gfp_t priority);
 extern struct sk_buff *skb_copy(const struct sk_buff *skb,
@@ -1596,6 +1625,67 @@ static inline void skb_orphan(struct sk_buff *skb)
 	skb->sk		= NULL;
 }
 
+/**
+ *	skb_zcopy - userspace buffer info of a zero-copy skb
+ *	@skb: buffer to check
+ *
+ *	Returns the &ubuf_info whose callback runs once @skb's data is released,
+ *	or %NULL if @skb does not point into userspace buffers.
+ */
+static inline struct ubuf_info *skb_zcopy(struct sk_buff *skb)
+{
+	if (skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY)
+		return skb_shinfo(skb)->destructor_arg;
+	return NULL;
+}
+
+/* MSG_ZEROCOPY sends are reference counted, so any number of skbs may hold
+ * on to one.  Other users of %SKBTX_DEV_ZEROCOPY expect exactly one callback.
+ */
+static inline bool skb_zcopy_refcounted(const struct ubuf_info *uarg)
+{
+	return uarg->callback == sock_zerocopy_callback;
+}
+
+/**
+ *	skb_zcopy_set - attach a MSG_ZEROCOPY send to an skb
+ *	@skb: buffer that holds (or is about to hold) the send's pages
+ *	@uarg: send from sock_zerocopy_alloc()
+ *
+ *	The skb takes its own reference on @uarg unless it already holds one.
+ */
+static inline void skb_zcopy_set(struct sk_buff *skb, struct ubuf_info *uarg)
+{
+	if (skb_zcopy(skb) == uarg)
+		return;
+	atomic_inc(&uarg->refcnt);
+	skb_shinfo(skb)->destructor_arg = uarg;
+	skb_shinfo(skb)->tx_flags |= SKBTX_DEV_ZEROCOPY;
+}
+
+/* drop the sender's own reference on a MSG_ZEROCOPY send */
+static inline void sock_zerocopy_put(struct ubuf_info *uarg)
+{
+	if (uarg)
+		sock_zerocopy_callback(uarg);
+}
+
+/**
+ *	skb_orphan_frags - stop an skb from pointing into userspace buffers
+ *	@skb: buffer to orphan
+ *	@gfp_mask: allocation priority
+ *
+ *	Must be called before an skb whose frags may belong to a sender's
+ *	buffers is held for an unbounded time, e.g. queued on a receiving
+ *	socket.  Copies the frags if needed and completes the zero-copy send.
+ */
+static inline int skb_orphan_frags(struct sk_buff *skb, gfp_t gfp_mask)
+{
+	if (likely(!skb_zcopy(skb)))
+		return 0;
+	return skb_copy_ubufs(skb, gfp_mask);
+}
+
 /**
  *	__skb_queue_purge - empty a list
  *	@list: list to empty
@@ -2499,6 +2589,9 @@ static inline bool skb_is_recycleable(const struct sk_buff *skb, int skb_size)
 	if (skb_is_nonlinear(skb) || skb->fclone != SKB_FCLONE_UNAVAILABLE)
 		return false;
 
+	if (skb->head_frag)
+		return false;
+
 	skb_size = SKB_DATA_ALIGN(skb_size + NET_SKB_PAD);
 	if (skb_end_pointer(skb) - skb->head < skb_size)
 		return false;
@@ -38,6 +38,8 @@ enum stat_item {
 	CMPXCHG_DOUBLE_FAIL,	/* Number of times that cmpxchg double did not match */
 	CPU_PARTIAL_ALLOC,	/* Used cpu partial on alloc */
 	CPU_PARTIAL_FREE,	/* USed cpu partial on free */
+	ALLOC_BULK,		/* Objects from kmem_cache_alloc_bulk */
+	FREE_BULK,		/* Objects to kmem_cache_free_bulk */
 	NR_SLUB_STAT_ITEMS };
 
 struct kmem_cache_cpu {
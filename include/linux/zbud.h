@@ -0,0 +1,22 @@
+#ifndef _LINUX_ZBUD_H
+#define _LINUX_ZBUD_H
+
+#include <linux/types.h>
+
+struct zbud_pool;
+
+struct zbud_ops {
+	int (*evict)(struct zbud_pool *pool, unsigned long handle);
+};
+
+extern struct zbud_pool *zbud_create_pool(gfp_t gfp, struct zbud_ops *ops);
+extern void zbud_destroy_pool(struct zbud_pool *pool);
+extern int zbud_alloc(struct zbud_pool *pool, int size, gfp_t gfp,
+		      unsigned long *handle);
+extern void zbud_free(struct zbud_pool *pool, unsigned long handle);
+extern int zbud_reclaim_page(struct zbud_pool *pool, unsigned int retries);
+extern void *zbud_map(struct zbud_pool *pool, unsigned long handle);
+extern void zbud_unmap(struct zbud_pool *pool, unsigned long handle);
+extern u64 zbud_get_pool_size(struct zbud_pool *pool);
+
+#endif /* _LINUX_ZBUD_H */
@@ -61,6 +61,7 @@ struct inet_connection_sock_af_ops {
 	void	    (*addr2sockaddr)(struct sock *sk, struct sockaddr *);
 	int	    (*bind_conflict)(const struct sock *sk,
 				     const struct inet_bind_bucket *tb);
+	int	    (*recv_error)(struct sock *sk, struct msghdr *msg, int len);
 };
 
 /** inet_connection_sock - INET connection oriented sock
@@ -0,0 +1,62 @@
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM tcp
+
+#if !defined(_TRACE_TCP_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_TCP_H
+
+#include <linux/tracepoint.h>
+#include <net/tcp.h>
+
+DECLARE_EVENT_CLASS(tcp_tsq,
+
+	TP_PROTO(struct sock *sk),
+
+	TP_ARGS(sk),
+
+	TP_STRUCT__entry(
+		__field(const void *, skaddr)
+		__field(__u16, sport)
+		__field(__u16, dport)
+		__field(int, wmem_alloc)
+		__field(int, limit)
+	),
+
+	TP_fast_assign(
+		__entry->skaddr = sk;
+		__entry->sport = inet_sk(sk)->inet_num;
+		__entry->dport = ntohs(inet_sk(sk)->inet_dport);
+		__entry->wmem_alloc = atomic_read(&sk->sk_wmem_alloc);
+		__entry->limit = sysctl_tcp_limit_output_bytes;
+	),
+
+	TP_printk("skaddr=%p sport=%hu dport=%hu wmem_alloc=%d limit=%d",
+		  __entry->skaddr, __entry->sport, __entry->dport,
+		  __entry->wmem_alloc, __entry->limit)
+);
+
+/*
+ * tcp_tsq_throttle: tcp_write_xmit() stopped because the socket already has
+ * tcp_limit_output_bytes queued in qdisc/device layers.
+ */
+DEFINE_EVENT(tcp_tsq, tcp_tsq_throttle,
+
+	TP_PROTO(struct sock *sk),
+
+	TP_ARGS(sk)
+);
+
+/*
+ * tcp_tsq_release: a transmit completion released a throttled socket, which
+ * is about to push more data.
+ */
+DEFINE_EVENT(tcp_tsq, tcp_tsq_release,
+
+	TP_PROTO(struct sock *sk),
+
+	TP_ARGS(sk)
+);
+
+#endif /* _TRACE_TCP_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -0,0 +1,136 @@
+/*
+ * Measure the cost of a tracepoint in a hot path.
+ *
+ * On load, the module times a tight loop around each of:
+ *
+ *  - nothing, as the baseline
+ *  - the atomic_read() test used when jump labels are not available
+ *  - a disabled static_branch()
+ *  - a disabled tracepoint
+ *  - a tracepoint with an empty probe attached
+ *
+ * and then the cost of flipping a jump label key, which patches code.
+ * Results are printed to the kernel log as nanoseconds per iteration.
+ */
+#include <linux/jump_label.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/preempt.h>
+#include <linux/tracepoint.h>
+
+DECLARE_TRACE(tp_benchmark,
+	TP_PROTO(unsigned long i),
+	TP_ARGS(i));
+DEFINE_TRACE(tp_benchmark);
+
+static unsigned long loops = 10000000;
+module_param(loops, ulong, 0444);
+MODULE_PARM_DESC(loops, "Iterations per measurement");
+
+static struct jump_label_key bench_key;
+static unsigned long bench_hits;
+
+static void tp_benchmark_probe(void *data, unsigned long i)
+{
+}
+
+static void bench_report(const char *what, ktime_t start, ktime_t end,
+			 unsigned long n)
+{
+	u64 ps = div64_u64((u64)ktime_to_ns(ktime_sub(end, start)) * 1000, n);
+	u32 frac;
+
+	ps = div_u64_rem(ps, 1000, &frac);
+	pr_info("tracepoint_benchmark: %-28s %6llu.%03u ns\n", what,
+		(unsigned long long)ps, frac);
+}
+
+/*
+ * Each loop body is kept in its own function so they all get the same
+ * code generation around the test.
+ */
+#define BENCH(name, body)						\
+static noinline void bench_##name(const char *what)			\
+{									\
+	ktime_t start, end;						\
+	unsigned long i;						\
+									\
+	preempt_disable();						\
+	start = ktime_get();						\
+	for (i = 0; i < loops; i++) {					\
+		body;							\
+		barrier();						\
+	}								\
+	end = ktime_get();						\
+	preempt_enable();						\
+									\
+	bench_report(what, start, end, loops);				\
+}
+
+BENCH(baseline, )
+BENCH(atomic, if (unlikely(atomic_read(&bench_key.enabled) > 0)) bench_hits++)
+BENCH(static_branch, if (static_branch(&bench_key)) bench_hits++)
+BENCH(tracepoint, trace_tp_benchmark(i))
+
+#define FLIPS	100
+
+static void bench_flip(void)
+{
+	ktime_t start, end;
+	int i;
+
+	start = ktime_get();
+	for (i = 0; i < FLIPS; i++) {
+		jump_label_inc(&bench_key);
+		jump_label_dec(&bench_key);
+	}
+	end = ktime_get();
+
+	bench_report("jump_label_inc+dec", start, end, FLIPS);
+}
+
+static int __init tracepoint_benchmark_init(void)
+{
+	int ret;
+
+	if (!loops)
+		return -EINVAL;
+
+	pr_info("tracepoint_benchmark: %lu iterations, jump labels %s\n",
+		loops,
+#ifdef HAVE_JUMP_LABEL
+		"enabled"
+#else
+		"not available"
+#endif
+		);
+
+	bench_baseline("empty loop");
+	bench_atomic("atomic_read() test");
+	bench_static_branch("static_branch() off");
+	bench_tracepoint("tracepoint off");
+
+	ret = register_trace_tp_benchmark(tp_benchmark_probe, NULL);
+	if (ret)
+		return ret;
+	bench_tracepoint("tracepoint on, empty probe");
+	unregister_trace_tp_benchmark(tp_benchmark_probe, NULL);
+	tracepoint_synchronize_unregister();
+
+	bench_flip();
+
+	WARN_ON(bench_hits);
+
+	return 0;
+}
+
+static void __exit tracepoint_benchmark_exit(void)
+{
+}
+
+module_init(tracepoint_benchmark_init);
+module_exit(tracepoint_benchmark_exit);
+
+MODULE_DESCRIPTION("Tracepoint and jump label overhead benchmark");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,103 @@
+/*
+ *  LZ4 fast compressor
+ *
+ *  Greedy single pass matcher: a hash of the next four bytes indexes
+ *  the last position they were seen at, and the search step grows
+ *  while no match is found so incompressible data is skipped quickly.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+#define LZ4_HASHLOG	12
+#define SKIPSTRENGTH	6
+
+static inline u32 lz4_hash(u32 seq)
+{
+	return (seq * 2654435761U) >> (32 - LZ4_HASHLOG);
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *hash_table = wrkmem;
+	const u8 *ip = src;
+	const u8 *anchor = src;
+	const u8 * const iend = src + src_len;
+	const u8 *mflimit, *matchlimit;
+	u8 *op = dst;
+	const u8 * const oend = dst + *dst_len;
+
+	if (src_len > LZ4_MAX_INPUT_SIZE)
+		return -EINVAL;
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	mflimit = iend - MFLIMIT;
+	matchlimit = iend - LASTLITERALS;
+	memset(hash_table, 0, LZ4_MEM_COMPRESS);
+
+	/* the first position can't match, just remember it */
+	ip++;
+
+	for (;;) {
+		const u8 *match;
+		unsigned int attempts = 1 << SKIPSTRENGTH;
+		size_t len;
+
+		for (;;) {
+			u32 h = lz4_hash(lz4_read32(ip));
+
+			match = src + hash_table[h];
+			hash_table[h] = ip - src;
+			if (ip - match <= MAX_DISTANCE &&
+			    lz4_read32(match) == lz4_read32(ip))
+				break;
+
+			ip += attempts++ >> SKIPSTRENGTH;
+			if (ip > mflimit)
+				goto last_literals;
+		}
+
+		/* extend the match backwards over pending literals */
+		while (ip > anchor && match > src && ip[-1] == match[-1]) {
+			ip--;
+			match--;
+		}
+
+		len = MINMATCH + lz4_count(ip + MINMATCH, match + MINMATCH,
+					   matchlimit);
+		op = lz4_encode_sequence(op, oend, anchor, ip - anchor,
+					 ip - match, len);
+		if (!op)
+			return -E2BIG;
+
+		ip += len;
+		anchor = ip;
+		if (ip > mflimit)
+			break;
+
+		/* index a position inside the match we just skipped */
+		hash_table[lz4_hash(lz4_read32(ip - 2))] = ip - 2 - src;
+	}
+
+last_literals:
+	op = lz4_encode_last_literals(op, oend, anchor, iend - anchor);
+	if (!op)
+		return -E2BIG;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Compressor");
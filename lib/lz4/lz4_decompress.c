@@ -0,0 +1,108 @@
+/*
+ *  LZ4 Decompressor
+ *
+ *  Every length read from the stream is checked against both the input
+ *  and the output buffer, so corrupted or hostile input can't make it
+ *  access memory outside of them.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+/* Add the 255-terminated extension bytes of a length to *len */
+static inline int lz4_read_length(const u8 **ipp, const u8 *iend,
+		size_t *len)
+{
+	const u8 *ip = *ipp;
+	unsigned int s;
+
+	do {
+		if (ip >= iend)
+			return -1;
+		s = *ip++;
+		*len += s;
+	} while (s == 255);
+
+	*ipp = ip;
+	return 0;
+}
+
+int lz4_decompress_safe(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len)
+{
+	const u8 *ip = src;
+	const u8 * const iend = src + src_len;
+	u8 *op = dst;
+	u8 * const oend = dst + *dst_len;
+
+	for (;;) {
+		unsigned int token;
+		size_t len, offset;
+		const u8 *match;
+
+		if (ip >= iend)
+			goto malformed;
+		token = *ip++;
+
+		/* literals */
+		len = token >> ML_BITS;
+		if (len == RUN_MASK && lz4_read_length(&ip, iend, &len))
+			goto malformed;
+		if (len > (size_t)(iend - ip) || len > (size_t)(oend - op))
+			goto malformed;
+		memcpy(op, ip, len);
+		op += len;
+		ip += len;
+
+		/* only the last sequence has no match part */
+		if (ip == iend)
+			break;
+
+		/* match */
+		if (iend - ip < 2)
+			goto malformed;
+		offset = get_unaligned_le16(ip);
+		ip += 2;
+		if (!offset || offset > (size_t)(op - dst))
+			goto malformed;
+		match = op - offset;
+
+		len = token & ML_MASK;
+		if (len == ML_MASK && lz4_read_length(&ip, iend, &len))
+			goto malformed;
+		len += MINMATCH;
+		if (len > (size_t)(oend - op))
+			goto malformed;
+
+		/* overlapping copies replicate the last offset bytes */
+		if (offset >= sizeof(u64)) {
+			while (len >= sizeof(u64)) {
+				put_unaligned(get_unaligned((const u64 *)match),
+					      (u64 *)op);
+				op += sizeof(u64);
+				match += sizeof(u64);
+				len -= sizeof(u64);
+			}
+		}
+		while (len--)
+			*op++ = *match++;
+	}
+
+	*dst_len = op - dst;
+	return 0;
+
+malformed:
+	return -EINVAL;
+}
+EXPORT_SYMBOL_GPL(lz4_decompress_safe);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
@@ -0,0 +1,145 @@
+/*
+ *  lz4defs.h -- block format and helpers shared by the LZ4 compressors
+ *  and the decompressor
+ *
+ *  An LZ4 block is a series of sequences.  Each sequence starts with a
+ *  token byte: the high nibble is the literal run length and the low
+ *  nibble the match length minus MINMATCH.  A nibble of 15 means the
+ *  length continues in following bytes, each adding 0-255, until a
+ *  byte other than 255.  The literals follow, then a 16-bit little
+ *  endian match offset and the extra match length bytes, if any.
+ *
+ *  The block ends with a sequence that has literals only.  The last
+ *  LASTLITERALS bytes are always literals and the last match starts at
+ *  least MFLIMIT bytes before the end of the block.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#define COPYLENGTH	8
+#define MINMATCH	4
+#define LASTLITERALS	5
+#define MFLIMIT		(COPYLENGTH + MINMATCH)
+#define MINLENGTH	(MFLIMIT + 1)
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+#define MAX_DISTANCE	((1 << 16) - 1)
+
+/* positions are kept as u32 offsets from the start of the input */
+#define LZ4_MAX_INPUT_SIZE	0x7E000000
+
+static inline u32 lz4_read32(const u8 *p)
+{
+	return get_unaligned((const u32 *)p);
+}
+
+/* Number of leading bytes, in memory order, that are equal in a word */
+static inline unsigned int lz4_nbcommonbytes(unsigned long diff)
+{
+#ifdef __LITTLE_ENDIAN
+	return __ffs(diff) >> 3;
+#else
+	return (BITS_PER_LONG - 1 - __fls(diff)) >> 3;
+#endif
+}
+
+/* Length of the common run at p and match, not going past limit */
+static inline size_t lz4_count(const u8 *p, const u8 *match, const u8 *limit)
+{
+	const u8 *start = p;
+
+	while (limit - p >= (long)sizeof(unsigned long)) {
+		unsigned long diff =
+			get_unaligned((const unsigned long *)match) ^
+			get_unaligned((const unsigned long *)p);
+
+		if (diff)
+			return p - start + lz4_nbcommonbytes(diff);
+		p += sizeof(unsigned long);
+		match += sizeof(unsigned long);
+	}
+	while (p < limit && *p == *match) {
+		p++;
+		match++;
+	}
+	return p - start;
+}
+
+/* Bytes needed after the token for a length whose nibble is mask */
+static inline size_t lz4_length_bytes(size_t len, size_t mask)
+{
+	return len < mask ? 0 : (len - mask) / 255 + 1;
+}
+
+static inline u8 *lz4_put_length(u8 *op, size_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = len;
+	return op;
+}
+
+/*
+ * Emit the literals [anchor, anchor + lit_len) followed by a match of
+ * match_len bytes at the given offset.  Returns the new output position,
+ * or NULL if the sequence does not fit before oend.
+ */
+static inline u8 *lz4_encode_sequence(u8 *op, const u8 *oend,
+		const u8 *anchor, size_t lit_len, size_t offset,
+		size_t match_len)
+{
+	u8 *token;
+
+	match_len -= MINMATCH;
+	if ((size_t)(oend - op) < 1 + lz4_length_bytes(lit_len, RUN_MASK) +
+				  lit_len + 2 +
+				  lz4_length_bytes(match_len, ML_MASK))
+		return NULL;
+
+	token = op++;
+	if (lit_len >= RUN_MASK) {
+		*token = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, lit_len - RUN_MASK);
+	} else
+		*token = lit_len << ML_BITS;
+
+	memcpy(op, anchor, lit_len);
+	op += lit_len;
+
+	put_unaligned_le16(offset, op);
+	op += 2;
+
+	if (match_len >= ML_MASK) {
+		*token |= ML_MASK;
+		op = lz4_put_length(op, match_len - ML_MASK);
+	} else
+		*token |= match_len;
+
+	return op;
+}
+
+/* Emit the final, literal only, sequence of a block */
+static inline u8 *lz4_encode_last_literals(u8 *op, const u8 *oend,
+		const u8 *anchor, size_t lit_len)
+{
+	if ((size_t)(oend - op) < 1 + lz4_length_bytes(lit_len, RUN_MASK) +
+				  lit_len)
+		return NULL;
+
+	if (lit_len >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		op = lz4_put_length(op, lit_len - RUN_MASK);
+	} else
+		*op++ = lit_len << ML_BITS;
+
+	memcpy(op, anchor, lit_len);
+	return op + lit_len;
+}
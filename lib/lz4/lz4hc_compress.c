@@ -0,0 +1,165 @@
+/*
+ *  LZ4 HC - high compression mode of LZ4
+ *
+ *  Every position is linked into a hash chain and up to MAX_ATTEMPTS
+ *  candidates are compared for the longest match.  A match is only
+ *  taken after checking that the next position doesn't start a longer
+ *  one.  The output is a plain LZ4 block.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2 as
+ *  published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+#define LZ4HC_HASHLOG	15
+#define MAX_ATTEMPTS	256
+
+/*
+ * hash_table holds the last position (plus one, zero meaning none) with
+ * a given hash.  chain_table, indexed by position modulo 64KB, holds the
+ * distance back to the previous position with the same hash, zero ending
+ * the chain.
+ */
+struct lz4hc_data {
+	const u8 *base;
+	const u8 *next_to_update;
+	u32 *hash_table;
+	u16 *chain_table;
+};
+
+static inline u32 lz4hc_hash(u32 seq)
+{
+	return (seq * 2654435761U) >> (32 - LZ4HC_HASHLOG);
+}
+
+static void lz4hc_insert(struct lz4hc_data *hc, const u8 *ip)
+{
+	const u8 *p;
+
+	for (p = hc->next_to_update; p < ip; p++) {
+		u32 pos = p - hc->base;
+		u32 h = lz4hc_hash(lz4_read32(p));
+		u32 prev = hc->hash_table[h];
+		u32 delta = 0;
+
+		if (prev && pos + 1 - prev <= MAX_DISTANCE)
+			delta = pos + 1 - prev;
+		hc->chain_table[(u16)pos] = delta;
+		hc->hash_table[h] = pos + 1;
+	}
+	hc->next_to_update = ip;
+}
+
+static size_t lz4hc_find_longest_match(struct lz4hc_data *hc,
+		const u8 *ip, const u8 *matchlimit, const u8 **matchpos)
+{
+	unsigned int attempts = MAX_ATTEMPTS;
+	size_t best = 0;
+	u32 ref;
+
+	lz4hc_insert(hc, ip);
+	ref = hc->hash_table[lz4hc_hash(lz4_read32(ip))];
+
+	while (ref && attempts--) {
+		const u8 *match = hc->base + ref - 1;
+		u16 delta;
+
+		if (ip - match > MAX_DISTANCE)
+			break;
+
+		if (match[best] == ip[best] &&
+		    lz4_read32(match) == lz4_read32(ip)) {
+			size_t len = MINMATCH + lz4_count(ip + MINMATCH,
+					match + MINMATCH, matchlimit);
+
+			if (len > best) {
+				best = len;
+				*matchpos = match;
+				if (ip + len == matchlimit)
+					break;
+			}
+		}
+
+		delta = hc->chain_table[(u16)(ref - 1)];
+		if (!delta)
+			break;
+		ref -= delta;
+	}
+
+	return best;
+}
+
+int lz4hc_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	struct lz4hc_data hc;
+	const u8 *ip = src;
+	const u8 *anchor = src;
+	const u8 * const iend = src + src_len;
+	const u8 *mflimit, *matchlimit;
+	u8 *op = dst;
+	const u8 * const oend = dst + *dst_len;
+
+	if (src_len > LZ4_MAX_INPUT_SIZE)
+		return -EINVAL;
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	mflimit = iend - MFLIMIT;
+	matchlimit = iend - LASTLITERALS;
+
+	hc.base = src;
+	hc.next_to_update = src;
+	hc.hash_table = wrkmem;
+	hc.chain_table = wrkmem + (1 << LZ4HC_HASHLOG) * sizeof(u32);
+	memset(hc.hash_table, 0, (1 << LZ4HC_HASHLOG) * sizeof(u32));
+
+	while (ip <= mflimit) {
+		const u8 *match, *match2;
+		size_t len, len2;
+
+		len = lz4hc_find_longest_match(&hc, ip, matchlimit, &match);
+		if (!len) {
+			ip++;
+			continue;
+		}
+
+		/* lazy evaluation: prefer a longer match one byte later */
+		while (ip + 1 <= mflimit) {
+			len2 = lz4hc_find_longest_match(&hc, ip + 1, matchlimit,
+							&match2);
+			if (len2 <= len)
+				break;
+			ip++;
+			len = len2;
+			match = match2;
+		}
+
+		op = lz4_encode_sequence(op, oend, anchor, ip - anchor,
+					 ip - match, len);
+		if (!op)
+			return -E2BIG;
+
+		ip += len;
+		anchor = ip;
+	}
+
+last_literals:
+	op = lz4_encode_last_literals(op, oend, anchor, iend - anchor);
+	if (!op)
+		return -E2BIG;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL_GPL(lz4hc_compress);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4HC Compressor");
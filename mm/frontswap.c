@@ -0,0 +1,163 @@
+/*
+ * Frontswap frontend
+ *
+ * This code provides the generic "frontend" layer to call a matching
+ * "backend" driver implementation of frontswap, in the same way
+ * cleancache does for clean page cache pages.  See
+ * Documentation/vm/zswap.txt for an example backend.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ */
+
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/swapops.h>
+#include <linux/frontswap.h>
+
+/*
+ * Read on every swap in and swap out, so kept as a global flag rather
+ * than a pointer compare, as for cleancache_enabled.
+ */
+int frontswap_enabled;
+EXPORT_SYMBOL(frontswap_enabled);
+
+/*
+ * frontswap_ops is set by frontswap_register_ops to contain the pointers
+ * to the frontswap "backend" implementation functions.
+ */
+static struct frontswap_ops frontswap_ops;
+
+/* useful stats available in /sys/kernel/mm/frontswap */
+static unsigned long frontswap_succ_puts;
+static unsigned long frontswap_failed_puts;
+static unsigned long frontswap_succ_gets;
+static unsigned long frontswap_failed_gets;
+static unsigned long frontswap_flushes;
+
+/*
+ * register operations for frontswap, returning previous thus allowing
+ * detection of multiple backends and possible nesting
+ */
+struct frontswap_ops frontswap_register_ops(struct frontswap_ops *ops)
+{
+	struct frontswap_ops old = frontswap_ops;
+
+	frontswap_ops = *ops;
+	frontswap_enabled = 1;
+	return old;
+}
+EXPORT_SYMBOL(frontswap_register_ops);
+
+/* Called when a swap device is swapon'd, before it accepts any pages */
+void __frontswap_init(unsigned type)
+{
+	(*frontswap_ops.init)(type);
+}
+EXPORT_SYMBOL(__frontswap_init);
+
+/*
+ * Offer a locked swap cache page to the backend.  Returns 0 if the
+ * backend took it, in which case the page need not be written to the
+ * swap device.  If it was refused, any older copy the backend holds for
+ * the same slot is stale and is dropped.
+ */
+int __frontswap_put_page(struct page *page)
+{
+	swp_entry_t entry = { .val = page_private(page), };
+	unsigned type = swp_type(entry);
+	pgoff_t offset = swp_offset(entry);
+	int ret;
+
+	BUG_ON(!PageLocked(page));
+	ret = (*frontswap_ops.put_page)(type, offset, page);
+	if (ret == 0) {
+		frontswap_succ_puts++;
+	} else {
+		(*frontswap_ops.flush_page)(type, offset);
+		frontswap_failed_puts++;
+	}
+	return ret;
+}
+EXPORT_SYMBOL(__frontswap_put_page);
+
+/*
+ * Ask the backend to fill a locked swap cache page.  Returns 0 on
+ * success, otherwise the caller reads it from the swap device.
+ */
+int __frontswap_get_page(struct page *page)
+{
+	swp_entry_t entry = { .val = page_private(page), };
+	int ret;
+
+	BUG_ON(!PageLocked(page));
+	ret = (*frontswap_ops.get_page)(swp_type(entry), swp_offset(entry),
+					page);
+	if (ret == 0)
+		frontswap_succ_gets++;
+	else
+		frontswap_failed_gets++;
+	return ret;
+}
+EXPORT_SYMBOL(__frontswap_get_page);
+
+/* Called with swap_lock held when a swap slot is freed */
+void __frontswap_flush_page(unsigned type, pgoff_t offset)
+{
+	(*frontswap_ops.flush_page)(type, offset);
+	frontswap_flushes++;
+}
+EXPORT_SYMBOL(__frontswap_flush_page);
+
+/* Called at swapoff, once no slot of the device is in use any more */
+void __frontswap_flush_area(unsigned type)
+{
+	(*frontswap_ops.flush_area)(type);
+}
+EXPORT_SYMBOL(__frontswap_flush_area);
+
+#ifdef CONFIG_SYSFS
+
+#define FRONTSWAP_SYSFS_RO(_name) \
+	static ssize_t frontswap_##_name##_show(struct kobject *kobj, \
+				struct kobj_attribute *attr, char *buf) \
+	{ \
+		return sprintf(buf, "%lu\n", frontswap_##_name); \
+	} \
+	static struct kobj_attribute frontswap_##_name##_attr = { \
+		.attr = { .name = __stringify(_name), .mode = 0444 }, \
+		.show = frontswap_##_name##_show, \
+	}
+
+FRONTSWAP_SYSFS_RO(succ_puts);
+FRONTSWAP_SYSFS_RO(failed_puts);
+FRONTSWAP_SYSFS_RO(succ_gets);
+FRONTSWAP_SYSFS_RO(failed_gets);
+FRONTSWAP_SYSFS_RO(flushes);
+
+static struct attribute *frontswap_attrs[] = {
+	&frontswap_succ_puts_attr.attr,
+	&frontswap_failed_puts_attr.attr,
+	&frontswap_succ_gets_attr.attr,
+	&frontswap_failed_gets_attr.attr,
+	&frontswap_flushes_attr.attr,
+	NULL,
+};
+
+static struct attribute_group frontswap_attr_group = {
+	.attrs = frontswap_attrs,
+	.name = "frontswap",
+};
+
+#endif /* CONFIG_SYSFS */
+
+static int __init init_frontswap(void)
+{
+	int err = 0;
+
+#ifdef CONFIG_SYSFS
+	err = sysfs_create_group(mm_kobj, &frontswap_attr_group);
+#endif /* CONFIG_SYSFS */
+	return err;
+}
+module_init(init_frontswap)
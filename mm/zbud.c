@@ -0,0 +1,376 @@
+/*
+ * zbud.c - buddied allocator for compressed pages
+ *
+ * zbud stores at most two compressed objects ("buddies") in each page
+ * it allocates: one packed against the start of the page, right after a
+ * small header, and one packed against its end.  That caps the density
+ * at two objects per page, but keeps fragmentation trivially bounded and
+ * makes reclaim simple: evicting a page means evicting at most two
+ * objects, after which the whole page can be handed back.
+ *
+ * Objects are accounted in chunks of PAGE_SIZE / NCHUNKS bytes.  Pages
+ * holding a single buddy sit on unbuddied[n], n being the number of free
+ * chunks left, so a new object is placed in the fullest page it fits in.
+ * All pages are also kept on an LRU list from which zbud_reclaim_page()
+ * picks its victims, calling back into the user to evict each buddy.
+ *
+ * Handles are the kernel virtual address of the object, so pages come
+ * from lowmem and zbud_map() is free.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/zbud.h>
+
+#define NCHUNKS_ORDER	6
+
+#define CHUNK_SHIFT	(PAGE_SHIFT - NCHUNKS_ORDER)
+#define CHUNK_SIZE	(1 << CHUNK_SHIFT)
+#define NCHUNKS		(PAGE_SIZE >> CHUNK_SHIFT)
+#define ZHDR_SIZE_ALIGNED CHUNK_SIZE
+
+/**
+ * struct zbud_pool - a pool of zbud pages
+ * @lock:	protects all fields and the headers of all pages in the pool
+ * @unbuddied:	pages with one free buddy, indexed by their free chunks
+ * @buddied:	pages with both buddies in use
+ * @lru:	all pages, most recently allocated into first
+ * @pages_nr:	number of pages in the pool
+ * @ops:	user callbacks, evict is needed for zbud_reclaim_page()
+ */
+struct zbud_pool {
+	spinlock_t lock;
+	struct list_head unbuddied[NCHUNKS];
+	struct list_head buddied;
+	struct list_head lru;
+	u64 pages_nr;
+	struct zbud_ops *ops;
+};
+
+/*
+ * struct zbud_header - header at the start of each zbud page
+ * @buddy:	link into the pool's unbuddied or buddied list
+ * @lru:	link into the pool's lru list
+ * @first_chunks:	size of the first buddy in chunks, 0 if free
+ * @last_chunks:	size of the last buddy in chunks, 0 if free
+ * @under_reclaim:	set while zbud_reclaim_page() owns the page
+ */
+struct zbud_header {
+	struct list_head buddy;
+	struct list_head lru;
+	unsigned int first_chunks;
+	unsigned int last_chunks;
+	bool under_reclaim;
+};
+
+enum buddy {
+	FIRST,
+	LAST
+};
+
+static int size_to_chunks(int size)
+{
+	return (size + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+}
+
+#define for_each_unbuddied_list(_iter, _begin) \
+	for ((_iter) = (_begin); (_iter) < NCHUNKS; (_iter)++)
+
+static struct zbud_header *init_zbud_page(struct page *page)
+{
+	struct zbud_header *zhdr = page_address(page);
+
+	zhdr->first_chunks = 0;
+	zhdr->last_chunks = 0;
+	INIT_LIST_HEAD(&zhdr->buddy);
+	INIT_LIST_HEAD(&zhdr->lru);
+	zhdr->under_reclaim = false;
+	return zhdr;
+}
+
+static void free_zbud_page(struct zbud_header *zhdr)
+{
+	__free_page(virt_to_page(zhdr));
+}
+
+/*
+ * The first buddy starts right after the header, the last one ends at
+ * the end of the page; either way the handle is the object's address.
+ */
+static unsigned long encode_handle(struct zbud_header *zhdr, enum buddy bud)
+{
+	unsigned long handle = (unsigned long)zhdr;
+
+	if (bud == FIRST)
+		handle += ZHDR_SIZE_ALIGNED;
+	else
+		handle += PAGE_SIZE - (zhdr->last_chunks << CHUNK_SHIFT);
+	return handle;
+}
+
+static struct zbud_header *handle_to_zbud_header(unsigned long handle)
+{
+	return (struct zbud_header *)(handle & PAGE_MASK);
+}
+
+/* the header takes up one chunk */
+static int num_free_chunks(struct zbud_header *zhdr)
+{
+	return NCHUNKS - zhdr->first_chunks - zhdr->last_chunks - 1;
+}
+
+/* put a page that is not under reclaim back on the right buddy list */
+static void zbud_relist(struct zbud_pool *pool, struct zbud_header *zhdr)
+{
+	if (zhdr->first_chunks == 0 || zhdr->last_chunks == 0)
+		list_add(&zhdr->buddy,
+			 &pool->unbuddied[num_free_chunks(zhdr)]);
+	else
+		list_add(&zhdr->buddy, &pool->buddied);
+}
+
+/**
+ * zbud_create_pool() - create a new zbud pool
+ * @gfp:	flags for allocating the pool structure itself
+ * @ops:	user callbacks, may be NULL if reclaim is never used
+ *
+ * Returns the new pool, or NULL on allocation failure.
+ */
+struct zbud_pool *zbud_create_pool(gfp_t gfp, struct zbud_ops *ops)
+{
+	struct zbud_pool *pool;
+	int i;
+
+	pool = kmalloc(sizeof(*pool), gfp);
+	if (!pool)
+		return NULL;
+	spin_lock_init(&pool->lock);
+	for (i = 0; i < NCHUNKS; i++)
+		INIT_LIST_HEAD(&pool->unbuddied[i]);
+	INIT_LIST_HEAD(&pool->buddied);
+	INIT_LIST_HEAD(&pool->lru);
+	pool->pages_nr = 0;
+	pool->ops = ops;
+	return pool;
+}
+EXPORT_SYMBOL_GPL(zbud_create_pool);
+
+/**
+ * zbud_destroy_pool() - destroy an empty zbud pool
+ * @pool:	pool to destroy, all of its objects must have been freed
+ */
+void zbud_destroy_pool(struct zbud_pool *pool)
+{
+	WARN_ON(pool->pages_nr);
+	kfree(pool);
+}
+EXPORT_SYMBOL_GPL(zbud_destroy_pool);
+
+/**
+ * zbud_alloc() - allocate an object from a zbud pool
+ * @pool:	pool to allocate from
+ * @size:	size of the object in bytes
+ * @gfp:	flags used if a new page has to be allocated
+ * @handle:	returns the handle of the new object
+ *
+ * Returns 0 on success, -EINVAL for a bad size or highmem @gfp, -ENOSPC
+ * if @size is too large to ever share a page, or -ENOMEM.
+ */
+int zbud_alloc(struct zbud_pool *pool, int size, gfp_t gfp,
+	       unsigned long *handle)
+{
+	struct zbud_header *zhdr = NULL;
+	enum buddy bud;
+	struct page *page;
+	int chunks, i;
+
+	if (size <= 0 || (gfp & __GFP_HIGHMEM))
+		return -EINVAL;
+	if (size > PAGE_SIZE - ZHDR_SIZE_ALIGNED - CHUNK_SIZE)
+		return -ENOSPC;
+	chunks = size_to_chunks(size);
+
+	spin_lock(&pool->lock);
+
+	/* first try the fullest page that still has room */
+	for_each_unbuddied_list(i, chunks) {
+		if (!list_empty(&pool->unbuddied[i])) {
+			zhdr = list_first_entry(&pool->unbuddied[i],
+						struct zbud_header, buddy);
+			list_del(&zhdr->buddy);
+			bud = zhdr->first_chunks == 0 ? FIRST : LAST;
+			goto found;
+		}
+	}
+
+	spin_unlock(&pool->lock);
+	page = alloc_page(gfp);
+	if (!page)
+		return -ENOMEM;
+	spin_lock(&pool->lock);
+	pool->pages_nr++;
+	zhdr = init_zbud_page(page);
+	bud = FIRST;
+
+found:
+	if (bud == FIRST)
+		zhdr->first_chunks = chunks;
+	else
+		zhdr->last_chunks = chunks;
+	zbud_relist(pool, zhdr);
+
+	/* most recently used goes to the head of the lru */
+	if (!list_empty(&zhdr->lru))
+		list_del(&zhdr->lru);
+	list_add(&zhdr->lru, &pool->lru);
+
+	*handle = encode_handle(zhdr, bud);
+	spin_unlock(&pool->lock);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(zbud_alloc);
+
+/**
+ * zbud_free() - free an object
+ * @pool:	pool the object was allocated from
+ * @handle:	handle returned by zbud_alloc()
+ *
+ * If the page is being reclaimed, only the object is marked free and
+ * zbud_reclaim_page() takes care of the page.
+ */
+void zbud_free(struct zbud_pool *pool, unsigned long handle)
+{
+	struct zbud_header *zhdr;
+
+	spin_lock(&pool->lock);
+	zhdr = handle_to_zbud_header(handle);
+
+	/* the first buddy always sits right after the header */
+	if ((handle - ZHDR_SIZE_ALIGNED) & ~PAGE_MASK)
+		zhdr->last_chunks = 0;
+	else
+		zhdr->first_chunks = 0;
+
+	if (zhdr->under_reclaim) {
+		spin_unlock(&pool->lock);
+		return;
+	}
+
+	list_del(&zhdr->buddy);
+	if (zhdr->first_chunks == 0 && zhdr->last_chunks == 0) {
+		list_del(&zhdr->lru);
+		free_zbud_page(zhdr);
+		pool->pages_nr--;
+	} else {
+		zbud_relist(pool, zhdr);
+	}
+
+	spin_unlock(&pool->lock);
+}
+EXPORT_SYMBOL_GPL(zbud_free);
+
+/**
+ * zbud_reclaim_page() - evict the least recently used page of a pool
+ * @pool:	pool to reclaim from
+ * @retries:	number of pages to try before giving up
+ *
+ * Takes the page at the tail of the lru list and calls the user's evict
+ * callback for each of its buddies.  The callback is expected to write
+ * the object out elsewhere and zbud_free() it, or to return non-zero.
+ * If both buddies end up free the page is released and 0 returned,
+ * otherwise the page goes back to the head of the lru and the next one
+ * is tried.
+ *
+ * Returns 0 if a page was freed, -EINVAL if the pool cannot be reclaimed
+ * from and -EAGAIN if @retries pages were tried without success.
+ */
+int zbud_reclaim_page(struct zbud_pool *pool, unsigned int retries)
+{
+	unsigned long first_handle, last_handle;
+	struct zbud_header *zhdr;
+	unsigned int i;
+
+	spin_lock(&pool->lock);
+	if (!pool->ops || !pool->ops->evict || list_empty(&pool->lru) ||
+	    retries == 0) {
+		spin_unlock(&pool->lock);
+		return -EINVAL;
+	}
+	for (i = 0; i < retries; i++) {
+		zhdr = list_entry(pool->lru.prev, struct zbud_header, lru);
+		list_del(&zhdr->lru);
+		list_del(&zhdr->buddy);
+		zhdr->under_reclaim = true;
+		/*
+		 * Encode the handles before dropping the lock: a racing
+		 * zbud_free() may clear the chunk counts they are built from.
+		 */
+		first_handle = 0;
+		last_handle = 0;
+		if (zhdr->first_chunks)
+			first_handle = encode_handle(zhdr, FIRST);
+		if (zhdr->last_chunks)
+			last_handle = encode_handle(zhdr, LAST);
+		spin_unlock(&pool->lock);
+
+		if (first_handle && pool->ops->evict(pool, first_handle))
+			goto next;
+		if (last_handle)
+			pool->ops->evict(pool, last_handle);
+next:
+		spin_lock(&pool->lock);
+		zhdr->under_reclaim = false;
+		if (zhdr->first_chunks == 0 && zhdr->last_chunks == 0) {
+			free_zbud_page(zhdr);
+			pool->pages_nr--;
+			spin_unlock(&pool->lock);
+			return 0;
+		}
+		zbud_relist(pool, zhdr);
+		list_add(&zhdr->lru, &pool->lru);
+	}
+	spin_unlock(&pool->lock);
+	return -EAGAIN;
+}
+EXPORT_SYMBOL_GPL(zbud_reclaim_page);
+
+/**
+ * zbud_map() - get the address of an object
+ * @pool:	pool the object belongs to
+ * @handle:	handle of the object
+ */
+void *zbud_map(struct zbud_pool *pool, unsigned long handle)
+{
+	return (void *)handle;
+}
+EXPORT_SYMBOL_GPL(zbud_map);
+
+/**
+ * zbud_unmap() - release an address obtained with zbud_map()
+ * @pool:	pool the object belongs to
+ * @handle:	handle of the object
+ */
+void zbud_unmap(struct zbud_pool *pool, unsigned long handle)
+{
+}
+EXPORT_SYMBOL_GPL(zbud_unmap);
+
+/**
+ * zbud_get_pool_size() - number of pages currently held by a pool
+ * @pool:	pool to query
+ */
+u64 zbud_get_pool_size(struct zbud_pool *pool)
+{
+	return pool->pages_nr;
+}
+EXPORT_SYMBOL_GPL(zbud_get_pool_size);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Buddy allocator for compressed pages");
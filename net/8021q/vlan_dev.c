@@ -160,7 +160,7 @@ static netdev_tx_t vlan_dev_hard_start_xmit(struct sk_buff *skb,
 	skb_set_dev(skb, vlan_dev_priv(dev)->real_dev);
 	len = skb->len;
 	if (netpoll_tx_running(dev))
-		return skb->dev->netdev_ops->ndo_start_xmit(skb, skb->dev);
+		return netdev_start_xmit(skb, skb->dev, false);
 	ret = dev_queue_xmit(skb);
 
 	if (likely(ret == NET_XMIT_SUCCESS || ret == NET_XMIT_CN)) {
@@ -157,6 +157,7 @@
 #include <linux/etherdevice.h>
 #include <linux/kthread.h>
 #include <linux/prefetch.h>
+#include <linux/percpu.h>
 #include <net/net_namespace.h>
 #include <net/checksum.h>
 #include <net/ipv6.h>
@@ -197,6 +198,18 @@
 #define F_QUEUE_MAP_RND (1<<13)	/* queue map Random */
 #define F_QUEUE_MAP_CPU (1<<14)	/* queue map mirrors smp_processor_id() */
 #define F_NODE          (1<<15)	/* Node memory alloc*/
+#define F_RX_LATENCY    (1<<16)	/* Rx injection latency histograms */
+
+/* Xmit modes */
+#define M_START_XMIT		0	/* Default normal TX */
+#define M_NETIF_RECEIVE		1	/* Inject packets into stack */
+#define M_GRO_RECEIVE		2	/* Inject packets through GRO */
+
+/* Rx injection latency stages, in log2(ns) buckets */
+#define PKTGEN_STAGE_RECEIVE	0	/* netif_receive_skb/napi_gro_receive */
+#define PKTGEN_STAGE_GRO_FLUSH	1	/* napi_gro_flush, once per burst */
+#define PKTGEN_NR_STAGES	2
+#define PKTGEN_LAT_BUCKETS	20
 
 /* Thread control flag bits */
 #define T_STOP        (1<<0)	/* Stop run */
@@ -284,6 +297,18 @@ struct pktgen_dev {
 				 * before creating a new packet,
 				 * set clone_skb to 1024.
 				 */
+	unsigned int burst;	/* number of duplicated packets to burst,
+				 * flagged with skb->xmit_more but the last
+				 */
+	int xmit_mode;		/* M_START_XMIT, or inject into the local
+				 * receive path (M_NETIF_RECEIVE,
+				 * M_GRO_RECEIVE) as if odev received it
+				 */
+	struct napi_struct napi;	/* GRO context for M_GRO_RECEIVE,
+					 * registered on odev
+					 */
+	unsigned int __percpu *rx_processed; /* softnet processed counts */
+	u64 lat_hist[PKTGEN_NR_STAGES][PKTGEN_LAT_BUCKETS];
 
 	char dst_min[IP_NAME_SZ];	/* IP, ie 1.2.3.4 */
 	char dst_max[IP_NAME_SZ];	/* IP, ie 1.2.3.4 */
@@ -527,6 +552,32 @@ static const struct file_operations pktgen_fops = {
 	.release = single_release,
 };
 
+static void pktgen_show_lat_hist(struct seq_file *seq,
+				 const struct pktgen_dev *pkt_dev)
+{
+	static const char * const stage_names[PKTGEN_NR_STAGES] = {
+		[PKTGEN_STAGE_RECEIVE]	 = "receive",
+		[PKTGEN_STAGE_GRO_FLUSH] = "gro_flush",
+	};
+	int stage, b;
+
+	for (stage = 0; stage < PKTGEN_NR_STAGES; stage++) {
+		seq_printf(seq, "     %s latency (ns):", stage_names[stage]);
+		for (b = 0; b < PKTGEN_LAT_BUCKETS; b++) {
+			u64 n = pkt_dev->lat_hist[stage][b];
+
+			if (!n)
+				continue;
+			seq_printf(seq, " %s%llu:%llu",
+				   b == PKTGEN_LAT_BUCKETS - 1 ? ">=" : "<",
+				   b == PKTGEN_LAT_BUCKETS - 1 ?
+				   1ULL << (b - 1) : 1ULL << b,
+				   (unsigned long long)n);
+		}
+		seq_puts(seq, "\n");
+	}
+}
+
 static int pktgen_if_show(struct seq_file *seq, void *v)
 {
 	const struct pktgen_dev *pkt_dev = seq->private;
@@ -546,6 +597,14 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 	seq_printf(seq, "     flows: %u flowlen: %u\n", pkt_dev->cflows,
 		   pkt_dev->lflow);
 
+	if (pkt_dev->burst > 1)
+		seq_printf(seq, "     burst: %u\n", pkt_dev->burst);
+
+	if (pkt_dev->xmit_mode != M_START_XMIT)
+		seq_printf(seq, "     xmit_mode: %s\n",
+			   pkt_dev->xmit_mode == M_GRO_RECEIVE ?
+			   "gro_receive" : "netif_receive");
+
 	seq_printf(seq,
 		   "     queue_map_min: %u  queue_map_max: %u\n",
 		   pkt_dev->queue_map_min,
@@ -674,6 +733,9 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 	if (pkt_dev->flags & F_NODE)
 		seq_printf(seq, "NODE_ALLOC  ");
 
+	if (pkt_dev->flags & F_RX_LATENCY)
+		seq_printf(seq, "RX_LATENCY  ");
+
 	seq_puts(seq, "\n");
 
 	/* not really stopped, more like last-running-at */
@@ -712,6 +774,10 @@ static int pktgen_if_show(struct seq_file *seq, void *v)
 
 	seq_printf(seq, "     flows: %u\n", pkt_dev->nflows);
 
+	if (pkt_dev->xmit_mode != M_START_XMIT &&
+	    (pkt_dev->flags & F_RX_LATENCY))
+		pktgen_show_lat_hist(seq, pkt_dev);
+
 	if (pkt_dev->result[0])
 		seq_printf(seq, "Result: %s\n", pkt_dev->result);
 	else
@@ -1070,7 +1136,7 @@ static ssize_t pktgen_if_write(struct file *file,
 		len = num_arg(&user_buffer[i], 10, &value);
 		if (len < 0)
 			return len;
-		if ((value > 0) &&
+		if ((value > 0) && pkt_dev->xmit_mode == M_START_XMIT &&
 		    (!(pkt_dev->odev->priv_flags & IFF_TX_SKB_SHARING)))
 			return -ENOTSUPP;
 		i += len;
@@ -1079,6 +1145,52 @@ static ssize_t pktgen_if_write(struct file *file,
 		sprintf(pg_result, "OK: clone_skb=%d", pkt_dev->clone_skb);
 		return count;
 	}
+	if (!strcmp(name, "burst")) {
+		len = num_arg(&user_buffer[i], 10, &value);
+		if (len < 0)
+			return len;
+		if ((value > 1) && pkt_dev->xmit_mode == M_START_XMIT &&
+		    (!(pkt_dev->odev->priv_flags & IFF_TX_SKB_SHARING)))
+			return -ENOTSUPP;
+		i += len;
+		pkt_dev->burst = value < 1 ? 1 : value;
+		sprintf(pg_result, "OK: burst=%u", pkt_dev->burst);
+		return count;
+	}
+	if (!strcmp(name, "xmit_mode")) {
+		char f[32];
+
+		memset(f, 0, 32);
+		len = strn_len(&user_buffer[i], sizeof(f) - 1);
+		if (len < 0)
+			return len;
+
+		if (copy_from_user(f, &user_buffer[i], len))
+			return -EFAULT;
+		i += len;
+
+		if (strcmp(f, "start_xmit") == 0) {
+			pkt_dev->xmit_mode = M_START_XMIT;
+			/* received packets are cloned, transmitted ones are
+			 * shared: drop settings the device cannot handle
+			 */
+			if (!(pkt_dev->odev->priv_flags & IFF_TX_SKB_SHARING)) {
+				pkt_dev->clone_skb = 0;
+				pkt_dev->burst = 1;
+			}
+		} else if (strcmp(f, "netif_receive") == 0) {
+			pkt_dev->xmit_mode = M_NETIF_RECEIVE;
+		} else if (strcmp(f, "gro_receive") == 0) {
+			pkt_dev->xmit_mode = M_GRO_RECEIVE;
+		} else {
+			sprintf(pg_result,
+				"xmit_mode -:%s:- unknown\nAvailable modes: %s",
+				f, "start_xmit, netif_receive, gro_receive\n");
+			return count;
+		}
+		sprintf(pg_result, "OK: xmit_mode=%s", f);
+		return count;
+	}
 	if (!strcmp(name, "count")) {
 		len = num_arg(&user_buffer[i], 10, &value);
 		if (len < 0)
@@ -1235,12 +1347,18 @@ static ssize_t pktgen_if_write(struct file *file,
 		else if (strcmp(f, "!NODE_ALLOC") == 0)
 			pkt_dev->flags &= ~F_NODE;
 
+		else if (strcmp(f, "RX_LATENCY") == 0)
+			pkt_dev->flags |= F_RX_LATENCY;
+
+		else if (strcmp(f, "!RX_LATENCY") == 0)
+			pkt_dev->flags &= ~F_RX_LATENCY;
+
 		else {
 			sprintf(pg_result,
 				"Flag -:%s:- unknown\nAvailable flags, (prepend ! to un-set flag):\n%s",
 				f,
 				"IPSRC_RND, IPDST_RND, UDPSRC_RND, UDPDST_RND, "
-				"MACSRC_RND, MACDST_RND, TXSIZE_RND, IPV6, MPLS_RND, VID_RND, SVID_RND, FLOW_SEQ, IPSEC, NODE_ALLOC\n");
+				"MACSRC_RND, MACDST_RND, TXSIZE_RND, IPV6, MPLS_RND, VID_RND, SVID_RND, FLOW_SEQ, IPSEC, NODE_ALLOC, RX_LATENCY\n");
 			return count;
 		}
 		sprintf(pg_result, "OK: flags=0x%x", pkt_dev->flags);
@@ -1969,6 +2087,20 @@ static struct net_device *pktgen_dev_get_by_name(struct pktgen_dev *pkt_dev,
 }
 
 
+/* The GRO context is never scheduled, pktgen_rx_inject() flushes it */
+static int pktgen_napi_poll(struct napi_struct *napi, int budget)
+{
+	return 0;
+}
+
+/* Dis-associate pktgen_dev from its device. */
+static void pktgen_put_dev(struct pktgen_dev *pkt_dev)
+{
+	netif_napi_del(&pkt_dev->napi);
+	dev_put(pkt_dev->odev);
+	pkt_dev->odev = NULL;
+}
+
 /* Associate pktgen_dev with a device. */
 
 static int pktgen_setup_dev(struct pktgen_dev *pkt_dev, const char *ifname)
@@ -1977,10 +2109,8 @@ static int pktgen_setup_dev(struct pktgen_dev *pkt_dev, const char *ifname)
 	int err;
 
 	/* Clean old setups */
-	if (pkt_dev->odev) {
-		dev_put(pkt_dev->odev);
-		pkt_dev->odev = NULL;
-	}
+	if (pkt_dev->odev)
+		pktgen_put_dev(pkt_dev);
 
 	odev = pktgen_dev_get_by_name(pkt_dev, ifname);
 	if (!odev) {
@@ -1996,6 +2126,7 @@ static int pktgen_setup_dev(struct pktgen_dev *pkt_dev, const char *ifname)
 		err = -ENETDOWN;
 	} else {
 		pkt_dev->odev = odev;
+		netif_napi_add(odev, &pkt_dev->napi, pktgen_napi_poll, 64);
 		return 0;
 	}
 
@@ -2980,11 +3111,18 @@ static struct sk_buff *fill_packet(struct net_device *odev,
 
 static void pktgen_clear_counters(struct pktgen_dev *pkt_dev)
 {
+	int cpu;
+
 	pkt_dev->seq_num = 1;
 	pkt_dev->idle_acc = 0;
 	pkt_dev->sofar = 0;
 	pkt_dev->tx_bytes = 0;
 	pkt_dev->errors = 0;
+
+	memset(pkt_dev->lat_hist, 0, sizeof(pkt_dev->lat_hist));
+	for_each_possible_cpu(cpu)
+		*per_cpu_ptr(pkt_dev->rx_processed, cpu) =
+			per_cpu(softnet_data, cpu).processed;
 }
 
 /* Set up structure for sending pkts, clear counters */
@@ -3153,6 +3291,34 @@ static void show_results(struct pktgen_dev *pkt_dev, int nr_frags)
 		     (unsigned long long)mbps,
 		     (unsigned long long)bps,
 		     (unsigned long long)pkt_dev->errors);
+
+	if (pkt_dev->xmit_mode != M_START_XMIT) {
+		int cpu;
+
+		/* packets the stack processed on each cpu (including RPS
+		 * targets) while we were injecting
+		 */
+		for_each_possible_cpu(cpu) {
+			size_t left = sizeof(pkt_dev->result) -
+				      (p - pkt_dev->result);
+			unsigned int n = per_cpu(softnet_data, cpu).processed -
+					 *per_cpu_ptr(pkt_dev->rx_processed, cpu);
+			int len;
+
+			if (!n)
+				continue;
+			pps = div64_u64((u64)n * NSEC_PER_SEC,
+					ktime_to_ns(elapsed));
+			len = snprintf(p, left, "\n  rx cpu%d: %u pkts %llupps",
+				       cpu, n, (unsigned long long)pps);
+			/* out of room: keep the lines that fit whole */
+			if (len >= left) {
+				*p = '\0';
+				break;
+			}
+			p += len;
+		}
+	}
 }
 
 /* Set stopped-at timer, remove from running list, do counters & statistics */
@@ -3293,11 +3459,69 @@ static void pktgen_wait_for_skb(struct pktgen_dev *pkt_dev)
 	pkt_dev->idle_acc += ktime_to_ns(ktime_sub(ktime_now(), idle_start));
 }
 
+static void pktgen_lat_record(struct pktgen_dev *pkt_dev, int stage,
+			      ktime_t start)
+{
+	u64 ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	int b = min_t(int, fls64(ns), PKTGEN_LAT_BUCKETS - 1);
+
+	pkt_dev->lat_hist[stage][b]++;
+}
+
+/*
+ * Feed the current packet to the local receive path as if odev had just
+ * received it, from a softirq-like context.  Every injected packet is a
+ * clone of pkt_dev->skb, so the stack is free to consume or keep it.
+ */
+static void pktgen_rx_inject(struct pktgen_dev *pkt_dev, unsigned int burst)
+{
+	bool gro = pkt_dev->xmit_mode == M_GRO_RECEIVE;
+	bool lat = pkt_dev->flags & F_RX_LATENCY;
+	struct sk_buff *skb;
+	ktime_t start;
+	int ret;
+
+	local_bh_disable();
+	while (burst--) {
+		skb = skb_clone(pkt_dev->skb, GFP_ATOMIC);
+		if (unlikely(!skb)) {
+			pkt_dev->errors++;
+			pkt_dev->last_ok = 0;
+			break;
+		}
+		skb->protocol = eth_type_trans(skb, skb->dev);
+
+		if (lat)
+			start = ktime_get();
+		if (gro)
+			ret = napi_gro_receive(&pkt_dev->napi, skb) == GRO_DROP ?
+			      NET_RX_DROP : NET_RX_SUCCESS;
+		else
+			ret = netif_receive_skb(skb);
+		if (lat)
+			pktgen_lat_record(pkt_dev, PKTGEN_STAGE_RECEIVE, start);
+
+		if (ret == NET_RX_DROP)
+			pkt_dev->errors++;
+		pkt_dev->last_ok = 1;
+		pkt_dev->sofar++;
+		pkt_dev->seq_num++;
+		pkt_dev->tx_bytes += pkt_dev->last_pkt_size;
+	}
+	if (gro) {
+		if (lat)
+			start = ktime_get();
+		napi_gro_flush(&pkt_dev->napi);
+		if (lat)
+			pktgen_lat_record(pkt_dev, PKTGEN_STAGE_GRO_FLUSH, start);
+	}
+	local_bh_enable();
+}
+
 static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 {
+	unsigned int burst = ACCESS_ONCE(pkt_dev->burst);
 	struct net_device *odev = pkt_dev->odev;
-	netdev_tx_t (*xmit)(struct sk_buff *, struct net_device *)
-		= odev->netdev_ops->ndo_start_xmit;
 	struct netdev_queue *txq;
 	u16 queue_map;
 	int ret;
@@ -3337,6 +3561,11 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 	if (pkt_dev->delay && pkt_dev->last_ok)
 		spin(pkt_dev, pkt_dev->next_tx);
 
+	if (pkt_dev->xmit_mode != M_START_XMIT) {
+		pktgen_rx_inject(pkt_dev, burst);
+		goto out;
+	}
+
 	queue_map = skb_get_queue_mapping(pkt_dev->skb);
 	txq = netdev_get_tx_queue(odev, queue_map);
 
@@ -3347,8 +3576,10 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 		pkt_dev->last_ok = 0;
 		goto unlock;
 	}
-	atomic_inc(&(pkt_dev->skb->users));
-	ret = (*xmit)(pkt_dev->skb, odev);
+	atomic_add(burst, &pkt_dev->skb->users);
+
+xmit_more:
+	ret = netdev_start_xmit(pkt_dev->skb, odev, --burst > 0);
 
 	switch (ret) {
 	case NETDEV_TX_OK:
@@ -3357,6 +3588,8 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 		pkt_dev->sofar++;
 		pkt_dev->seq_num++;
 		pkt_dev->tx_bytes += pkt_dev->last_pkt_size;
+		if (burst > 0 && !netif_xmit_frozen_or_stopped(txq))
+			goto xmit_more;
 		break;
 	case NET_XMIT_DROP:
 	case NET_XMIT_CN:
@@ -3375,9 +3608,11 @@ static void pktgen_xmit(struct pktgen_dev *pkt_dev)
 		atomic_dec(&(pkt_dev->skb->users));
 		pkt_dev->last_ok = 0;
 	}
+	if (unlikely(burst))
+		atomic_sub(burst, &pkt_dev->skb->users);
 unlock:
 	__netif_tx_unlock_bh(txq);
-
+out:
 	/* If pkt_dev->count is zero, then run forever */
 	if ((pkt_dev->count != 0) && (pkt_dev->sofar >= pkt_dev->count)) {
 		pktgen_wait_for_skb(pkt_dev);
@@ -3556,7 +3791,15 @@ static int pktgen_add_device(struct pktgen_thread *t, const char *ifname)
 	pkt_dev->removal_mark = 0;
 	pkt_dev->min_pkt_size = ETH_ZLEN;
 	pkt_dev->max_pkt_size = ETH_ZLEN;
+	pkt_dev->rx_processed = alloc_percpu(unsigned int);
+	if (!pkt_dev->rx_processed) {
+		vfree(pkt_dev->flows);
+		kfree(pkt_dev);
+		return -ENOMEM;
+	}
+
 	pkt_dev->nfrags = 0;
+	pkt_dev->burst = 1;
 	pkt_dev->delay = pg_delay_d;
 	pkt_dev->count = pg_count_d;
 	pkt_dev->sofar = 0;
@@ -3593,11 +3836,12 @@ static int pktgen_add_device(struct pktgen_thread *t, const char *ifname)
 
 	return add_dev_to_thread(t, pkt_dev);
 out2:
-	dev_put(pkt_dev->odev);
+	pktgen_put_dev(pkt_dev);
 out1:
 #ifdef CONFIG_XFRM
 	free_SAs(pkt_dev);
 #endif
+	free_percpu(pkt_dev->rx_processed);
 	vfree(pkt_dev->flows);
 	kfree(pkt_dev);
 	return err;
@@ -3683,10 +3927,8 @@ static int pktgen_remove_device(struct pktgen_thread *t,
 
 	/* Dis-associate from the interface */
 
-	if (pkt_dev->odev) {
-		dev_put(pkt_dev->odev);
-		pkt_dev->odev = NULL;
-	}
+	if (pkt_dev->odev)
+		pktgen_put_dev(pkt_dev);
 
 	/* And update the thread if_list */
 
@@ -3698,6 +3940,7 @@ static int pktgen_remove_device(struct pktgen_thread *t,
 #ifdef CONFIG_XFRM
 	free_SAs(pkt_dev);
 #endif
+	free_percpu(pkt_dev->rx_processed);
 	vfree(pkt_dev->flows);
 	if (pkt_dev->page)
 		put_page(pkt_dev->page);
@@ -18,6 +18,7 @@
 #include <linux/vmalloc.h>
 
 #include <net/request_sock.h>
+#include <net/tcp.h>
 
 /*
  * Maximum number of SYN_RECV sockets in queue per LISTEN socket.
@@ -130,3 +131,34 @@ void reqsk_queue_destroy(struct request_sock_queue *queue)
 		kfree(lopt);
 }
 
+/*
+ * This function is called to release the request sock of a Fast Open
+ * child, either when the 3WHS finishes (or is aborted) or when the child
+ * is destroyed before that. The req is co-owned by the listener (through
+ * its accept queue) and the child, so it is only freed here once the
+ * child has been accept()ed, i.e. req->sk has been cleared.
+ */
+void reqsk_fastopen_remove(struct sock *sk, struct request_sock *req)
+{
+	struct sock *lsk = tcp_rsk(req)->listener;
+	struct fastopen_queue *fastopenq =
+	    inet_csk(lsk)->icsk_accept_queue.fastopenq;
+	bool accepted;
+
+	tcp_sk(sk)->fastopen_rsk = NULL;
+	spin_lock_bh(&fastopenq->lock);
+	fastopenq->qlen--;
+	tcp_rsk(req)->listener = NULL;
+	/* If the child socket hasn't been accepted yet, inet_csk_accept()
+	 * will free the req for us.
+	 */
+	accepted = (req->sk == NULL);
+	spin_unlock_bh(&fastopenq->lock);
+
+	/* Drops the reference taken in tcp_v4_conn_req_fastopen(); this
+	 * may free fastopenq, so it must come after the unlock.
+	 */
+	sock_put(lsk);
+	if (accepted)
+		reqsk_free(req);
+}
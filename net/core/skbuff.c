@@ -247,9 +247,11 @@ EXPORT_SYMBOL(__alloc_skb);
 /**
  * build_skb - build a network buffer
  * @data: data buffer provided by caller
+ * @frag_size: size of fragment, or 0 if head was kmalloced
  *
  * Allocate a new &sk_buff. Caller provides space holding head and
- * skb_shared_info. @data must have been allocated by kmalloc()
+ * skb_shared_info. @data must have been allocated by kmalloc() only if
+ * @frag_size is 0, otherwise data should come from the page allocator.
  * The return is the new skb buffer.
  * On a failure the return is %NULL, and @data is not freed.
  * Notes :
@@ -260,20 +262,21 @@ EXPORT_SYMBOL(__alloc_skb);
  *  before giving packet to stack.
  *  RX rings only contains data buffers, not full skbs.
  */
-struct sk_buff *build_skb(void *data)
+struct sk_buff *build_skb(void *data, unsigned int frag_size)
 {
 	struct skb_shared_info *shinfo;
 	struct sk_buff *skb;
-	unsigned int size;
+	unsigned int size = frag_size ? : ksize(data);
 
 	skb = kmem_cache_alloc(skbuff_head_cache, GFP_ATOMIC);
 	if (!skb)
 		return NULL;
 
-	size = ksize(data) - SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
+	size -= SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
 
 	memset(skb, 0, offsetof(struct sk_buff, tail));
 	skb->truesize = SKB_TRUESIZE(size);
+	skb->head_frag = frag_size != 0;
 	atomic_set(&skb->users, 1);
 	skb->head = data;
 	skb->data = data;
@@ -378,6 +381,14 @@ static void skb_clone_fraglist(struct sk_buff *skb)
 		skb_get(list);
 }
 
+static void skb_free_head(struct sk_buff *skb)
+{
+	if (skb->head_frag)
+		put_page(virt_to_head_page(skb->head));
+	else
+		kfree(skb->head);
+}
+
 static void skb_release_data(struct sk_buff *skb)
 {
 	if (!skb->cloned ||
@@ -404,7 +415,7 @@ static void skb_release_data(struct sk_buff *skb)
 		if (skb_has_frag_list(skb))
 			skb_drop_fraglist(skb);
 
-		kfree(skb->head);
+		skb_free_head(skb);
 	}
 }
 
@@ -621,6 +632,9 @@ static void __copy_skb_header(struct sk_buff *new, const struct sk_buff *old)
 	new->vlan_tci		= old->vlan_tci;
 
 	skb_copy_secmark(new, old);
+#ifdef CONFIG_NET_RX_BUSY_POLL
+	new->napi_id	= old->napi_id;
+#endif
 }
 
 /*
@@ -641,10 +655,12 @@ static struct sk_buff *__skb_clone(struct sk_buff *n, struct sk_buff *skb)
 	n->hdr_len = skb->nohdr ? skb_headroom(skb) : skb->hdr_len;
 	n->cloned = 1;
 	n->nohdr = 0;
+	n->xmit_more = 0;
 	n->destructor = NULL;
 	C(tail);
 	C(end);
 	C(head);
+	C(head_frag);
 	C(data);
 	C(truesize);
 	atomic_set(&n->users, 1);
@@ -690,10 +706,22 @@ EXPORT_SYMBOL_GPL(skb_morph);
 int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask)
 {
 	int i;
-	int num_frags = skb_shinfo(skb)->nr_frags;
+	int num_frags;
 	struct page *page, *head = NULL;
 	struct ubuf_info *uarg = skb_shinfo(skb)->destructor_arg;
 
+	/* Clones share skb_shinfo() and may be in flight, e.g. on a device
+	 * queue: unclone first rather than replacing their frags under them.
+	 * Only MSG_ZEROCOPY sends can be cloned at all, see skb_clone().
+	 */
+	if (skb_cloned(skb)) {
+		if (skb_shared(skb) || WARN_ON_ONCE(!skb_zcopy_refcounted(uarg)))
+			return -EINVAL;
+		if (pskb_expand_head(skb, 0, 0, gfp_mask))
+			return -ENOMEM;
+	}
+
+	num_frags = skb_shinfo(skb)->nr_frags;
 	for (i = 0; i < num_frags; i++) {
 		u8 *vaddr;
 		skb_frag_t *f = &skb_shinfo(skb)->frags[i];
@@ -719,6 +747,7 @@ int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask)
 	for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
 		skb_frag_unref(skb, i);
 
+	uarg->zerocopy = false;
 	uarg->callback(uarg);
 
 	/* skb frags point to kernel buffers */
@@ -732,6 +761,289 @@ int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask)
 	return 0;
 }
 
+/*
+ * MSG_ZEROCOPY completion notifications.
+ *
+ * Every sendmsg() call with MSG_ZEROCOPY on a socket with SO_ZEROCOPY gets
+ * the next 32-bit id of the socket.  Once the last skb pointing into its
+ * buffers is gone, a struct sock_extended_err with ee_origin
+ * SO_EE_ORIGIN_ZEROCOPY and the range [ee_info, ee_data] of completed ids
+ * is queued on the socket error queue.  Consecutive completions with the
+ * same ee_code are merged into one notification.
+ *
+ * The ubuf_info lives in the cb of the skb that will carry the
+ * notification, so completing never needs to allocate memory.  That skb is
+ * charged to sk_omem_alloc and keeps a reference on the socket.
+ */
+static void sock_zerocopy_ofree(struct sk_buff *skb)
+{
+	atomic_sub(skb->truesize, &skb->sk->sk_omem_alloc);
+}
+
+/**
+ *	sock_zerocopy_alloc - start a MSG_ZEROCOPY send
+ *	@sk: sending socket
+ *
+ *	Returns a &ubuf_info holding one reference for the caller, who drops
+ *	it with sock_zerocopy_callback() when done queueing data, or with
+ *	sock_zerocopy_put_abort() if nothing was sent.  Returns %NULL when
+ *	the socket option memory limit is exhausted.
+ */
+struct ubuf_info *sock_zerocopy_alloc(struct sock *sk)
+{
+	struct ubuf_info *uarg;
+	struct sk_buff *skb;
+
+	BUILD_BUG_ON(sizeof(*uarg) > sizeof(skb->cb));
+
+	if (atomic_read(&sk->sk_omem_alloc) + SKB_TRUESIZE(0) >
+	    sysctl_optmem_max)
+		return NULL;
+
+	skb = alloc_skb(0, sk->sk_allocation);
+	if (!skb)
+		return NULL;
+
+	skb->sk = sk;
+	skb->destructor = sock_zerocopy_ofree;
+	atomic_add(skb->truesize, &sk->sk_omem_alloc);
+	sock_hold(sk);
+
+	uarg = (struct ubuf_info *)skb->cb;
+	uarg->callback = sock_zerocopy_callback;
+	uarg->arg = skb;
+	uarg->desc = 0;
+	uarg->id = (u32)atomic_inc_return(&sk->sk_zckey) - 1;
+	uarg->len = 1;
+	uarg->zerocopy = true;
+	atomic_set(&uarg->refcnt, 1);
+
+	return uarg;
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_alloc);
+
+static bool skb_zerocopy_notify_extend(struct sk_buff *skb, u32 lo, u32 len,
+				       u8 code)
+{
+	struct sock_exterr_skb *serr = SKB_EXT_ERR(skb);
+	u32 old_lo = serr->ee.ee_info, old_hi = serr->ee.ee_data;
+
+	if (serr->ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY ||
+	    serr->ee.ee_code != code)
+		return false;
+
+	/* the range must stay contiguous and must not wrap */
+	if (lo != old_hi + 1 || (u64)old_hi - old_lo + 1 + len > 0xFFFFFFFFULL)
+		return false;
+
+	serr->ee.ee_data += len;
+	return true;
+}
+
+/**
+ *	sock_zerocopy_callback - drop a reference on a MSG_ZEROCOPY send
+ *	@arg: the send's &ubuf_info
+ *
+ *	Called for each skb releasing the send's buffers and once by the
+ *	sender itself.  The last reference queues the completion.
+ */
+void sock_zerocopy_callback(void *arg)
+{
+	struct ubuf_info *uarg = arg;
+	struct sk_buff *tail, *skb = uarg->arg;
+	struct sock_exterr_skb *serr;
+	struct sock *sk = skb->sk;
+	struct sk_buff_head *q;
+	unsigned long flags;
+	u32 lo, len;
+	u8 code;
+
+	if (!atomic_dec_and_test(&uarg->refcnt))
+		return;
+
+	/* an aborted send is not reported at all */
+	if (!uarg->len || sock_flag(sk, SOCK_DEAD))
+		goto release;
+
+	lo = uarg->id;
+	len = uarg->len;
+	code = uarg->zerocopy ? 0 : SO_EE_CODE_ZEROCOPY_COPIED;
+
+	/* uarg lives in skb->cb: it is dead from here on */
+	serr = SKB_EXT_ERR(skb);
+	memset(serr, 0, sizeof(*serr));
+	serr->ee.ee_errno = 0;
+	serr->ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+	serr->ee.ee_code = code;
+	serr->ee.ee_info = lo;
+	serr->ee.ee_data = lo + len - 1;
+
+	q = &sk->sk_error_queue;
+	spin_lock_irqsave(&q->lock, flags);
+	tail = skb_peek_tail(q);
+	if (!tail || !skb_zerocopy_notify_extend(tail, lo, len, code)) {
+		__skb_queue_tail(q, skb);
+		skb = NULL;
+	}
+	spin_unlock_irqrestore(&q->lock, flags);
+
+	sk->sk_error_report(sk);
+
+release:
+	consume_skb(skb);
+	sock_put(sk);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_callback);
+
+/**
+ *	sock_zerocopy_put_abort - drop the sender's reference after a failure
+ *	@uarg: send from sock_zerocopy_alloc(), may be %NULL
+ *
+ *	For sends that did not queue any data: gives the id back to the socket
+ *	so that ids stay contiguous, and suppresses the notification.
+ */
+void sock_zerocopy_put_abort(struct ubuf_info *uarg)
+{
+	struct sk_buff *skb;
+
+	if (!uarg)
+		return;
+
+	skb = uarg->arg;
+	atomic_dec(&skb->sk->sk_zckey);
+	uarg->len = 0;
+	sock_zerocopy_callback(uarg);
+}
+EXPORT_SYMBOL_GPL(sock_zerocopy_put_abort);
+
+/**
+ *	skb_zerocopy_clone - share a zero-copy skb's buffers with another skb
+ *	@nskb: buffer about to receive frags of @orig
+ *	@orig: buffer that may point into userspace buffers
+ *	@gfp_mask: allocation priority
+ *
+ *	Must be called before frags are moved or referenced from @orig into
+ *	@nskb.  MSG_ZEROCOPY sends are reference counted, so @nskb simply
+ *	holds on to the send as well.  Other users of %SKBTX_DEV_ZEROCOPY
+ *	expect exactly one callback, so @orig's frags are copied instead.
+ *
+ *	Returns 0 on success or a negative error code on failure to allocate
+ *	kernel memory to copy to.
+ */
+int skb_zerocopy_clone(struct sk_buff *nskb, struct sk_buff *orig,
+		       gfp_t gfp_mask)
+{
+	struct ubuf_info *uarg = skb_zcopy(orig);
+
+	if (!uarg)
+		return 0;
+
+	if (!skb_zcopy_refcounted(uarg))
+		return skb_copy_ubufs(orig, gfp_mask);
+
+	if (skb_zcopy(nskb) && skb_zcopy(nskb) != uarg &&
+	    skb_copy_ubufs(nskb, gfp_mask))
+		return -ENOMEM;
+
+	skb_zcopy_set(nskb, uarg);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(skb_zerocopy_clone);
+
+/**
+ *	skb_zerocopy_add_user - append userspace memory to an skb's frags
+ *	@skb: buffer to append to
+ *	@from: userspace address of the data
+ *	@len: number of bytes to append
+ *
+ *	Pins the pages backing @from and appends them as frags, extending the
+ *	last frag where the memory is contiguous.  Stops early when @skb runs
+ *	out of frag slots.  Updates len and data_len; charging truesize and
+ *	attaching a &ubuf_info are up to the caller.
+ *
+ *	Returns the number of bytes appended (0 if @skb has no free frag slot)
+ *	or -EFAULT.
+ */
+int skb_zerocopy_add_user(struct sk_buff *skb, const void __user *from,
+			  int len)
+{
+	struct page *pages[MAX_SKB_FRAGS];
+	unsigned long addr = (unsigned long)from;
+	int i = skb_shinfo(skb)->nr_frags;
+	int npages, j, copied = 0;
+
+	if (i == MAX_SKB_FRAGS)
+		return 0;
+
+	npages = DIV_ROUND_UP((addr & ~PAGE_MASK) + len, PAGE_SIZE);
+	npages = min_t(int, npages, MAX_SKB_FRAGS - i);
+	npages = get_user_pages_fast(addr, npages, 0, pages);
+	if (npages <= 0)
+		return -EFAULT;
+
+	for (j = 0; j < npages; j++) {
+		int off = addr & ~PAGE_MASK;
+		int size = min_t(int, len, PAGE_SIZE - off);
+
+		if (skb_can_coalesce(skb, i, pages[j], off)) {
+			skb_frag_size_add(&skb_shinfo(skb)->frags[i - 1], size);
+			put_page(pages[j]);
+		} else {
+			skb_fill_page_desc(skb, i++, pages[j], off, size);
+		}
+		addr += size;
+		len -= size;
+		copied += size;
+	}
+
+	skb->len += copied;
+	skb->data_len += copied;
+	return copied;
+}
+EXPORT_SYMBOL_GPL(skb_zerocopy_add_user);
+
+/**
+ *	skb_zerocopy_add_iovec - append part of an iovec to an skb's frags
+ *	@skb: buffer to append to
+ *	@iov: iovec holding the data
+ *	@offset: offset into the iovec to start at
+ *	@len: number of bytes to append
+ *
+ *	Like skb_zerocopy_add_user(), for data spread over an iovec.
+ */
+int skb_zerocopy_add_iovec(struct sk_buff *skb, const struct iovec *iov,
+			   int offset, int len)
+{
+	int copied = 0;
+
+	while (offset >= iov->iov_len) {
+		offset -= iov->iov_len;
+		iov++;
+	}
+
+	while (len > 0) {
+		int seg = min_t(int, len, iov->iov_len - offset);
+
+		if (seg) {
+			int n = skb_zerocopy_add_user(skb,
+						      iov->iov_base + offset,
+						      seg);
+
+			if (n < 0)
+				return n;
+			copied += n;
+			len -= n;
+			if (n < seg)
+				break;
+		}
+		offset = 0;
+		iov++;
+	}
+
+	return copied;
+}
+EXPORT_SYMBOL_GPL(skb_zerocopy_add_iovec);
+
 
 /**
  *	skb_clone	-	duplicate an sk_buff
@@ -749,12 +1061,15 @@ int skb_copy_ubufs(struct sk_buff *skb, gfp_t gfp_mask)
 
 struct sk_buff *skb_clone(struct sk_buff *skb, gfp_t gfp_mask)
 {
+	struct ubuf_info *uarg = skb_zcopy(skb);
 	struct sk_buff *n;
 
-	if (skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY) {
-		if (skb_copy_ubufs(skb, gfp_mask))
-			return NULL;
-	}
+	/* The clone shares skb_shinfo(), and with it the reference on a
+	 * MSG_ZEROCOPY send; any other zero-copy skb is copied first.
+	 */
+	if (uarg && !skb_zcopy_refcounted(uarg) &&
+	    skb_copy_ubufs(skb, gfp_mask))
+		return NULL;
 
 	n = skb + 1;
 	if (skb->fclone == SKB_FCLONE_ORIG &&
@@ -874,12 +1189,10 @@ struct sk_buff *__pskb_copy(struct sk_buff *skb, int headroom, gfp_t gfp_mask)
 	if (skb_shinfo(skb)->nr_frags) {
 		int i;
 
-		if (skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY) {
-			if (skb_copy_ubufs(skb, gfp_mask)) {
-				kfree_skb(n);
-				n = NULL;
-				goto out;
-			}
+		if (skb_zerocopy_clone(n, skb, gfp_mask)) {
+			kfree_skb(n);
+			n = NULL;
+			goto out;
 		}
 		for (i = 0; i < skb_shinfo(skb)->nr_frags; i++) {
 			skb_shinfo(n)->frags[i] = skb_shinfo(skb)->frags[i];
@@ -941,7 +1254,7 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 		fastpath = atomic_read(&skb_shinfo(skb)->dataref) == delta;
 	}
 
-	if (fastpath &&
+	if (fastpath && !skb->head_frag &&
 	    size + sizeof(struct skb_shared_info) <= ksize(skb->head)) {
 		memmove(skb->head + size, skb_shinfo(skb),
 			offsetof(struct skb_shared_info,
@@ -956,6 +1269,20 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 	if (!data)
 		goto nodata;
 
+	/* The new shinfo copied below points at the same frags as the old
+	 * one, which the clones keep using: it needs a reference on the send
+	 * of its own.  Do this before the copy, skb_copy_ubufs() changes the
+	 * frags.
+	 */
+	if (!fastpath && skb_zcopy(skb)) {
+		struct ubuf_info *uarg = skb_zcopy(skb);
+
+		if (skb_zcopy_refcounted(uarg))
+			atomic_inc(&uarg->refcnt);
+		else if (skb_copy_ubufs(skb, gfp_mask))
+			goto nofrags;
+	}
+
 	/* Copy only real data... and, alas, header. This should be
 	 * optimized for the cases when header is void.
 	 */
@@ -966,13 +1293,8 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 	       offsetof(struct skb_shared_info, frags[skb_shinfo(skb)->nr_frags]));
 
 	if (fastpath) {
-		kfree(skb->head);
+		skb_free_head(skb);
 	} else {
-		/* copy this zero copy skb frags */
-		if (skb_shinfo(skb)->tx_flags & SKBTX_DEV_ZEROCOPY) {
-			if (skb_copy_ubufs(skb, gfp_mask))
-				goto nofrags;
-		}
 		for (i = 0; i < skb_shinfo(skb)->nr_frags; i++)
 			skb_frag_ref(skb, i);
 
@@ -984,6 +1306,7 @@ int pskb_expand_head(struct sk_buff *skb, int nhead, int ntail,
 	off = (data + nhead) - skb->head;
 
 	skb->head     = data;
+	skb->head_frag = 0;
 adjust_others:
 	skb->data    += off;
 #ifdef NET_SKBUFF_DATA_USES_OFFSET
@@ -2256,6 +2579,8 @@ void skb_split(struct sk_buff *skb, struct sk_buff *skb1, const u32 len)
 {
 	int pos = skb_headlen(skb);
 
+	/* only TCP splits skbs, and its zero-copy sends are refcounted */
+	skb_zerocopy_clone(skb1, skb, GFP_ATOMIC);
 	if (len < pos)	/* Split line is inside header. */
 		skb_split_inside_header(skb, skb1, len, pos);
 	else		/* Second chunk has no header, nothing to copy. */
@@ -2298,6 +2623,10 @@ int skb_shift(struct sk_buff *tgt, struct sk_buff *skb, int shiftlen)
 	BUG_ON(shiftlen > skb->len);
 	BUG_ON(skb_headlen(skb));	/* Would corrupt stream */
 
+	/* zero-copy frags stay with the skb that completes their send */
+	if (skb_zcopy(tgt) || skb_zcopy(skb))
+		return 0;
+
 	todo = shiftlen;
 	from = 0;
 	to = skb_shinfo(tgt)->nr_frags;
@@ -2767,6 +3096,9 @@ struct sk_buff *skb_segment(struct sk_buff *skb, netdev_features_t features)
 			continue;
 		}
 
+		if (unlikely(skb_zerocopy_clone(nskb, skb, GFP_ATOMIC)))
+			goto err;
+
 		frag = skb_shinfo(nskb)->frags;
 
 		skb_copy_from_linear_data_offset(skb, offset,
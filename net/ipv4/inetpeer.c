@@ -449,6 +449,9 @@ relookup:
 		p->pmtu_orig = 0;
 		p->redirect_genid = 0;
 		memset(&p->redirect_learned, 0, sizeof(p->redirect_learned));
+		p->tcpfo_mss = 0;
+		p->tcpfo_cookie_len = 0;
+		p->tcpfo_syn_loss = 0;
 
 
 		/* Link the node. */
@@ -398,7 +398,11 @@ int ip_recv_error(struct sock *sk, struct msghdr *msg, int len)
 	serr = SKB_EXT_ERR(skb);
 
 	sin = (struct sockaddr_in *)msg->msg_name;
-	if (sin) {
+	if (sin && serr->ee.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+		/* send completions are not about any packet */
+		memset(sin, 0, sizeof(*sin));
+		sin->sin_family = AF_INET;
+	} else if (sin) {
 		sin->sin_family = AF_INET;
 		sin->sin_addr.s_addr = *(__be32 *)(skb_network_header(skb) +
 						   serr->addr_offset);
@@ -0,0 +1,113 @@
+/*
+ * TCP Fast Open: cookie generation for the server side and the per
+ * destination cookie cache used by the client side.
+ *
+ *		This program is free software; you can redistribute it and/or
+ *		modify it under the terms of the GNU General Public License
+ *		as published by the Free Software Foundation; either version
+ *		2 of the License, or (at your option) any later version.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/cryptohash.h>
+#include <linux/random.h>
+#include <linux/seqlock.h>
+#include <linux/string.h>
+#include <net/inetpeer.h>
+#include <net/tcp.h>
+
+int sysctl_tcp_fastopen __read_mostly = TFO_CLIENT_ENABLE;
+
+static u32 tcp_fastopen_secret[MD5_MESSAGE_BYTES / 4] ____cacheline_aligned;
+
+/* Serializes updates of the cookie cache kept in struct inet_peer */
+static DEFINE_SEQLOCK(tcp_fastopen_seqlock);
+
+static int __init tcp_fastopen_init(void)
+{
+	get_random_bytes(tcp_fastopen_secret, sizeof(tcp_fastopen_secret));
+	return 0;
+}
+late_initcall(tcp_fastopen_init);
+
+/* Computes the cookie handed out to (and later expected from) the client
+ * at @addr. The cookie is a keyed hash of the client address only, so it
+ * stays valid across connections until the secret changes at reboot.
+ */
+void tcp_fastopen_cookie_gen(__be32 addr, struct tcp_fastopen_cookie *foc)
+{
+	u32 hash[MD5_DIGEST_WORDS];
+
+	hash[0] = (__force u32)addr;
+	hash[1] = tcp_fastopen_secret[13];
+	hash[2] = tcp_fastopen_secret[14];
+	hash[3] = tcp_fastopen_secret[15];
+	md5_transform(hash, tcp_fastopen_secret);
+
+	BUILD_BUG_ON(TCP_FASTOPEN_COOKIE_SIZE > sizeof(hash));
+	memcpy(foc->val, hash, TCP_FASTOPEN_COOKIE_SIZE);
+	foc->len = TCP_FASTOPEN_COOKIE_SIZE;
+}
+
+void tcp_fastopen_cache_get(struct sock *sk, u16 *mss,
+			    struct tcp_fastopen_cookie *cookie,
+			    int *syn_loss, unsigned long *last_syn_loss)
+{
+	struct inet_peer *peer;
+	bool release_it;
+	unsigned int seq;
+
+	peer = inet_csk(sk)->icsk_af_ops->get_peer(sk, &release_it);
+	if (!peer)
+		return;
+
+	do {
+		seq = read_seqbegin(&tcp_fastopen_seqlock);
+		if (peer->tcpfo_mss)
+			*mss = peer->tcpfo_mss;
+		cookie->len = peer->tcpfo_cookie_len;
+		if (cookie->len > 0)
+			memcpy(cookie->val, peer->tcpfo_cookie, cookie->len);
+		*syn_loss = peer->tcpfo_syn_loss;
+		*last_syn_loss = *syn_loss ? peer->tcpfo_last_syn_loss : 0;
+	} while (read_seqretry(&tcp_fastopen_seqlock, seq));
+
+	if (release_it)
+		inet_putpeer(peer);
+}
+
+void tcp_fastopen_cache_set(struct sock *sk, u16 mss,
+			    struct tcp_fastopen_cookie *cookie,
+			    bool syn_lost)
+{
+	struct inet_peer *peer;
+	bool release_it;
+
+	BUILD_BUG_ON(sizeof(peer->tcpfo_cookie) < TCP_FASTOPEN_COOKIE_MAX);
+
+	peer = inet_csk(sk)->icsk_af_ops->get_peer(sk, &release_it);
+	if (!peer)
+		return;
+
+	write_seqlock_bh(&tcp_fastopen_seqlock);
+	peer->tcpfo_mss = mss;
+	if (cookie->len > 0) {
+		peer->tcpfo_cookie_len = cookie->len;
+		memcpy(peer->tcpfo_cookie, cookie->val, cookie->len);
+	}
+	if (syn_lost) {
+		/* Caps the fallback period in tcp_send_syn_data() at
+		 * 60s << 8, about four hours.
+		 */
+		if (peer->tcpfo_syn_loss < 8)
+			peer->tcpfo_syn_loss++;
+		peer->tcpfo_last_syn_loss = jiffies;
+	} else {
+		peer->tcpfo_syn_loss = 0;
+	}
+	write_sequnlock_bh(&tcp_fastopen_seqlock);
+
+	if (release_it)
+		inet_putpeer(peer);
+}
@@ -39,17 +39,102 @@
  * - updates to tree and tree walking are only done under the rtnl mutex.
  */
 
+/*
+ * A root qdisc hands the driver either a single skb (possibly a GSO skb
+ * whose ->next chain holds its remaining segments), or a bulk dequeued
+ * list of skbs chained through ->next.  The head of a bulk list is never
+ * a GSO skb; a GSO skb can only be the last one of such a list.
+ */
+static inline bool qdisc_skb_is_bulk(const struct sk_buff *skb)
+{
+	return skb->next && !skb_is_gso(skb);
+}
+
+static inline int qdisc_skb_list_len(const struct sk_buff *skb)
+{
+	int n = 1;
+
+	if (qdisc_skb_is_bulk(skb))
+		while ((skb = skb->next) != NULL)
+			n++;
+	return n;
+}
+
+static void qdisc_free_skb_list(struct sk_buff *skb)
+{
+	while (skb) {
+		struct sk_buff *next = qdisc_skb_is_bulk(skb) ? skb->next : NULL;
+
+		if (next)
+			skb->next = NULL;
+		kfree_skb(skb);
+		skb = next;
+	}
+}
+
 static inline int dev_requeue_skb(struct sk_buff *skb, struct Qdisc *q)
 {
-	skb_dst_force(skb);
+	struct sk_buff *p;
+
+	for (p = skb; p; p = qdisc_skb_is_bulk(p) ? p->next : NULL)
+		skb_dst_force(p);
 	q->gso_skb = skb;
 	q->qstats.requeues++;
-	q->q.qlen++;	/* it's still part of the queue */
+	q->q.qlen += qdisc_skb_list_len(skb); /* it's still part of the queue */
 	__netif_schedule(q);
 
 	return 0;
 }
 
+static inline int qdisc_avail_bulklimit(const struct netdev_queue *txq)
+{
+#ifdef CONFIG_BQL
+	/* Non-BQL migrated drivers will return 0, too. */
+	return dql_avail(&txq->dql);
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Bulk dequeueing is restricted to single queue, non LLTX devices: all
+ * packets of a list then share one tx queue and its lock.
+ */
+static inline bool qdisc_may_bulk(const struct Qdisc *q,
+				  const struct sk_buff *skb)
+{
+	const struct net_device *dev = qdisc_dev(q);
+
+	return dev->num_tx_queues == 1 &&
+	       !(dev->features & NETIF_F_LLTX) &&
+	       !skb_is_gso(skb);
+}
+
+/*
+ * Dequeue more packets behind @skb, as long as the byte queue limit of the
+ * device has room for them, so that the driver can be told to defer its
+ * doorbell until the last one.
+ */
+static void try_bulk_dequeue_skb(struct Qdisc *q, struct sk_buff *skb)
+{
+	const struct netdev_queue *txq = netdev_get_tx_queue(qdisc_dev(q), 0);
+	int bytelimit = qdisc_avail_bulklimit(txq) - skb->len;
+
+	while (bytelimit > 0) {
+		struct sk_buff *nskb = q->dequeue(q);
+
+		if (!nskb)
+			break;
+
+		bytelimit -= nskb->len; /* covers GSO len */
+		skb->next = nskb;
+		skb = nskb;
+		if (skb_is_gso(nskb))
+			break;
+	}
+	skb->next = NULL;
+}
+
 static inline struct sk_buff *dequeue_skb(struct Qdisc *q)
 {
 	struct sk_buff *skb = q->gso_skb;
@@ -62,11 +147,13 @@ static inline struct sk_buff *dequeue_skb(struct Qdisc *q)
 		txq = netdev_get_tx_queue(dev, skb_get_queue_mapping(skb));
 		if (!netif_xmit_frozen_or_stopped(txq)) {
 			q->gso_skb = NULL;
-			q->q.qlen--;
+			q->q.qlen -= qdisc_skb_list_len(skb);
 		} else
 			skb = NULL;
 	} else {
 		skb = q->dequeue(q);
+		if (skb && qdisc_may_bulk(q, skb))
+			try_bulk_dequeue_skb(q, skb);
 	}
 
 	return skb;
@@ -85,7 +172,7 @@ static inline int handle_dev_cpu_collision(struct sk_buff *skb,
 		 * detect it by checking xmit owner and drop the packet when
 		 * deadloop is detected. Return OK to try the next skb.
 		 */
-		kfree_skb(skb);
+		qdisc_free_skb_list(skb);
 		if (net_ratelimit())
 			pr_warning("Dead loop on netdevice %s, fix it urgently!\n",
 				   dev_queue->dev->name);
@@ -103,9 +190,81 @@ static inline int handle_dev_cpu_collision(struct sk_buff *skb,
 }
 
 /*
- * Transmit one skb, and handle the return status as required. Holding the
- * __QDISC_STATE_RUNNING bit guarantees that only one CPU can execute this
- * function.
+ * Run validate_xmit_skb() on every packet of a bulk dequeued list before
+ * any of it reaches the driver.  Packets dropped there are unlinked, so
+ * that the last packet handed to the driver, the one with xmit_more
+ * clear, is never lost on the way.  Returns what is left of the list,
+ * possibly a single skb or NULL.
+ */
+static struct sk_buff *validate_xmit_skb_list(struct sk_buff *skb,
+					      struct net_device *dev)
+{
+	struct sk_buff *head = NULL, **tail = &head;
+
+	while (skb) {
+		struct sk_buff *next = NULL;
+
+		if (qdisc_skb_is_bulk(skb)) {
+			next = skb->next;
+			skb->next = NULL;
+		}
+
+		/* a requeued GSO skb may already carry its segments */
+		if (!skb->next)
+			skb = validate_xmit_skb(skb, dev);
+		if (skb) {
+			*tail = skb;
+			tail = &skb->next;
+		}
+		skb = next;
+	}
+	return head;
+}
+
+/*
+ * Hand a validated bulk list to the driver, flagging every packet but the
+ * last one with skb->xmit_more.  On return *skbp points to the packets
+ * the driver did not consume, or is NULL.
+ */
+static int dev_hard_start_xmit_list(struct sk_buff **skbp,
+				    struct net_device *dev,
+				    struct netdev_queue *txq)
+{
+	struct sk_buff *skb = *skbp;
+	int ret = NETDEV_TX_BUSY;
+
+	while (skb) {
+		struct sk_buff *next = NULL;
+
+		if (netif_xmit_frozen_or_stopped(txq)) {
+			ret = NETDEV_TX_BUSY;
+			break;
+		}
+
+		/* a GSO skb keeps its segments on ->next */
+		if (qdisc_skb_is_bulk(skb)) {
+			next = skb->next;
+			skb->next = NULL;
+		}
+		ret = __dev_hard_start_xmit(skb, dev, txq, next != NULL);
+		if (!dev_xmit_complete(ret)) {
+			/* a partly sent GSO skb keeps its segments and is
+			 * always the last one of the list
+			 */
+			if (!skb->next)
+				skb->next = next;
+			break;
+		}
+		skb = next;
+	}
+	*skbp = skb;
+	return ret;
+}
+
+/*
+ * Transmit one skb, or a bulk dequeued list of them, and handle the return
+ * status as required. Holding the __QDISC_STATE_RUNNING bit guarantees that
+ * only one CPU can execute this function.
  *
  * Returns to the caller:
  *				0  - queue is empty or throttled.
@@ -120,11 +279,22 @@ int sch_direct_xmit(struct sk_buff *skb, struct Qdisc *q,
 	/* And release qdisc */
 	spin_unlock(root_lock);
 
-	HARD_TX_LOCK(dev, txq, smp_processor_id());
-	if (!netif_xmit_frozen_or_stopped(txq))
-		ret = dev_hard_start_xmit(skb, dev, txq);
-
-	HARD_TX_UNLOCK(dev, txq);
+	if (qdisc_skb_is_bulk(skb)) {
+		skb = validate_xmit_skb_list(skb, dev);
+		if (skb) {
+			HARD_TX_LOCK(dev, txq, smp_processor_id());
+			ret = dev_hard_start_xmit_list(&skb, dev, txq);
+			HARD_TX_UNLOCK(dev, txq);
+		} else {
+			/* all of it was dropped on the way */
+			ret = NETDEV_TX_OK;
+		}
+	} else {
+		HARD_TX_LOCK(dev, txq, smp_processor_id());
+		if (!netif_xmit_frozen_or_stopped(txq))
+			ret = dev_hard_start_xmit(skb, dev, txq, false);
+		HARD_TX_UNLOCK(dev, txq);
+	}
 
 	spin_lock(root_lock);
 
@@ -613,7 +783,7 @@ void qdisc_reset(struct Qdisc *qdisc)
 		ops->reset(qdisc);
 
 	if (qdisc->gso_skb) {
-		kfree_skb(qdisc->gso_skb);
+		qdisc_free_skb_list(qdisc->gso_skb);
 		qdisc->gso_skb = NULL;
 		qdisc->q.qlen = 0;
 	}
@@ -649,7 +819,7 @@ void qdisc_destroy(struct Qdisc *qdisc)
 	module_put(ops->owner);
 	dev_put(qdisc_dev(qdisc));
 
-	kfree_skb(qdisc->gso_skb);
+	qdisc_free_skb_list(qdisc->gso_skb);
 	/*
 	 * gen_estimator est_timer() might access qdisc->q.lock,
 	 * wait a RCU grace period before freeing qdisc.
@@ -0,0 +1,311 @@
+/*
+ * epoll-ctl.c
+ *
+ * epoll ctl: Measure the cost of updating an epoll interest list.
+ * Every thread owns a set of eventfds and keeps adding, modifying and
+ * deleting them, picked at random, in either one shared epoll instance
+ * or an instance of its own (--multiq). Nobody ever waits for events.
+ * The throughput of each operation is reported in operations per
+ * second.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/stat.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int nsecs = 8;
+/* amount of fds per thread */
+static unsigned int nfds = 64;
+static bool multiq, silent;
+static volatile int done;
+
+/* the shared epoll instance, unless --multiq */
+static int epollfd;
+
+static pthread_mutex_t thread_lock;
+static pthread_cond_t thread_parent, thread_worker;
+static unsigned int threads_starting;
+static struct timeval start, end, runtime;
+
+enum {
+	OP_EPOLL_ADD,
+	OP_EPOLL_MOD,
+	OP_EPOLL_DEL,
+	EPOLL_NR_OPS,
+};
+
+static const char * const op_names[EPOLL_NR_OPS] = {
+	[OP_EPOLL_ADD] = "ADD",
+	[OP_EPOLL_MOD] = "MOD",
+	[OP_EPOLL_DEL] = "DEL",
+};
+
+static const int op_codes[EPOLL_NR_OPS] = {
+	[OP_EPOLL_ADD] = EPOLL_CTL_ADD,
+	[OP_EPOLL_MOD] = EPOLL_CTL_MOD,
+	[OP_EPOLL_DEL] = EPOLL_CTL_DEL,
+};
+
+static struct stats all_stats[EPOLL_NR_OPS];
+
+struct worker {
+	int tid;
+	int epollfd;
+	int *fdmap;
+	bool *added;
+	pthread_t thread;
+	unsigned long ops[EPOLL_NR_OPS];
+};
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify amount of threads (default: online cpus)"),
+	OPT_UINTEGER('r', "runtime", &nsecs,
+		     "Specify runtime (in seconds)"),
+	OPT_UINTEGER('f', "nfds", &nfds,
+		     "Specify amount of file descriptors per thread"),
+	OPT_BOOLEAN('m', "multiq", &multiq,
+		    "Use an epoll instance per thread instead of a shared one"),
+	OPT_BOOLEAN('s', "silent", &silent,
+		    "Silent mode: do not display data/details"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_ctl_usage[] = {
+	"perf bench epoll ctl <options>",
+	NULL
+};
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = (struct worker *) arg;
+	unsigned int seed = w->tid;
+	struct epoll_event ev;
+	unsigned int i;
+	int op;
+
+	pthread_mutex_lock(&thread_lock);
+	threads_starting--;
+	if (!threads_starting)
+		pthread_cond_signal(&thread_parent);
+	pthread_cond_wait(&thread_worker, &thread_lock);
+	pthread_mutex_unlock(&thread_lock);
+
+	do {
+		i = rand_r(&seed) % nfds;
+
+		/* only pick an operation that is valid for the fd's state */
+		if (!w->added[i])
+			op = OP_EPOLL_ADD;
+		else
+			op = rand_r(&seed) & 1 ? OP_EPOLL_MOD : OP_EPOLL_DEL;
+
+		ev.events = op == OP_EPOLL_MOD ? EPOLLOUT : EPOLLIN;
+		ev.data.fd = w->fdmap[i];
+		if (epoll_ctl(w->epollfd, op_codes[op], w->fdmap[i], &ev))
+			err(EXIT_FAILURE, "epoll_ctl %s", op_names[op]);
+
+		w->added[i] = op != OP_EPOLL_DEL;
+		w->ops[op]++;
+	} while (!done);
+
+	return NULL;
+}
+
+static void setup_worker_fds(struct worker *w)
+{
+	unsigned int i;
+
+	w->fdmap = calloc(nfds, sizeof(*w->fdmap));
+	w->added = calloc(nfds, sizeof(*w->added));
+	if (!w->fdmap || !w->added)
+		err(EXIT_FAILURE, "calloc");
+
+	w->epollfd = epollfd;
+	if (multiq) {
+		w->epollfd = epoll_create(nfds);
+		if (w->epollfd < 0)
+			err(EXIT_FAILURE, "epoll_create");
+	}
+
+	for (i = 0; i < nfds; i++) {
+		w->fdmap[i] = eventfd(0, EFD_NONBLOCK);
+		if (w->fdmap[i] < 0)
+			err(EXIT_FAILURE, "eventfd");
+	}
+}
+
+static void release_worker_fds(struct worker *w)
+{
+	unsigned int i;
+
+	for (i = 0; i < nfds; i++)
+		close(w->fdmap[i]);
+	if (multiq)
+		close(w->epollfd);
+	free(w->fdmap);
+	free(w->added);
+}
+
+static void toggle_done(int sig __used)
+{
+	/* inform all threads that we're done for the day */
+	done = 1;
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &runtime);
+}
+
+static void print_summary(void)
+{
+	unsigned long avg[EPOLL_NR_OPS];
+	double stddev[EPOLL_NR_OPS];
+	int i;
+
+	for (i = 0; i < EPOLL_NR_OPS; i++) {
+		avg[i] = avg_stats(&all_stats[i]);
+		stddev[i] = stddev_stats(&all_stats[i]);
+	}
+
+	if (bench_format == BENCH_FORMAT_SIMPLE) {
+		for (i = 0; i < EPOLL_NR_OPS; i++)
+			printf("%lu %.2f%s", avg[i],
+			       rel_stddev_stats(stddev[i], avg[i]),
+			       i == EPOLL_NR_OPS - 1 ? "\n" : " ");
+		return;
+	}
+
+	printf("%s", !silent ? "\n" : "");
+	for (i = 0; i < EPOLL_NR_OPS; i++)
+		printf("Averaged %lu %s operations/sec (+- %.2f%%), "
+		       "total secs = %.2f\n",
+		       avg[i], op_names[i],
+		       rel_stddev_stats(stddev[i], avg[i]),
+		       runtime.tv_sec + runtime.tv_usec / 1e6);
+}
+
+int bench_epoll_ctl(int argc, const char **argv,
+		    const char *prefix __used)
+{
+	int ret = 0;
+	struct sigaction act;
+	unsigned int i;
+	int j;
+	double secs;
+	struct worker *worker = NULL;
+
+	argc = parse_options(argc, argv, options, bench_epoll_ctl_usage, 0);
+	if (argc) {
+		usage_with_options(bench_epoll_ctl_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (!nsecs || !nfds) {
+		fprintf(stderr, "runtime and nfds must be positive\n");
+		return 1;
+	}
+
+	memset(&act, 0, sizeof(act));
+	sigfillset(&act.sa_mask);
+	act.sa_handler = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+	sigaction(SIGALRM, &act, NULL);
+
+	worker = calloc(nthreads, sizeof(*worker));
+	if (!worker)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!multiq) {
+		epollfd = epoll_create(nthreads * nfds);
+		if (epollfd < 0)
+			err(EXIT_FAILURE, "epoll_create");
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Run summary [PID %d]: %u threads updating %u fds "
+		       "each, %s, for %u secs.\n\n",
+		       getpid(), nthreads, nfds,
+		       multiq ? "one epoll instance per thread" :
+				"one shared epoll instance",
+		       nsecs);
+
+	for (j = 0; j < EPOLL_NR_OPS; j++)
+		init_stats(&all_stats[j]);
+	pthread_mutex_init(&thread_lock, NULL);
+	pthread_cond_init(&thread_parent, NULL);
+	pthread_cond_init(&thread_worker, NULL);
+
+	threads_starting = nthreads;
+	for (i = 0; i < nthreads; i++) {
+		worker[i].tid = i;
+		setup_worker_fds(&worker[i]);
+
+		if (pthread_create(&worker[i].thread, NULL, workerfn,
+				   (void *)(struct worker *) &worker[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	pthread_mutex_lock(&thread_lock);
+	while (threads_starting)
+		pthread_cond_wait(&thread_parent, &thread_lock);
+	gettimeofday(&start, NULL);
+	pthread_cond_broadcast(&thread_worker);
+	pthread_mutex_unlock(&thread_lock);
+
+	alarm(nsecs);
+	while (!done)
+		pause();
+
+	for (i = 0; i < nthreads; i++) {
+		ret = pthread_join(worker[i].thread, NULL);
+		if (ret)
+			err(EXIT_FAILURE, "pthread_join");
+	}
+
+	/* cleanup & report results */
+	pthread_cond_destroy(&thread_parent);
+	pthread_cond_destroy(&thread_worker);
+	pthread_mutex_destroy(&thread_lock);
+
+	secs = runtime.tv_sec + runtime.tv_usec / 1e6;
+	for (i = 0; i < nthreads; i++) {
+		unsigned long t[EPOLL_NR_OPS];
+
+		for (j = 0; j < EPOLL_NR_OPS; j++) {
+			t[j] = worker[i].ops[j] / secs;
+			update_stats(&all_stats[j], t[j]);
+		}
+
+		if (!silent && bench_format == BENCH_FORMAT_DEFAULT)
+			printf("[thread %2d] fdmap: %p [ add: %lu ops/sec; "
+			       "mod: %lu ops/sec; del: %lu ops/sec ]\n",
+			       worker[i].tid, worker[i].fdmap,
+			       t[OP_EPOLL_ADD], t[OP_EPOLL_MOD],
+			       t[OP_EPOLL_DEL]);
+
+		release_worker_fds(&worker[i]);
+	}
+
+	if (!multiq)
+		close(epollfd);
+
+	print_summary();
+
+	free(worker);
+	return ret;
+}
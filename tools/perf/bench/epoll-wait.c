@@ -0,0 +1,307 @@
+/*
+ * epoll-wait.c
+ *
+ * epoll wait: Measure how many events a set of threads blocked in
+ * epoll_wait() can consume. Every worker registers its own eventfds
+ * with either one shared epoll instance, or with an instance of its
+ * own (--multiq). A single writer thread keeps making all the fds
+ * readable, round-robin, and each worker consumes the events it is
+ * handed. The throughput is reported in operations per second.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/stat.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int nsecs = 8;
+/* amount of fds per thread */
+static unsigned int nfds = 64;
+static bool multiq, edge_trigger, silent;
+static volatile int done;
+
+/* the shared epoll instance, unless --multiq */
+static int epollfd;
+
+static pthread_mutex_t thread_lock;
+static pthread_cond_t thread_parent, thread_worker;
+static unsigned int threads_starting;
+static struct stats throughput_stats;
+static struct timeval start, end, runtime;
+
+struct worker {
+	int tid;
+	int epollfd;
+	int *fdmap;
+	pthread_t thread;
+	unsigned long ops;
+};
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify amount of threads (default: online cpus)"),
+	OPT_UINTEGER('r', "runtime", &nsecs,
+		     "Specify runtime (in seconds)"),
+	OPT_UINTEGER('f', "nfds", &nfds,
+		     "Specify amount of file descriptors per thread"),
+	OPT_BOOLEAN('m', "multiq", &multiq,
+		    "Use an epoll instance per thread instead of a shared one"),
+	OPT_BOOLEAN('E', "edge", &edge_trigger,
+		    "Register the fds as edge-triggered (EPOLLET)"),
+	OPT_BOOLEAN('s', "silent", &silent,
+		    "Silent mode: do not display data/details"),
+	OPT_END()
+};
+
+static const char * const bench_epoll_wait_usage[] = {
+	"perf bench epoll wait <options>",
+	NULL
+};
+
+static void *workerfn(void *arg)
+{
+	struct worker *w = (struct worker *) arg;
+	struct epoll_event ev;
+	u64 val;
+	int ret;
+
+	pthread_mutex_lock(&thread_lock);
+	threads_starting--;
+	if (!threads_starting)
+		pthread_cond_signal(&thread_parent);
+	pthread_cond_wait(&thread_worker, &thread_lock);
+	pthread_mutex_unlock(&thread_lock);
+
+	do {
+		/*
+		 * Wake up now and then to notice the end of the run even
+		 * when the writer no longer feeds us.
+		 */
+		ret = epoll_wait(w->epollfd, &ev, 1, 100);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "epoll_wait");
+		}
+		if (!ret)
+			continue;
+
+		/*
+		 * With a shared instance another worker may have drained
+		 * the fd first; the fds are non-blocking, so just carry on.
+		 */
+		if (read(ev.data.fd, &val, sizeof(val)) == sizeof(val))
+			w->ops++;
+	} while (!done);
+
+	return NULL;
+}
+
+static void *writerfn(void *arg)
+{
+	struct worker *worker = (struct worker *) arg;
+	unsigned int i, j;
+	u64 val = 1;
+	ssize_t sz;
+
+	do {
+		for (i = 0; i < nfds && !done; i++) {
+			for (j = 0; j < nthreads; j++) {
+				sz = write(worker[j].fdmap[i], &val, sizeof(val));
+				if (sz != sizeof(val))
+					err(EXIT_FAILURE, "write");
+			}
+		}
+	} while (!done);
+
+	return NULL;
+}
+
+static void setup_worker_fds(struct worker *w)
+{
+	struct epoll_event ev;
+	unsigned int i;
+
+	w->fdmap = calloc(nfds, sizeof(*w->fdmap));
+	if (!w->fdmap)
+		err(EXIT_FAILURE, "calloc");
+
+	w->epollfd = epollfd;
+	if (multiq) {
+		w->epollfd = epoll_create(nfds);
+		if (w->epollfd < 0)
+			err(EXIT_FAILURE, "epoll_create");
+	}
+
+	for (i = 0; i < nfds; i++) {
+		w->fdmap[i] = eventfd(0, EFD_NONBLOCK);
+		if (w->fdmap[i] < 0)
+			err(EXIT_FAILURE, "eventfd");
+
+		ev.events = EPOLLIN;
+		if (edge_trigger)
+			ev.events |= EPOLLET;
+		ev.data.fd = w->fdmap[i];
+		if (epoll_ctl(w->epollfd, EPOLL_CTL_ADD, w->fdmap[i], &ev))
+			err(EXIT_FAILURE, "epoll_ctl");
+	}
+}
+
+static void release_worker_fds(struct worker *w)
+{
+	unsigned int i;
+
+	for (i = 0; i < nfds; i++)
+		close(w->fdmap[i]);
+	if (multiq)
+		close(w->epollfd);
+	free(w->fdmap);
+}
+
+static void toggle_done(int sig __used)
+{
+	/* inform all threads that we're done for the day */
+	done = 1;
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &runtime);
+}
+
+static void print_summary(void)
+{
+	unsigned long avg = avg_stats(&throughput_stats);
+	double stddev = stddev_stats(&throughput_stats);
+
+	if (bench_format == BENCH_FORMAT_SIMPLE) {
+		printf("%lu %.2f\n", avg, rel_stddev_stats(stddev, avg));
+		return;
+	}
+
+	printf("%sAveraged %lu operations/sec (+- %.2f%%), total secs = %.2f\n",
+	       !silent ? "\n" : "", avg, rel_stddev_stats(stddev, avg),
+	       runtime.tv_sec + runtime.tv_usec / 1e6);
+}
+
+int bench_epoll_wait(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	int ret = 0;
+	struct sigaction act;
+	unsigned int i;
+	double secs;
+	pthread_t writer;
+	struct worker *worker = NULL;
+
+	argc = parse_options(argc, argv, options, bench_epoll_wait_usage, 0);
+	if (argc) {
+		usage_with_options(bench_epoll_wait_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (!nsecs || !nfds) {
+		fprintf(stderr, "runtime and nfds must be positive\n");
+		return 1;
+	}
+
+	memset(&act, 0, sizeof(act));
+	sigfillset(&act.sa_mask);
+	act.sa_handler = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+	sigaction(SIGALRM, &act, NULL);
+
+	worker = calloc(nthreads, sizeof(*worker));
+	if (!worker)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!multiq) {
+		epollfd = epoll_create(nthreads * nfds);
+		if (epollfd < 0)
+			err(EXIT_FAILURE, "epoll_create");
+	}
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Run summary [PID %d]: %u threads waiting on %u "
+		       "%s-triggered fds each, %s, for %u secs.\n\n",
+		       getpid(), nthreads, nfds,
+		       edge_trigger ? "edge" : "level",
+		       multiq ? "one epoll instance per thread" :
+				"one shared epoll instance",
+		       nsecs);
+
+	init_stats(&throughput_stats);
+	pthread_mutex_init(&thread_lock, NULL);
+	pthread_cond_init(&thread_parent, NULL);
+	pthread_cond_init(&thread_worker, NULL);
+
+	threads_starting = nthreads;
+	for (i = 0; i < nthreads; i++) {
+		worker[i].tid = i;
+		setup_worker_fds(&worker[i]);
+
+		if (pthread_create(&worker[i].thread, NULL, workerfn,
+				   (void *)(struct worker *) &worker[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	pthread_mutex_lock(&thread_lock);
+	while (threads_starting)
+		pthread_cond_wait(&thread_parent, &thread_lock);
+	gettimeofday(&start, NULL);
+	pthread_cond_broadcast(&thread_worker);
+	pthread_mutex_unlock(&thread_lock);
+
+	if (pthread_create(&writer, NULL, writerfn, worker))
+		err(EXIT_FAILURE, "pthread_create");
+
+	alarm(nsecs);
+	while (!done)
+		pause();
+
+	ret = pthread_join(writer, NULL);
+	if (ret)
+		err(EXIT_FAILURE, "pthread_join");
+	for (i = 0; i < nthreads; i++) {
+		ret = pthread_join(worker[i].thread, NULL);
+		if (ret)
+			err(EXIT_FAILURE, "pthread_join");
+	}
+
+	/* cleanup & report results */
+	pthread_cond_destroy(&thread_parent);
+	pthread_cond_destroy(&thread_worker);
+	pthread_mutex_destroy(&thread_lock);
+
+	secs = runtime.tv_sec + runtime.tv_usec / 1e6;
+	for (i = 0; i < nthreads; i++) {
+		unsigned long t = worker[i].ops / secs;
+
+		update_stats(&throughput_stats, t);
+		if (!silent && bench_format == BENCH_FORMAT_DEFAULT)
+			printf("[thread %2d] fdmap: %p [ %lu ops/sec ]\n",
+			       worker[i].tid, worker[i].fdmap, t);
+
+		release_worker_fds(&worker[i]);
+	}
+
+	if (!multiq)
+		close(epollfd);
+
+	print_summary();
+
+	free(worker);
+	return ret;
+}
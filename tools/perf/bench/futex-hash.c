@@ -0,0 +1,224 @@
+/*
+ * futex-hash.c
+ *
+ * futex hash: Stress the kernel's futex hash table. Every thread
+ * issues FUTEX_WAIT on its own set of futexes with a value that never
+ * matches, so each call only takes the hash bucket lock, finds the
+ * mismatch and returns -EAGAIN. The throughput is reported in
+ * operations per second.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/stat.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+static unsigned int nthreads;
+static unsigned int nsecs = 10;
+/* amount of futexes per thread */
+static unsigned int nfutexes = 1024;
+static bool fshared, silent;
+static int futex_flag;
+static volatile int done;
+
+static pthread_mutex_t thread_lock;
+static pthread_cond_t thread_parent, thread_worker;
+static unsigned int threads_starting;
+static struct stats throughput_stats;
+static struct timeval start, end, runtime;
+
+struct worker {
+	int tid;
+	u_int32_t *futex;
+	pthread_t thread;
+	unsigned long ops;
+};
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify amount of threads (default: online cpus)"),
+	OPT_UINTEGER('r', "runtime", &nsecs,
+		     "Specify runtime (in seconds)"),
+	OPT_UINTEGER('f', "futexes", &nfutexes,
+		     "Specify amount of futexes per threads"),
+	OPT_BOOLEAN('s', "silent", &silent,
+		    "Silent mode: do not display data/details"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_hash_usage[] = {
+	"perf bench futex hash <options>",
+	NULL
+};
+
+static void *workerfn(void *arg)
+{
+	int ret;
+	unsigned int i;
+	struct worker *w = (struct worker *) arg;
+
+	pthread_mutex_lock(&thread_lock);
+	threads_starting--;
+	if (!threads_starting)
+		pthread_cond_signal(&thread_parent);
+	pthread_cond_wait(&thread_worker, &thread_lock);
+	pthread_mutex_unlock(&thread_lock);
+
+	do {
+		for (i = 0; i < nfutexes; i++, w->ops++) {
+			/*
+			 * We want the futex calls to fail in order to
+			 * stress the hashing of uaddr and not measure
+			 * other steps, such as internal waitqueue
+			 * handling, thus enlarging the critical region
+			 * protected by hb->lock.
+			 */
+			ret = futex_wait(&w->futex[i], 1234, NULL, futex_flag);
+			if (!silent &&
+			    (!ret || (errno != EAGAIN && errno != EWOULDBLOCK)))
+				warn("Non-expected futex return call");
+		}
+	} while (!done);
+
+	return NULL;
+}
+
+static void toggle_done(int sig __used)
+{
+	/* inform all threads that we're done for the day */
+	done = 1;
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &runtime);
+}
+
+static void print_summary(void)
+{
+	unsigned long avg = avg_stats(&throughput_stats);
+	double stddev = stddev_stats(&throughput_stats);
+
+	if (bench_format == BENCH_FORMAT_SIMPLE) {
+		printf("%lu %.2f\n", avg, rel_stddev_stats(stddev, avg));
+		return;
+	}
+
+	printf("%sAveraged %lu operations/sec (+- %.2f%%), total secs = %.2f\n",
+	       !silent ? "\n" : "", avg, rel_stddev_stats(stddev, avg),
+	       runtime.tv_sec + runtime.tv_usec / 1e6);
+}
+
+int bench_futex_hash(int argc, const char **argv,
+		     const char *prefix __used)
+{
+	int ret = 0;
+	struct sigaction act;
+	unsigned int i;
+	double secs;
+	struct worker *worker = NULL;
+
+	argc = parse_options(argc, argv, options, bench_futex_hash_usage, 0);
+	if (argc) {
+		usage_with_options(bench_futex_hash_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (!nsecs || !nfutexes) {
+		fprintf(stderr, "runtime and futexes must be positive\n");
+		return 1;
+	}
+
+	memset(&act, 0, sizeof(act));
+	sigfillset(&act.sa_mask);
+	act.sa_handler = toggle_done;
+	sigaction(SIGINT, &act, NULL);
+	sigaction(SIGALRM, &act, NULL);
+
+	worker = calloc(nthreads, sizeof(*worker));
+	if (!worker)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Run summary [PID %d]: %u threads, each operating on "
+		       "%u [%s] futexes for %u secs.\n\n",
+		       getpid(), nthreads, nfutexes,
+		       fshared ? "shared":"private", nsecs);
+
+	init_stats(&throughput_stats);
+	pthread_mutex_init(&thread_lock, NULL);
+	pthread_cond_init(&thread_parent, NULL);
+	pthread_cond_init(&thread_worker, NULL);
+
+	threads_starting = nthreads;
+	for (i = 0; i < nthreads; i++) {
+		worker[i].tid = i;
+		worker[i].futex = calloc(nfutexes, sizeof(*worker[i].futex));
+		if (!worker[i].futex)
+			err(EXIT_FAILURE, "calloc");
+
+		if (pthread_create(&worker[i].thread, NULL, workerfn,
+				   (void *)(struct worker *) &worker[i]))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+
+	pthread_mutex_lock(&thread_lock);
+	while (threads_starting)
+		pthread_cond_wait(&thread_parent, &thread_lock);
+	gettimeofday(&start, NULL);
+	pthread_cond_broadcast(&thread_worker);
+	pthread_mutex_unlock(&thread_lock);
+
+	alarm(nsecs);
+	while (!done)
+		pause();
+
+	for (i = 0; i < nthreads; i++) {
+		ret = pthread_join(worker[i].thread, NULL);
+		if (ret)
+			err(EXIT_FAILURE, "pthread_join");
+	}
+
+	/* cleanup & report results */
+	pthread_cond_destroy(&thread_parent);
+	pthread_cond_destroy(&thread_worker);
+	pthread_mutex_destroy(&thread_lock);
+
+	secs = runtime.tv_sec + runtime.tv_usec / 1e6;
+	for (i = 0; i < nthreads; i++) {
+		unsigned long t = worker[i].ops / secs;
+
+		update_stats(&throughput_stats, t);
+		if (!silent && bench_format == BENCH_FORMAT_DEFAULT) {
+			if (nfutexes == 1)
+				printf("[thread %2d] futex: %p [ %lu ops/sec ]\n",
+				       worker[i].tid, &worker[i].futex[0], t);
+			else
+				printf("[thread %2d] futexes: %p ... %p [ %lu ops/sec ]\n",
+				       worker[i].tid, &worker[i].futex[0],
+				       &worker[i].futex[nfutexes-1], t);
+		}
+
+		free(worker[i].futex);
+	}
+
+	print_summary();
+
+	free(worker);
+	return ret;
+}
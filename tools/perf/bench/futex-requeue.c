@@ -0,0 +1,207 @@
+/*
+ * futex-requeue.c
+ *
+ * futex requeue: Block a number of threads on one futex and measure
+ * how long it takes to requeue them all onto a second futex, a few at
+ * a time, without waking any of them up.
+ */
+
+#include "../perf.h"
+#include "../util/util.h"
+#include "../util/stat.h"
+#include "../util/parse-options.h"
+#include "bench.h"
+#include "futex.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+static u_int32_t futex1, futex2;
+
+static unsigned int nthreads;
+static unsigned int nrequeue = 1;
+static unsigned int nrepeat = 10;
+static bool silent, fshared;
+static int futex_flag;
+
+static pthread_mutex_t thread_lock;
+static pthread_cond_t thread_parent, thread_worker;
+static unsigned int threads_starting;
+static struct stats requeuetime_stats, requeued_stats;
+
+static const struct option options[] = {
+	OPT_UINTEGER('t', "threads", &nthreads,
+		     "Specify amount of threads (default: online cpus)"),
+	OPT_UINTEGER('q', "nrequeue", &nrequeue,
+		     "Specify amount of threads to requeue at once"),
+	OPT_UINTEGER('r', "repeat", &nrepeat,
+		     "Specify amount of times to repeat the run"),
+	OPT_BOOLEAN('s', "silent", &silent,
+		    "Silent mode: do not display data/details"),
+	OPT_BOOLEAN('S', "shared", &fshared,
+		    "Use shared futexes instead of private ones"),
+	OPT_END()
+};
+
+static const char * const bench_futex_requeue_usage[] = {
+	"perf bench futex requeue <options>",
+	NULL
+};
+
+static void *workerfn(void *arg __used)
+{
+	pthread_mutex_lock(&thread_lock);
+	threads_starting--;
+	if (!threads_starting)
+		pthread_cond_signal(&thread_parent);
+	pthread_cond_wait(&thread_worker, &thread_lock);
+	pthread_mutex_unlock(&thread_lock);
+
+	/* woken up on futex2, once it has been requeued there */
+	while (futex_wait(&futex1, 0, NULL, futex_flag) && errno == EINTR)
+		;
+
+	return NULL;
+}
+
+static void block_threads(pthread_t *w)
+{
+	unsigned int i;
+
+	threads_starting = nthreads;
+
+	/* create and block all threads */
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&w[i], NULL, workerfn, NULL))
+			err(EXIT_FAILURE, "pthread_create");
+	}
+}
+
+static void print_summary(void)
+{
+	double requeuetime_avg = avg_stats(&requeuetime_stats);
+	double requeuetime_stddev = stddev_stats(&requeuetime_stats);
+	unsigned int requeued_avg = avg_stats(&requeued_stats);
+
+	if (bench_format == BENCH_FORMAT_SIMPLE) {
+		printf("%u %.4f %.2f\n", requeued_avg, requeuetime_avg / 1e3,
+		       rel_stddev_stats(requeuetime_stddev, requeuetime_avg));
+		return;
+	}
+
+	printf("Requeued %u of %u threads in %.4f ms (+-%.2f%%)\n",
+	       requeued_avg,
+	       nthreads,
+	       requeuetime_avg / 1e3,
+	       rel_stddev_stats(requeuetime_stddev, requeuetime_avg));
+}
+
+int bench_futex_requeue(int argc, const char **argv,
+			const char *prefix __used)
+{
+	int ret = 0;
+	unsigned int i, j;
+	pthread_t *worker;
+	struct timeval start, end, runtime;
+
+	argc = parse_options(argc, argv, options,
+			     bench_futex_requeue_usage, 0);
+	if (argc) {
+		usage_with_options(bench_futex_requeue_usage, options);
+		exit(EXIT_FAILURE);
+	}
+
+	if (!nthreads)
+		nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	if (!nrequeue || !nrepeat) {
+		fprintf(stderr, "nrequeue and repeat must be positive\n");
+		return 1;
+	}
+	if (nrequeue > nthreads)
+		nrequeue = nthreads;
+
+	worker = calloc(nthreads, sizeof(*worker));
+	if (!worker)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!fshared)
+		futex_flag = FUTEX_PRIVATE_FLAG;
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Run summary [PID %d]: Requeuing %u threads "
+		       "(from [%s] %p to %p), %u at a time.\n\n",
+		       getpid(), nthreads, fshared ? "shared":"private",
+		       &futex1, &futex2, nrequeue);
+
+	init_stats(&requeued_stats);
+	init_stats(&requeuetime_stats);
+	pthread_mutex_init(&thread_lock, NULL);
+	pthread_cond_init(&thread_parent, NULL);
+	pthread_cond_init(&thread_worker, NULL);
+
+	for (j = 0; j < nrepeat; j++) {
+		unsigned int nrequeued = 0, nwoken = 0;
+		u64 usecs;
+
+		/* create, launch & block all threads */
+		block_threads(worker);
+
+		/* make sure all threads are already blocked */
+		pthread_mutex_lock(&thread_lock);
+		while (threads_starting)
+			pthread_cond_wait(&thread_parent, &thread_lock);
+		pthread_cond_broadcast(&thread_worker);
+		pthread_mutex_unlock(&thread_lock);
+
+		usleep(100000);
+
+		/* Ok, all threads are patiently blocked, start requeueing */
+		gettimeofday(&start, NULL);
+		while (nrequeued < nthreads) {
+			/*
+			 * Do not wakeup any tasks blocked on futex1, allowing
+			 * us to really measure futex_wait functionality.
+			 */
+			ret = futex_cmp_requeue(&futex1, 0, &futex2, 0,
+						nrequeue, futex_flag);
+			if (ret < 0)
+				err(EXIT_FAILURE, "futex_cmp_requeue");
+			nrequeued += ret;
+		}
+		gettimeofday(&end, NULL);
+		timersub(&end, &start, &runtime);
+		usecs = runtime.tv_sec * 1000000ULL + runtime.tv_usec;
+
+		update_stats(&requeued_stats, nrequeued);
+		update_stats(&requeuetime_stats, usecs);
+
+		if (!silent && bench_format == BENCH_FORMAT_DEFAULT) {
+			printf("[Run %u]: Requeued %u of %u threads in %.4f ms\n",
+			       j + 1, nrequeued, nthreads, usecs / 1e3);
+		}
+
+		/* everybody should be blocked on futex2, wake'em up */
+		while (nwoken < nthreads)
+			nwoken += futex_wake(&futex2, nthreads, futex_flag);
+
+		for (i = 0; i < nthreads; i++) {
+			ret = pthread_join(worker[i], NULL);
+			if (ret)
+				err(EXIT_FAILURE, "pthread_join");
+		}
+	}
+
+	/* cleanup & report results */
+	pthread_cond_destroy(&thread_parent);
+	pthread_cond_destroy(&thread_worker);
+	pthread_mutex_destroy(&thread_lock);
+
+	print_summary();
+
+	free(worker);
+	return ret;
+}
@@ -0,0 +1,62 @@
+/*
+ * futex.h
+ *
+ * Glibc does not provide a futex() wrapper, so the futex benchmarks
+ * make the system call directly through these helpers.
+ */
+#ifndef _FUTEX_H
+#define _FUTEX_H
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <linux/futex.h>
+
+/*
+ * futex() - the raw system call
+ * @uaddr:	address of the first futex
+ * @op:		futex op code, possibly or'ed with FUTEX_PRIVATE_FLAG
+ * @val:	typically the expected value of @uaddr, but varies by op
+ * @timeout:	relative timeout for the wait ops, may be NULL
+ * @uaddr2:	address of the second futex for the requeue ops
+ * @val3:	varies by op
+ * @opflags:	flags to be or'ed into @op, e.g. FUTEX_PRIVATE_FLAG
+ */
+#define futex(uaddr, op, val, timeout, uaddr2, val3, opflags)		\
+	syscall(SYS_futex, uaddr, op | opflags, val, timeout, uaddr2, val3)
+
+/*
+ * futex_wait() - block on @uaddr with an optional timeout, as long as
+ * it still holds @val
+ */
+static inline int
+futex_wait(u_int32_t *uaddr, u_int32_t val, struct timespec *timeout,
+	   int opflags)
+{
+	return futex(uaddr, FUTEX_WAIT, val, timeout, NULL, 0, opflags);
+}
+
+/*
+ * futex_wake() - wake up to @nr_wake tasks blocked on @uaddr
+ */
+static inline int
+futex_wake(u_int32_t *uaddr, int nr_wake, int opflags)
+{
+	return futex(uaddr, FUTEX_WAKE, nr_wake, NULL, NULL, 0, opflags);
+}
+
+/*
+ * futex_cmp_requeue() - wake @nr_wake tasks blocked on @uaddr and
+ * requeue up to @nr_requeue of the rest onto @uaddr2, as long as
+ * @uaddr still holds @val. Returns the number of tasks woken or
+ * requeued.
+ */
+static inline int
+futex_cmp_requeue(u_int32_t *uaddr, u_int32_t val, u_int32_t *uaddr2,
+		  int nr_wake, int nr_requeue, int opflags)
+{
+	return futex(uaddr, FUTEX_CMP_REQUEUE, nr_wake,
+		     (void *)(long)nr_requeue, uaddr2, val, opflags);
+}
+
+#endif /* _FUTEX_H */
@@ -1,12 +1,25 @@
+/*
+ * Architecture specific memcpy() routines for 'perf bench mem memcpy'.
+ *
+ * An architecture plugs in its own routines by defining ARCH_<ARCH> in
+ * ARCH_CFLAGS, setting BENCH_MEM_ARCH in the Makefile, and providing
+ * mem-memcpy-<arch>-asm.S, which builds the kernel's routine, and
+ * mem-memcpy-<arch>-asm-def.h, which lists it with MEMCPY_FN().
+ */
 
-#ifdef ARCH_X86_64
+#if defined(ARCH_X86_64)
+#define MEMCPY_ARCH_DEF "mem-memcpy-x86-64-asm-def.h"
+#elif defined(ARCH_ARM)
+#define MEMCPY_ARCH_DEF "mem-memcpy-arm-asm-def.h"
+#endif
+
+#ifdef MEMCPY_ARCH_DEF
 
 #define MEMCPY_FN(fn, name, desc)		\
 	extern void *fn(void *, const void *, size_t);
 
-#include "mem-memcpy-x86-64-asm-def.h"
+#include MEMCPY_ARCH_DEF
 
 #undef MEMCPY_FN
 
 #endif
-
@@ -0,0 +1,4 @@
+
+MEMCPY_FN(kernel_memcpy,
+	"arm",
+	"memcpy() in arch/arm/lib/memcpy.S")
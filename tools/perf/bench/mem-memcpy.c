@@ -56,10 +56,10 @@ struct routine routines[] = {
 	{ "default",
 	  "Default memcpy() provided by glibc",
 	  memcpy },
-#ifdef ARCH_X86_64
+#ifdef MEMCPY_ARCH_DEF
 
 #define MEMCPY_FN(fn, name, desc) { name, desc, fn },
-#include "mem-memcpy-x86-64-asm-def.h"
+#include MEMCPY_ARCH_DEF
 #undef MEMCPY_FN
 
 #endif
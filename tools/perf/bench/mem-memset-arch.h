@@ -0,0 +1,21 @@
+/*
+ * Architecture specific memset() routines for 'perf bench mem memset'.
+ * See mem-memcpy-arch.h for how an architecture plugs in.
+ */
+
+#if defined(ARCH_X86_64)
+#define MEMSET_ARCH_DEF "mem-memset-x86-64-asm-def.h"
+#elif defined(ARCH_ARM)
+#define MEMSET_ARCH_DEF "mem-memset-arm-asm-def.h"
+#endif
+
+#ifdef MEMSET_ARCH_DEF
+
+#define MEMSET_FN(fn, name, desc)		\
+	extern void *fn(void *, int, size_t);
+
+#include MEMSET_ARCH_DEF
+
+#undef MEMSET_FN
+
+#endif
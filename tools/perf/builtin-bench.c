@@ -13,6 +13,8 @@
  * Available subsystem list:
  *  sched ... scheduler and IPC mechanism
  *  mem   ... memory access performance
+ *  futex ... futex performance
+ *  epoll ... epoll performance
  *
  */
 
@@ -52,6 +54,38 @@ static struct bench_suite mem_suites[] = {
 	{ "memcpy",
 	  "Simple memory copy in various ways",
 	  bench_mem_memcpy },
+	{ "memset",
+	  "Simple memory set in various ways",
+	  bench_mem_memset },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL             }
+};
+
+static struct bench_suite futex_suites[] = {
+	{ "wake",
+	  "Block threads on a futex and time waking them all up",
+	  bench_futex_wake    },
+	{ "requeue",
+	  "Block threads on a futex and time requeueing them to another",
+	  bench_futex_requeue },
+	{ "hash",
+	  "Stress the futex hash table with mismatching FUTEX_WAITs",
+	  bench_futex_hash    },
+	suite_all,
+	{ NULL,
+	  NULL,
+	  NULL                }
+};
+
+static struct bench_suite epoll_suites[] = {
+	{ "wait",
+	  "Throughput of threads consuming events with epoll_wait()",
+	  bench_epoll_wait },
+	{ "ctl",
+	  "Throughput of epoll_ctl() ADD/MOD/DEL operations",
+	  bench_epoll_ctl  },
 	suite_all,
 	{ NULL,
 	  NULL,
@@ -71,6 +105,12 @@ static struct bench_subsys subsystems[] = {
 	{ "mem",
 	  "memory access performance",
 	  mem_suites },
+	{ "futex",
+	  "futex performance",
+	  futex_suites },
+	{ "epoll",
+	  "epoll performance",
+	  epoll_suites },
 	{ "all",		/* sentinel: easy for help */
 	  "test all subsystem (pseudo subsystem)",
 	  NULL },
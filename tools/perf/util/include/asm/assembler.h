@@ -0,0 +1,31 @@
+#ifndef PERF_ASM_ASSEMBLER_H
+#define PERF_ASM_ASSEMBLER_H
+
+/*
+ * assembler.h ... dummy header file for including
+ * arch/arm/lib/{memcpy,memset}.S
+ */
+
+#ifndef __ARMEB__
+#define pull		lsr
+#define push		lsl
+#else
+#define pull		lsl
+#define push		lsr
+#endif
+
+/* pld needs ARMv5TE or later */
+#if defined(__ARM_ARCH_4__) || defined(__ARM_ARCH_4T__)
+#define PLD(code...)
+#else
+#define PLD(code...)	code
+#endif
+
+#define CALGN(code...)
+
+/* The routines are always built in ARM state, see the bench wrappers */
+#define ARM(x...)	x
+#define THUMB(x...)
+#define W(instr)	instr
+
+#endif	/* PERF_ASM_ASSEMBLER_H */
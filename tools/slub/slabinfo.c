@@ -31,7 +31,7 @@ struct slabinfo {
 	int aliases, align, cache_dma, cpu_slabs, destroy_by_rcu;
 	int hwcache_align, object_size, objs_per_slab;
 	int sanity_checks, slab_size, store_user, trace;
-	int order, poison, reclaim_account, red_zone;
+	int order, poison, reclaim_account, red_zone, cpu_partial;
 	unsigned long partial, objects, slabs, objects_partial, objects_total;
 	unsigned long alloc_fastpath, alloc_slowpath;
 	unsigned long free_fastpath, free_slowpath;
@@ -43,6 +43,7 @@ struct slabinfo {
 	unsigned long cmpxchg_double_cpu_fail, cmpxchg_double_fail;
 	unsigned long alloc_node_mismatch, deactivate_bypass;
 	unsigned long cpu_partial_alloc, cpu_partial_free;
+	unsigned long alloc_bulk, free_bulk;
 	int numa[MAX_NODES];
 	int numa_partial[MAX_NODES];
 } slabinfo[MAX_SLABS];
@@ -461,6 +462,10 @@ static void slab_stats(struct slabinfo *s)
 		s->cpu_partial_alloc * 100 / total_alloc,
 		s->cpu_partial_free * 100 / total_free);
 
+	if (s->alloc_bulk || s->free_bulk)
+		printf("Bulk objects         %8lu %8lu\n",
+			s->alloc_bulk, s->free_bulk);
+
 	printf("RemoteObj/SlabFrozen %8lu %8lu %3lu %3lu\n",
 		s->deactivate_remote_frees, s->free_frozen,
 		s->deactivate_remote_frees * 100 / total_alloc,
@@ -533,6 +538,7 @@ static void report(struct slabinfo *s)
 			s->align, s->objs_per_slab, onoff(s->trace),
 			((page_size << s->order) - s->objs_per_slab * s->slab_size) *
 			s->slabs);
+	printf("Per cpu partial objects: %d\n", s->cpu_partial);
 
 	ops(s);
 	show_tracking(s);
@@ -1217,6 +1223,9 @@ static void read_slab_dir(void)
 			slab->cmpxchg_double_fail = get_obj("cmpxchg_double_fail");
 			slab->cpu_partial_alloc = get_obj("cpu_partial_alloc");
 			slab->cpu_partial_free = get_obj("cpu_partial_free");
+			slab->alloc_bulk = get_obj("alloc_bulk");
+			slab->free_bulk = get_obj("free_bulk");
+			slab->cpu_partial = get_obj("cpu_partial");
 			slab->alloc_node_mismatch = get_obj("alloc_node_mismatch");
 			slab->deactivate_bypass = get_obj("deactivate_bypass");
 			chdir("..");
@@ -0,0 +1,743 @@
+/*
+ * Classic BPF filter regression corpus.
+ *
+ * Runs a set of socket filters, mostly what tcpdump -dd emits for common
+ * expressions plus a few hand written programs that cover every ALU, jump,
+ * load and scratch memory opcode, against a set of Ethernet frames and
+ * compares what the kernel lets through with a reference interpreter.
+ *
+ * The filters are attached to one end of an AF_UNIX datagram socketpair,
+ * so no privileges or network devices are needed: sk_filter() runs on
+ * every datagram, with the frame as the packet data.  A filter result of
+ * zero drops the datagram, anything else trims it to that many bytes.
+ *
+ * Whether the kernel runs the filters through its JIT depends on the
+ * net.core.bpf_jit_enable sysctl when they are attached; the
+ * bpf_filter_corpus.sh wrapper runs the corpus with the JIT off and on.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include <sys/socket.h>
+#include <linux/filter.h>
+
+#define ARRAY_SIZE(x)	(sizeof(x) / sizeof((x)[0]))
+
+#define MAX_FRAME	1514
+#define NR_FRAMES	256
+#define NR_RANDOM	192
+
+#define LD_ABS(size, k)	BPF_STMT(BPF_LD | (size) | BPF_ABS, k)
+#define LD_IND(size, k)	BPF_STMT(BPF_LD | (size) | BPF_IND, k)
+#define LD_ANC(anc)	BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + (anc))
+#define JEQ(k, jt, jf)	BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, k, jt, jf)
+#define RET(k)		BPF_STMT(BPF_RET | BPF_K, k)
+
+struct filter {
+	const char *name;
+	struct sock_filter insns[40];
+	unsigned int len;
+};
+
+#define FILTER(n, ...)							\
+	{								\
+		.name	= n,						\
+		.insns	= { __VA_ARGS__ },				\
+		.len	= ARRAY_SIZE(((struct sock_filter []){ __VA_ARGS__ })), \
+	}
+
+static const struct filter filters[] = {
+	FILTER("ip",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("arp",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x806, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("icmp",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 3),
+		LD_ABS(BPF_B, 23),
+		JEQ(1, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("tcp port 80",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x86dd, 0, 6),
+		LD_ABS(BPF_B, 20),
+		JEQ(6, 0, 15),
+		LD_ABS(BPF_H, 54),
+		JEQ(80, 12, 0),
+		LD_ABS(BPF_H, 56),
+		JEQ(80, 10, 11),
+		JEQ(0x800, 0, 10),
+		LD_ABS(BPF_B, 23),
+		JEQ(6, 0, 8),
+		LD_ABS(BPF_H, 20),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 6, 0),
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+		LD_IND(BPF_H, 14),
+		JEQ(80, 2, 0),
+		LD_IND(BPF_H, 16),
+		JEQ(80, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("udp dst port 53",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x86dd, 0, 4),
+		LD_ABS(BPF_B, 20),
+		JEQ(17, 0, 11),
+		LD_ABS(BPF_H, 56),
+		JEQ(53, 8, 9),
+		JEQ(0x800, 0, 8),
+		LD_ABS(BPF_B, 23),
+		JEQ(17, 0, 6),
+		LD_ABS(BPF_H, 20),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 4, 0),
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+		LD_IND(BPF_H, 16),
+		JEQ(53, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("host 10.0.0.1",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 4),
+		LD_ABS(BPF_W, 26),
+		JEQ(0x0a000001, 8, 0),
+		LD_ABS(BPF_W, 30),
+		JEQ(0x0a000001, 6, 7),
+		JEQ(0x806, 1, 0),
+		JEQ(0x8035, 0, 5),
+		LD_ABS(BPF_W, 28),
+		JEQ(0x0a000001, 2, 0),
+		LD_ABS(BPF_W, 38),
+		JEQ(0x0a000001, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("ip src net 192.168.0.0/16",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 4),
+		LD_ABS(BPF_W, 26),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xffff0000),
+		JEQ(0xc0a80000, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("tcp[tcpflags] & tcp-syn != 0",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 8),
+		LD_ABS(BPF_B, 23),
+		JEQ(6, 0, 6),
+		LD_ABS(BPF_H, 20),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 4, 0),
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 14),
+		LD_IND(BPF_B, 27),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x2, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("vlan and udp",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x8100, 0, 5),
+		LD_ABS(BPF_H, 16),
+		JEQ(0x800, 0, 3),
+		LD_ABS(BPF_B, 27),
+		JEQ(17, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("ip[2:2] > 100 and ip[8] < 64",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 5),
+		LD_ABS(BPF_H, 16),
+		BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 100, 0, 3),
+		LD_ABS(BPF_B, 22),
+		BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 64, 1, 0),
+		RET(65535),
+		RET(0)),
+	FILTER("greater 100",
+		BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 100, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("less 64",
+		BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 64, 1, 0),
+		RET(65535),
+		RET(0)),
+	FILTER("ip, snaplen 42",
+		LD_ABS(BPF_H, 12),
+		JEQ(0x800, 0, 1),
+		RET(42),
+		RET(0)),
+
+	/* ancillary loads; the JIT leaves pkttype to the interpreter */
+	FILTER("pkttype host",
+		LD_ANC(SKF_AD_PKTTYPE),
+		JEQ(0, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("protocol, mark, queue, rxhash",
+		LD_ANC(SKF_AD_PROTOCOL),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		LD_ANC(SKF_AD_MARK),
+		BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		LD_ANC(SKF_AD_QUEUE),
+		BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		LD_ANC(SKF_AD_RXHASH),
+		BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+		JEQ(0, 0, 1),
+		RET(65535),
+		RET(0)),
+	FILTER("ifindex, no device",
+		LD_ANC(SKF_AD_IFINDEX),
+		RET(65535)),
+
+	/* hand written: every ALU opcode, scratch memory, ret a */
+	FILTER("alu",
+		LD_ABS(BPF_H, 16),
+		BPF_STMT(BPF_ST, 0),
+		BPF_STMT(BPF_LDX | BPF_IMM, 3),
+		BPF_STMT(BPF_ALU | BPF_MUL | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 2),
+		BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 7),
+		BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 5),
+		BPF_STMT(BPF_ALU | BPF_DIV | BPF_K, 3),
+		BPF_STMT(BPF_ST, 1),
+		LD_ABS(BPF_B, 14),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2),
+		BPF_STMT(BPF_ALU | BPF_OR | BPF_K, 1),
+		BPF_STMT(BPF_LDX | BPF_MEM, 1),
+		BPF_STMT(BPF_ALU | BPF_SUB | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_NEG, 0),
+		BPF_STMT(BPF_ST, 2),
+		BPF_STMT(BPF_LD | BPF_MEM, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x1f),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		BPF_STMT(BPF_LD | BPF_MEM, 2),
+		BPF_STMT(BPF_ALU | BPF_RSH | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 11),
+		BPF_STMT(BPF_ALU | BPF_OR | BPF_X, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_X, 0),
+		BPF_STMT(BPF_STX, 3),
+		BPF_STMT(BPF_LDX | BPF_MEM, 0),
+		BPF_STMT(BPF_ALU | BPF_DIV | BPF_X, 0),
+		BPF_STMT(BPF_LD | BPF_MEM, 3),
+		BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 9),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 4),
+		BPF_STMT(BPF_RET | BPF_A, 0)),
+
+	/* hand written: jumps against X, ja, txa, ldx len */
+	FILTER("jmp x",
+		LD_ABS(BPF_B, 15),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		LD_ABS(BPF_B, 16),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_X, 0, 0, 1),
+		RET(10),
+		BPF_JUMP(BPF_JMP | BPF_JGT | BPF_X, 0, 0, 3),
+		BPF_JUMP(BPF_JMP | BPF_JSET | BPF_X, 0, 0, 1),
+		RET(20),
+		RET(30),
+		BPF_STMT(BPF_LDX | BPF_W | BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP | BPF_JGE | BPF_X, 0, 0, 1),
+		BPF_STMT(BPF_JMP | BPF_JA, 1),
+		RET(40),
+		BPF_STMT(BPF_MISC | BPF_TXA, 0),
+		BPF_STMT(BPF_ALU | BPF_SUB | BPF_K, 1),
+		BPF_STMT(BPF_RET | BPF_A, 0)),
+
+	/* loads at the very end of the frame and just past it */
+	FILTER("last byte",
+		BPF_STMT(BPF_LDX | BPF_W | BPF_LEN, 0),
+		LD_IND(BPF_B, 0xffffffff),
+		BPF_STMT(BPF_ALU | BPF_ADD | BPF_K, 1),
+		BPF_STMT(BPF_RET | BPF_A, 0)),
+	FILTER("word past the end",
+		BPF_STMT(BPF_LDX | BPF_W | BPF_LEN, 0),
+		LD_IND(BPF_W, 0xfffffffd),
+		RET(65535)),
+	FILTER("ldh [x + 64]",
+		BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+		BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, 64, 1, 0),
+		RET(0),
+		BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 64),
+		LD_IND(BPF_H, 64),
+		RET(65535)),
+};
+
+/*
+ * Reference interpreter, following sk_run_filter().  Ancillary loads see
+ * what they see for an AF_UNIX datagram: no device, protocol, mark, queue
+ * and rxhash 0, pkt_type PACKET_HOST.
+ */
+static uint32_t reciprocal_value(uint32_t k)
+{
+	uint64_t val = (1ULL << 32) + (k - 1);
+
+	return val / k;
+}
+
+static int load(const uint8_t *pkt, unsigned int len, uint32_t k,
+		unsigned int size, uint32_t *val)
+{
+	unsigned int i;
+
+	if ((int32_t)k < 0 || k + size > len)
+		return -1;
+	for (*val = 0, i = 0; i < size; i++)
+		*val = *val << 8 | pkt[k + i];
+	return 0;
+}
+
+static uint32_t run_filter(const struct filter *f, const uint8_t *pkt,
+			   unsigned int len)
+{
+	static const unsigned int sizes[] = {
+		[BPF_W >> 3] = 4, [BPF_H >> 3] = 2, [BPF_B >> 3] = 1,
+	};
+	uint32_t A = 0, X = 0, mem[BPF_MEMWORDS] = { 0 };
+	unsigned int pc;
+
+	for (pc = 0; pc < f->len; pc++) {
+		const struct sock_filter *ins = &f->insns[pc];
+		uint32_t k = ins->k, *dst, src;
+
+		switch (BPF_CLASS(ins->code)) {
+		case BPF_LD:
+		case BPF_LDX:
+			dst = BPF_CLASS(ins->code) == BPF_LD ? &A : &X;
+			switch (BPF_MODE(ins->code)) {
+			case BPF_IMM:
+				*dst = k;
+				break;
+			case BPF_LEN:
+				*dst = len;
+				break;
+			case BPF_MEM:
+				*dst = mem[k];
+				break;
+			case BPF_MSH:
+				if (load(pkt, len, k, 1, &X))
+					return 0;
+				X = (X & 0xf) << 2;
+				break;
+			case BPF_IND:
+				k += X;
+				/* fall through */
+			case BPF_ABS:
+				if (ins->k >= (uint32_t)SKF_AD_OFF &&
+				    BPF_MODE(ins->code) == BPF_ABS) {
+					if (k == SKF_AD_OFF + SKF_AD_IFINDEX)
+						return 0;
+					A = 0;
+					break;
+				}
+				if (load(pkt, len, k,
+					 sizes[BPF_SIZE(ins->code) >> 3], &A))
+					return 0;
+				break;
+			}
+			break;
+		case BPF_ST:
+			mem[k] = A;
+			break;
+		case BPF_STX:
+			mem[k] = X;
+			break;
+		case BPF_ALU:
+			src = BPF_SRC(ins->code) == BPF_X ? X : k;
+			switch (BPF_OP(ins->code)) {
+			case BPF_ADD:
+				A += src;
+				break;
+			case BPF_SUB:
+				A -= src;
+				break;
+			case BPF_MUL:
+				A *= src;
+				break;
+			case BPF_DIV:
+				if (BPF_SRC(ins->code) == BPF_K) {
+					/* sk_chk_filter() turns k into its
+					 * reciprocal
+					 */
+					A = ((uint64_t)A *
+					     reciprocal_value(k)) >> 32;
+					break;
+				}
+				if (!X)
+					return 0;
+				A /= X;
+				break;
+			case BPF_AND:
+				A &= src;
+				break;
+			case BPF_OR:
+				A |= src;
+				break;
+			case BPF_LSH:
+				A <<= src;
+				break;
+			case BPF_RSH:
+				A >>= src;
+				break;
+			case BPF_NEG:
+				A = -A;
+				break;
+			}
+			break;
+		case BPF_JMP:
+			src = BPF_SRC(ins->code) == BPF_X ? X : k;
+			switch (BPF_OP(ins->code)) {
+			case BPF_JA:
+				pc += k;
+				break;
+			case BPF_JEQ:
+				pc += A == src ? ins->jt : ins->jf;
+				break;
+			case BPF_JGT:
+				pc += A > src ? ins->jt : ins->jf;
+				break;
+			case BPF_JGE:
+				pc += A >= src ? ins->jt : ins->jf;
+				break;
+			case BPF_JSET:
+				pc += A & src ? ins->jt : ins->jf;
+				break;
+			}
+			break;
+		case BPF_RET:
+			return BPF_RVAL(ins->code) == BPF_A ? A : k;
+		case BPF_MISC:
+			if (BPF_MISCOP(ins->code) == BPF_TAX)
+				X = A;
+			else
+				A = X;
+			break;
+		}
+	}
+	return 0;
+}
+
+/* The frames */
+struct frame {
+	uint8_t data[MAX_FRAME];
+	unsigned int len;
+};
+
+static struct frame frames[NR_FRAMES];
+static unsigned int nr_frames;
+
+static uint8_t *put16(uint8_t *p, uint16_t v)
+{
+	*p++ = v >> 8;
+	*p++ = v;
+	return p;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v)
+{
+	p = put16(p, v >> 16);
+	return put16(p, v);
+}
+
+static uint8_t *put_eth(uint8_t *p, uint16_t type)
+{
+	static const uint8_t macs[12] = {
+		0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+		0xd0, 0x39, 0x72, 0x00, 0x00, 0x01,
+	};
+
+	memcpy(p, macs, sizeof(macs));
+	return put16(p + sizeof(macs), type);
+}
+
+/* IPv4 header with @optlen bytes of options, then @payload bytes */
+static uint8_t *put_ip(uint8_t *p, uint8_t proto, uint32_t saddr,
+		       uint32_t daddr, unsigned int optlen, uint16_t frag,
+		       unsigned int payload)
+{
+	unsigned int hlen = 20 + optlen;
+
+	*p++ = 0x40 | hlen / 4;
+	*p++ = 0;
+	p = put16(p, hlen + payload);
+	p = put16(p, 0x1234);
+	p = put16(p, frag);
+	*p++ = 64;
+	*p++ = proto;
+	p = put16(p, 0);
+	p = put32(p, saddr);
+	p = put32(p, daddr);
+	memset(p, 1, optlen);	/* NOPs */
+	return p + optlen;
+}
+
+static uint8_t *put_ip6(uint8_t *p, uint8_t nexthdr, unsigned int payload)
+{
+	p = put32(p, 0x60000000);
+	p = put16(p, payload);
+	*p++ = nexthdr;
+	*p++ = 64;
+	memset(p, 0, 32);
+	p[15] = 1;
+	p[31] = 2;
+	return p + 32;
+}
+
+static uint8_t *put_ports(uint8_t *p, uint16_t sport, uint16_t dport)
+{
+	p = put16(p, sport);
+	return put16(p, dport);
+}
+
+static uint8_t *put_tcp(uint8_t *p, uint16_t sport, uint16_t dport,
+			uint8_t flags)
+{
+	p = put_ports(p, sport, dport);
+	p = put32(p, 1);
+	p = put32(p, 0);
+	*p++ = 5 << 4;
+	*p++ = flags;
+	p = put16(p, 65535);
+	return put32(p, 0);
+}
+
+static uint8_t *put_udp(uint8_t *p, uint16_t sport, uint16_t dport,
+			unsigned int payload)
+{
+	p = put_ports(p, sport, dport);
+	p = put16(p, 8 + payload);
+	return put16(p, 0);
+}
+
+static void add_frame(const uint8_t *start, const uint8_t *end)
+{
+	frames[nr_frames++].len = end - start;
+}
+
+static uint8_t *next_frame(void)
+{
+	return frames[nr_frames].data;
+}
+
+static void build_frames(unsigned int seed)
+{
+	uint8_t *p, *s;
+	unsigned int i, j;
+
+	/* tcp syn 10.0.0.1:1234 > 10.0.0.2:80 */
+	s = p = next_frame();
+	p = put_eth(p, 0x800);
+	p = put_ip(p, 6, 0x0a000001, 0x0a000002, 0, 0, 20);
+	p = put_tcp(p, 1234, 80, 0x02);
+	add_frame(s, p);
+
+	/* same, ack with 12 bytes of IP options and some data */
+	s = p = next_frame();
+	p = put_eth(p, 0x800);
+	p = put_ip(p, 6, 0x0a000002, 0x0a000001, 12, 0, 20 + 100);
+	p = put_tcp(p, 80, 1234, 0x10);
+	memset(p, 'x', 100);
+	add_frame(s, p + 100);
+
+	/* non-first fragment of a tcp segment to port 80 */
+	s = p = next_frame();
+	p = put_eth(p, 0x800);
+	p = put_ip(p, 6, 0x0a000001, 0x0a000002, 0, 0x2000 | 185, 20);
+	p = put_tcp(p, 1234, 80, 0x02);
+	add_frame(s, p);
+
+	/* dns query 192.168.1.5:5353 > 8.8.8.8:53 */
+	s = p = next_frame();
+	p = put_eth(p, 0x800);
+	p = put_ip(p, 17, 0xc0a80105, 0x08080808, 0, 0, 8 + 30);
+	p = put_udp(p, 5353, 53, 30);
+	memset(p, 0, 30);
+	add_frame(s, p + 30);
+
+	/* large udp datagram */
+	s = p = next_frame();
+	p = put_eth(p, 0x800);
+	p = put_ip(p, 17, 0xc0a80001, 0x0a000001, 0, 0, 8 + 1400);
+	p = put_udp(p, 40000, 9, 1400);
+	for (i = 0; i < 1400; i++)
+		p[i] = i;
+	add_frame(s, p + 1400);
+
+	/* icmp echo */
+	s = p = next_frame();
+	p = put_eth(p, 0x800);
+	p = put_ip(p, 1, 0x0a000003, 0x0a000001, 0, 0, 64);
+	*p++ = 8;
+	memset(p, 0, 63);
+	add_frame(s, p + 63);
+
+	/* ipv6 tcp syn to port 80, ipv6 udp to port 53 */
+	s = p = next_frame();
+	p = put_eth(p, 0x86dd);
+	p = put_ip6(p, 6, 20);
+	p = put_tcp(p, 4321, 80, 0x02);
+	add_frame(s, p);
+
+	s = p = next_frame();
+	p = put_eth(p, 0x86dd);
+	p = put_ip6(p, 17, 8 + 20);
+	p = put_udp(p, 4321, 53, 20);
+	memset(p, 0, 20);
+	add_frame(s, p + 20);
+
+	/* arp who-has 10.0.0.1 */
+	s = p = next_frame();
+	p = put_eth(p, 0x806);
+	p = put32(p, 0x00010800);
+	p = put32(p, 0x06040001);
+	memcpy(p, s + 6, 6);
+	p = put32(p + 6, 0x0a000002);
+	memset(p, 0, 6);
+	p = put32(p + 6, 0x0a000001);
+	add_frame(s, p);
+
+	/* 802.1q tagged udp */
+	s = p = next_frame();
+	p = put_eth(p, 0x8100);
+	p = put16(p, 0x0064);
+	p = put16(p, 0x800);
+	p = put_ip(p, 17, 0x0a000001, 0x0a000002, 0, 0, 8 + 10);
+	p = put_udp(p, 1000, 2000, 10);
+	memset(p, 0, 10);
+	add_frame(s, p + 10);
+
+	/* frames cut short in the middle of every header */
+	for (i = 1; i <= 54; i += (i < 20 ? 1 : 3)) {
+		memcpy(next_frame(), frames[0].data, i);
+		frames[nr_frames++].len = i;
+	}
+
+	/*
+	 * Random frames, biased towards the ethertypes, header lengths and
+	 * protocols the filters look for so they get past the first checks.
+	 */
+	srand(seed);
+	for (i = 0; i < NR_RANDOM && nr_frames < NR_FRAMES; i++) {
+		static const uint16_t types[] = {
+			0x800, 0x800, 0x800, 0x86dd, 0x806, 0x8100, 0x88cc,
+		};
+		static const uint8_t protos[] = { 6, 6, 17, 17, 1, 47 };
+		struct frame *f = &frames[nr_frames++];
+
+		f->len = 1 + rand() % 200;
+		for (j = 0; j < f->len; j++)
+			f->data[j] = rand();
+		if (f->len < 24)
+			continue;
+		put16(f->data + 12, types[rand() % ARRAY_SIZE(types)]);
+		f->data[14] = 0x40 | (5 + rand() % 3);
+		f->data[23] = protos[rand() % ARRAY_SIZE(protos)];
+		if (rand() % 2)
+			put16(f->data + 20, 0);
+	}
+}
+
+static void hexdump(const struct frame *f)
+{
+	unsigned int i;
+
+	for (i = 0; i < f->len && i < 64; i++)
+		fprintf(stderr, "%02x%s", f->data[i], i % 16 == 15 ? "\n" : " ");
+	fprintf(stderr, "%s", i % 16 ? "\n" : "");
+}
+
+static int jit_enabled(void)
+{
+	FILE *fp = fopen("/proc/sys/net/core/bpf_jit_enable", "r");
+	int val = 0;
+
+	if (fp) {
+		if (fscanf(fp, "%d", &val) != 1)
+			val = 0;
+		fclose(fp);
+	}
+	return val;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t buf[MAX_FRAME];
+	unsigned int i, j, seed = 1, failed = 0;
+	struct sock_fprog prog;
+	struct filter f;
+	int fds[2];
+
+	if (argc > 1)
+		seed = strtoul(argv[1], NULL, 0);
+
+	build_frames(seed);
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds)) {
+		perror("socketpair");
+		return 1;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(filters); i++) {
+		f = filters[i];
+		prog.len = f.len;
+		prog.filter = f.insns;
+		if (setsockopt(fds[1], SOL_SOCKET, SO_ATTACH_FILTER,
+			       &prog, sizeof(prog))) {
+			fprintf(stderr, "%s: ", f.name);
+			perror("SO_ATTACH_FILTER");
+			failed++;
+			continue;
+		}
+
+		for (j = 0; j < nr_frames; j++) {
+			const struct frame *fr = &frames[j];
+			uint32_t want = run_filter(&f, fr->data, fr->len);
+			ssize_t got;
+
+			if (want > fr->len)
+				want = fr->len;
+
+			if (send(fds[0], fr->data, fr->len, 0) != fr->len) {
+				perror("send");
+				return 1;
+			}
+			got = recv(fds[1], buf, sizeof(buf), MSG_DONTWAIT);
+			if (got < 0 && errno != EAGAIN) {
+				perror("recv");
+				return 1;
+			}
+
+			/* a dropped frame is not there at all */
+			if (want ? got == want : got < 0)
+				continue;
+
+			fprintf(stderr, "FAIL: \"%s\" frame %u (%u bytes): "
+				"expected %s%u, got %s%zd\n", f.name, j,
+				fr->len, want ? "" : "drop ", want,
+				got < 0 ? "drop " : "", got < 0 ? 0 : got);
+			hexdump(fr);
+			failed++;
+		}
+	}
+
+	printf("%zu filters, %u frames, jit %s: %u failures\n",
+	       ARRAY_SIZE(filters), nr_frames,
+	       jit_enabled() ? "on" : "off", failed);
+	return failed ? 1 : 0;
+}
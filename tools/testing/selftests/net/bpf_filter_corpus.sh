@@ -0,0 +1,25 @@
+#!/bin/sh
+#
+# Run the classic BPF filter corpus through the interpreter and, where
+# the kernel has one, the JIT.  The filters only go through the JIT if
+# it is enabled when they are attached.
+
+SYSCTL=/proc/sys/net/core/bpf_jit_enable
+
+if [ ! -w $SYSCTL ]; then
+	echo "$0: no $SYSCTL or not root, running with the JIT as it is"
+	exec ./bpf_filter_corpus "$@"
+fi
+
+old=$(cat $SYSCTL)
+trap 'echo $old > $SYSCTL' EXIT
+
+ret=0
+for jit in 0 1; do
+	if ! (echo $jit > $SYSCTL) 2>/dev/null; then
+		echo "cannot set bpf_jit_enable to $jit, skipped"
+		continue
+	fi
+	./bpf_filter_corpus "$@" || ret=1
+done
+exit $ret
@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# Run busy_poll_pingpong between two network namespaces joined by a veth
+# pair, first sleeping in recv() and then busy polling for 100 usecs.
+#
+# veth must be in NAPI mode (modprobe veth napi_delay=<usecs>) so that
+# received frames carry a napi id and wait an emulated interrupt latency
+# before the softirq delivers them. Busy polling picks them up without
+# that wait, so its round trips should be clearly shorter.
+
+NS1=bp-client
+NS2=bp-server
+BUSY_POLL_US=100
+NAPI_DELAY=/sys/module/veth/parameters/napi_delay
+
+if [ "$(id -u)" != 0 ]; then
+	echo "$0: must be run as root" >&2
+	exit 1
+fi
+
+if [ ! -r $NAPI_DELAY ] || [ "$(cat $NAPI_DELAY)" = 0 ]; then
+	echo "$0: veth is not in NAPI mode, load it with napi_delay=50" >&2
+	exit 0
+fi
+
+cleanup() {
+	[ -n "$server" ] && kill $server 2>/dev/null
+	ip netns del $NS1 2>/dev/null
+	ip netns del $NS2 2>/dev/null
+}
+trap cleanup EXIT
+
+ip netns add $NS1 || exit 1
+ip netns add $NS2 || exit 1
+ip link add bp0 netns $NS1 type veth peer name bp1 netns $NS2 || exit 1
+ip -n $NS1 addr add 192.168.99.1/24 dev bp0 || exit 1
+ip -n $NS2 addr add 192.168.99.2/24 dev bp1 || exit 1
+ip -n $NS1 link set bp0 up || exit 1
+ip -n $NS2 link set bp1 up || exit 1
+
+# the server only answers the client it first hears from: one per run
+pingpong() {
+	ip netns exec $NS2 ./busy_poll_pingpong -s -b $1 &
+	server=$!
+	sleep 1
+	shift
+	ip netns exec $NS1 ./busy_poll_pingpong -c 192.168.99.2 "$@"
+	ret=$?
+	kill $server
+	wait $server 2>/dev/null
+	server=
+	return $ret
+}
+
+plain=$(pingpong 0 "$@") || exit 1
+echo "$plain"
+busy=$(pingpong $BUSY_POLL_US -b $BUSY_POLL_US "$@") || exit 1
+echo "$busy"
+
+avg() {
+	echo "$1" | sed 's/.*avg *\([0-9.]*\).*/\1/'
+}
+
+if ! awk "BEGIN { exit !($(avg "$busy") < $(avg "$plain")) }"; then
+	echo "FAIL: busy polling did not shorten the round trip" >&2
+	exit 1
+fi
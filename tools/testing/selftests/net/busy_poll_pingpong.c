@@ -0,0 +1,225 @@
+/*
+ * UDP ping-pong latency, with and without socket busy polling.
+ *
+ *	busy_poll_pingpong -s [-p port] [-b usecs] [-l len]
+ *	busy_poll_pingpong -c addr [-p port] [-b usecs] [-l len] [-n count]
+ *
+ * The server echoes every datagram back to the first client that talks
+ * to it. The client sends count datagrams one at a time, waits for each
+ * echo and reports the round trip times. With -b both ends set
+ * SO_BUSY_POLL, so a blocking recv() spins on the napi context that last
+ * fed the socket instead of sleeping until the receive interrupt. Both
+ * sockets are connected, as only connected UDP sockets record the napi
+ * id. See busy_poll.sh for a run over a veth pair in NAPI mode.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL	46
+#endif
+
+#define MAX_LEN		1472
+
+static int cfg_server;
+static const char *cfg_addr;
+static int cfg_port = 8002;
+static int cfg_busy_poll;
+static int cfg_len = 64;
+static int cfg_count = 10000;
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		die("clock_gettime");
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int new_socket(void)
+{
+	int fd;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		die("socket");
+	if (cfg_busy_poll &&
+	    setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL,
+		       &cfg_busy_poll, sizeof(cfg_busy_poll)))
+		die("setsockopt SO_BUSY_POLL");
+	return fd;
+}
+
+static void do_server(void)
+{
+	struct sockaddr_in addr, peer;
+	socklen_t peer_len = sizeof(peer);
+	char buf[MAX_LEN];
+	int fd, one = 1, ret;
+
+	fd = new_socket();
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+		die("setsockopt SO_REUSEADDR");
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(cfg_port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(fd, (void *)&addr, sizeof(addr)))
+		die("bind");
+
+	ret = recvfrom(fd, buf, sizeof(buf), 0, (void *)&peer, &peer_len);
+	if (ret < 0)
+		die("recvfrom");
+	if (connect(fd, (void *)&peer, peer_len))
+		die("connect");
+
+	for (;;) {
+		if (send(fd, buf, ret, 0) != ret)
+			die("send");
+		ret = recv(fd, buf, sizeof(buf), 0);
+		if (ret < 0)
+			die("recv");
+	}
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void do_client(void)
+{
+	struct sockaddr_in addr;
+	struct timeval tv = { .tv_sec = 1 };
+	char buf[MAX_LEN];
+	double *rtt, start, total = 0;
+	int fd, i;
+
+	rtt = calloc(cfg_count, sizeof(*rtt));
+	if (!rtt)
+		die("calloc");
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(cfg_port);
+	if (inet_pton(AF_INET, cfg_addr, &addr.sin_addr) != 1) {
+		fprintf(stderr, "bad address: %s\n", cfg_addr);
+		exit(1);
+	}
+
+	fd = new_socket();
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)))
+		die("setsockopt SO_RCVTIMEO");
+	if (connect(fd, (void *)&addr, sizeof(addr)))
+		die("connect");
+
+	memset(buf, 'p', cfg_len);
+
+	/* let the server learn our address and warm up both paths */
+	for (i = 0; i < 100; i++) {
+		if (send(fd, buf, cfg_len, 0) != cfg_len)
+			die("send");
+		if (recv(fd, buf, sizeof(buf), 0) != cfg_len)
+			die("recv");
+	}
+
+	for (i = 0; i < cfg_count; i++) {
+		start = now_us();
+		if (send(fd, buf, cfg_len, 0) != cfg_len)
+			die("send");
+		if (recv(fd, buf, sizeof(buf), 0) != cfg_len)
+			die("recv");
+		rtt[i] = now_us() - start;
+		total += rtt[i];
+	}
+	close(fd);
+
+	qsort(rtt, cfg_count, sizeof(*rtt), cmp_double);
+	printf("busy_poll %3d us: rtt avg %8.1f us  p50 %8.1f us  "
+	       "p99 %8.1f us  max %8.1f us\n",
+	       cfg_busy_poll, total / cfg_count, rtt[cfg_count / 2],
+	       rtt[cfg_count * 99 / 100], rtt[cfg_count - 1]);
+	free(rtt);
+}
+
+static void __attribute__((noreturn)) usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s -s | -c addr [-p port] [-b usecs] "
+		"[-l len] [-n count]\n", prog);
+	exit(1);
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "sc:p:b:l:n:")) != -1) {
+		switch (c) {
+		case 's':
+			cfg_server = 1;
+			break;
+		case 'c':
+			cfg_addr = optarg;
+			break;
+		case 'p':
+			cfg_port = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			cfg_busy_poll = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			cfg_len = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			cfg_count = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (cfg_server == !!cfg_addr)
+		usage(argv[0]);
+	if (cfg_len <= 0 || cfg_len > MAX_LEN) {
+		fprintf(stderr, "length must be 1..%d\n", MAX_LEN);
+		exit(1);
+	}
+	if (cfg_count <= 0) {
+		fprintf(stderr, "need at least one round trip\n");
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	parse_opts(argc, argv);
+
+	if (cfg_server)
+		do_server();
+	else
+		do_client();
+	return 0;
+}
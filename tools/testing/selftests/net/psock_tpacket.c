@@ -0,0 +1,461 @@
+/*
+ * Loopback test of the PF_PACKET memory mapped rings.
+ *
+ * For TPACKET_V1, V2 and V3, captures a burst of UDP datagrams sent to
+ * ourselves through an rx-ring, and sends a burst through a tx-ring that a
+ * second packet socket then has to see coming back in on lo.  The V3
+ * rx-ring packs packets into blocks, so the test also reports how many
+ * blocks (and thus wakeups) it took.
+ *
+ * Needs CAP_NET_RAW and an up loopback device.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <net/if.h>
+
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+
+#define NUM_PACKETS	100
+#define PAYLOAD_LEN	100
+#define TEST_PORT	8787
+#define PAYLOAD_BYTE	0xa5
+
+#define BLOCK_SIZE	(4096 << 2)
+#define BLOCK_NR	64
+#define FRAME_SIZE	(TPACKET_ALIGNMENT << 7)
+#define FRAME_NR	(BLOCK_SIZE / FRAME_SIZE * BLOCK_NR)
+
+#ifndef TPACKET3_HDRLEN
+#error "kernel headers without TPACKET_V3"
+#endif
+
+struct ring {
+	void *map;
+	size_t map_len;
+	int version;
+	unsigned int frame_nr;
+	unsigned int frame_size;
+	unsigned int block_nr;
+	unsigned int block_size;
+};
+
+static const char *vname[] = { "TPACKET_V1", "TPACKET_V2", "TPACKET_V3" };
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+/* only IPv4/UDP to TEST_PORT: lo sees each datagram going out and in */
+static void attach_filter(int fd)
+{
+	struct sock_filter code[] = {
+		{ 0x28, 0, 0, 0x0000000c },	/* ldh [12]		*/
+		{ 0x15, 0, 5, 0x00000800 },	/* jeq #0x800		*/
+		{ 0x30, 0, 0, 0x00000017 },	/* ldb [23]		*/
+		{ 0x15, 0, 3, 0x00000011 },	/* jeq #17 (udp)	*/
+		{ 0x28, 0, 0, 0x00000024 },	/* ldh [36] (dport)	*/
+		{ 0x15, 0, 1, TEST_PORT },	/* jeq #TEST_PORT	*/
+		{ 0x06, 0, 0, 0x0000ffff },	/* ret #65535		*/
+		{ 0x06, 0, 0, 0x00000000 },	/* ret #0		*/
+	};
+	struct sock_fprog prog = {
+		.len = sizeof(code) / sizeof(code[0]),
+		.filter = code,
+	};
+
+	if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)))
+		die("setsockopt SO_ATTACH_FILTER");
+}
+
+static int pfsocket(int version)
+{
+	int fd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+
+	if (fd < 0)
+		die("socket PF_PACKET");
+	if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version,
+		       sizeof(version)))
+		die("setsockopt PACKET_VERSION");
+	return fd;
+}
+
+static void setup_ring(int fd, struct ring *ring, int version, int type)
+{
+	struct tpacket_req3 req3;
+	struct tpacket_req req;
+	int err;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->version = version;
+	ring->block_size = BLOCK_SIZE;
+	ring->block_nr = BLOCK_NR;
+	ring->frame_size = FRAME_SIZE;
+	ring->frame_nr = FRAME_NR;
+
+	if (version == TPACKET_V3) {
+		memset(&req3, 0, sizeof(req3));
+		req3.tp_block_size = ring->block_size;
+		req3.tp_block_nr = ring->block_nr;
+		req3.tp_frame_size = ring->frame_size;
+		req3.tp_frame_nr = ring->frame_nr;
+		/* block knobs are rx-ring only */
+		if (type == PACKET_RX_RING) {
+			req3.tp_retire_blk_tov = 64;
+			req3.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+		}
+		err = setsockopt(fd, SOL_PACKET, type, &req3, sizeof(req3));
+	} else {
+		req.tp_block_size = ring->block_size;
+		req.tp_block_nr = ring->block_nr;
+		req.tp_frame_size = ring->frame_size;
+		req.tp_frame_nr = ring->frame_nr;
+		err = setsockopt(fd, SOL_PACKET, type, &req, sizeof(req));
+	}
+	if (err)
+		die(type == PACKET_RX_RING ? "setsockopt PACKET_RX_RING" :
+					     "setsockopt PACKET_TX_RING");
+
+	ring->map_len = (size_t)ring->block_size * ring->block_nr;
+	ring->map = mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_LOCKED, fd, 0);
+	if (ring->map == MAP_FAILED)
+		die("mmap");
+}
+
+static void bind_lo(int fd, int proto)
+{
+	struct sockaddr_ll ll;
+
+	memset(&ll, 0, sizeof(ll));
+	ll.sll_family = PF_PACKET;
+	ll.sll_protocol = htons(proto);
+	ll.sll_ifindex = if_nametoindex("lo");
+	if (!ll.sll_ifindex)
+		die("if_nametoindex lo");
+	if (bind(fd, (struct sockaddr *)&ll, sizeof(ll)))
+		die("bind PF_PACKET");
+}
+
+static void *frame(struct ring *ring, unsigned int i)
+{
+	unsigned int per_block = ring->block_size / ring->frame_size;
+
+	return (char *)ring->map + (i / per_block) * ring->block_size +
+	       (i % per_block) * ring->frame_size;
+}
+
+static void send_udp(int n)
+{
+	struct sockaddr_in sin;
+	char buf[PAYLOAD_LEN];
+	int fd, i;
+
+	fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0)
+		die("socket AF_INET");
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_port = htons(TEST_PORT);
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	memset(buf, PAYLOAD_BYTE, sizeof(buf));
+
+	for (i = 0; i < n; i++)
+		if (sendto(fd, buf, sizeof(buf), 0, (struct sockaddr *)&sin,
+			   sizeof(sin)) != sizeof(buf))
+			die("sendto");
+	close(fd);
+}
+
+static int check_payload(const unsigned char *pkt, unsigned int len)
+{
+	/* ethernet + ip + udp headers, then our payload */
+	const unsigned int off = ETH_HLEN + sizeof(struct iphdr) +
+				 sizeof(struct udphdr);
+
+	return len == off + PAYLOAD_LEN && pkt[off] == PAYLOAD_BYTE &&
+	       pkt[len - 1] == PAYLOAD_BYTE;
+}
+
+/* V1/V2: one frame per packet, handed over frame by frame */
+static int walk_frames(struct ring *ring, unsigned int *pos, int *bad)
+{
+	int n = 0;
+
+	for (;;) {
+		void *f = frame(ring, *pos);
+		unsigned long status;
+		unsigned int mac, len;
+
+		if (ring->version == TPACKET_V1) {
+			struct tpacket_hdr *h = f;
+
+			status = h->tp_status;
+			mac = h->tp_mac;
+			len = h->tp_snaplen;
+		} else {
+			struct tpacket2_hdr *h = f;
+
+			status = h->tp_status;
+			mac = h->tp_mac;
+			len = h->tp_snaplen;
+		}
+		if (!(status & TP_STATUS_USER))
+			return n;
+		__sync_synchronize();
+
+		if (!check_payload((unsigned char *)f + mac, len))
+			(*bad)++;
+		n++;
+
+		__sync_synchronize();
+		if (ring->version == TPACKET_V1)
+			((struct tpacket_hdr *)f)->tp_status = TP_STATUS_KERNEL;
+		else
+			((struct tpacket2_hdr *)f)->tp_status = TP_STATUS_KERNEL;
+		*pos = (*pos + 1) % ring->frame_nr;
+	}
+}
+
+/* V3: packets packed back to back, handed over a block at a time */
+static int walk_blocks(struct ring *ring, unsigned int *pos, int *bad,
+		       int *blocks)
+{
+	int n = 0;
+
+	for (;;) {
+		struct tpacket_block_desc *bd = (void *)((char *)ring->map +
+					*pos * ring->block_size);
+		struct tpacket3_hdr *h;
+		unsigned int i;
+
+		if (!(bd->hdr.bh1.block_status & TP_STATUS_USER))
+			return n;
+		__sync_synchronize();
+
+		h = (void *)((char *)bd + bd->hdr.bh1.offset_to_first_pkt);
+		for (i = 0; i < bd->hdr.bh1.num_pkts; i++) {
+			if (!check_payload((unsigned char *)h + h->tp_mac,
+					   h->tp_snaplen))
+				(*bad)++;
+			n++;
+			h = (void *)((char *)h + h->tp_next_offset);
+		}
+		(*blocks)++;
+
+		__sync_synchronize();
+		bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+		*pos = (*pos + 1) % ring->block_nr;
+	}
+}
+
+static int test_rx(int version)
+{
+	int fd, total = 0, bad = 0, blocks = 0, wakeups = 0;
+	const int expected = 2 * NUM_PACKETS;
+	unsigned int pos = 0;
+	struct pollfd pfd;
+	struct ring ring;
+
+	fd = pfsocket(version);
+	attach_filter(fd);
+	setup_ring(fd, &ring, version, PACKET_RX_RING);
+	bind_lo(fd, ETH_P_ALL);
+
+	send_udp(NUM_PACKETS);
+
+	pfd.fd = fd;
+	pfd.events = POLLIN | POLLRDNORM | POLLERR;
+	while (total < expected) {
+		if (poll(&pfd, 1, 1000) <= 0)
+			break;
+		wakeups++;
+		if (version == TPACKET_V3)
+			total += walk_blocks(&ring, &pos, &bad, &blocks);
+		else
+			total += walk_frames(&ring, &pos, &bad);
+	}
+
+	munmap(ring.map, ring.map_len);
+	close(fd);
+
+	printf("test: %s rx-ring: %d/%d packets, %d wakeups", vname[version],
+	       total, expected, wakeups);
+	if (version == TPACKET_V3)
+		printf(", %d blocks", blocks);
+	if (total != expected || bad) {
+		printf(", %d bad ... FAIL\n", bad);
+		return 1;
+	}
+	printf(" ... PASS\n");
+	return 0;
+}
+
+static unsigned short ip_csum(const void *data, int len)
+{
+	const unsigned short *p = data;
+	unsigned int sum = 0;
+
+	while (len > 1) {
+		sum += *p++;
+		len -= 2;
+	}
+	while (sum >> 16)
+		sum = (sum & 0xffff) + (sum >> 16);
+	return ~sum;
+}
+
+static unsigned int build_packet(unsigned char *buf)
+{
+	struct ethhdr *eth = (struct ethhdr *)buf;
+	struct iphdr *iph = (struct iphdr *)(eth + 1);
+	struct udphdr *uh = (struct udphdr *)(iph + 1);
+	unsigned int len = sizeof(*iph) + sizeof(*uh) + PAYLOAD_LEN;
+
+	/* lo has an all zero address */
+	memset(eth, 0, sizeof(*eth));
+	eth->h_proto = htons(ETH_P_IP);
+
+	memset(iph, 0, sizeof(*iph));
+	iph->version = 4;
+	iph->ihl = 5;
+	iph->ttl = 64;
+	iph->protocol = IPPROTO_UDP;
+	iph->tot_len = htons(len);
+	iph->saddr = htonl(INADDR_LOOPBACK);
+	iph->daddr = htonl(INADDR_LOOPBACK);
+	iph->check = ip_csum(iph, sizeof(*iph));
+
+	uh->source = htons(TEST_PORT + 1);
+	uh->dest = htons(TEST_PORT);
+	uh->len = htons(sizeof(*uh) + PAYLOAD_LEN);
+	uh->check = 0;
+
+	memset(uh + 1, PAYLOAD_BYTE, PAYLOAD_LEN);
+	return ETH_HLEN + len;
+}
+
+static int test_tx(int version)
+{
+	int fd, rfd, i, total = 0, bad = 0;
+	unsigned char buf[FRAME_SIZE];
+	struct sockaddr_ll ll;
+	socklen_t alen;
+	struct ring ring;
+	ssize_t ret;
+
+	/* plain capture socket: counts the frames as lo hands them back */
+	rfd = socket(PF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+	if (rfd < 0)
+		die("socket PF_PACKET");
+	attach_filter(rfd);
+	bind_lo(rfd, ETH_P_ALL);
+
+	fd = pfsocket(version);
+	setup_ring(fd, &ring, version, PACKET_TX_RING);
+	bind_lo(fd, ETH_P_IP);
+
+	for (i = 0; i < NUM_PACKETS; i++) {
+		void *f = frame(&ring, i);
+
+		switch (version) {
+		case TPACKET_V1: {
+			struct tpacket_hdr *h = f;
+
+			h->tp_len = build_packet((unsigned char *)f +
+				TPACKET_HDRLEN - sizeof(struct sockaddr_ll));
+			__sync_synchronize();
+			h->tp_status = TP_STATUS_SEND_REQUEST;
+			break;
+		}
+		case TPACKET_V2: {
+			struct tpacket2_hdr *h = f;
+
+			h->tp_len = build_packet((unsigned char *)f +
+				TPACKET2_HDRLEN - sizeof(struct sockaddr_ll));
+			__sync_synchronize();
+			h->tp_status = TP_STATUS_SEND_REQUEST;
+			break;
+		}
+		case TPACKET_V3: {
+			struct tpacket3_hdr *h = f;
+
+			h->tp_next_offset = 0;
+			h->tp_len = build_packet((unsigned char *)f +
+				TPACKET3_HDRLEN - sizeof(struct sockaddr_ll));
+			__sync_synchronize();
+			h->tp_status = TP_STATUS_SEND_REQUEST;
+			break;
+		}
+		}
+	}
+
+	if (send(fd, NULL, 0, 0) < 0)
+		die("send tx-ring");
+
+	for (;;) {
+		struct pollfd pfd = { .fd = rfd, .events = POLLIN };
+
+		if (poll(&pfd, 1, 500) <= 0)
+			break;
+		alen = sizeof(ll);
+		ret = recvfrom(rfd, buf, sizeof(buf), 0,
+			       (struct sockaddr *)&ll, &alen);
+		if (ret < 0)
+			die("recvfrom");
+		if (ll.sll_pkttype != PACKET_HOST)
+			continue;
+		if (!check_payload(buf, ret))
+			bad++;
+		total++;
+	}
+
+	munmap(ring.map, ring.map_len);
+	close(fd);
+	close(rfd);
+
+	printf("test: %s tx-ring: %d/%d packets", vname[version], total,
+	       NUM_PACKETS);
+	if (total != NUM_PACKETS || bad) {
+		printf(", %d bad ... FAIL\n", bad);
+		return 1;
+	}
+	printf(" ... PASS\n");
+	return 0;
+}
+
+int main(void)
+{
+	int version, ret = 0;
+
+	for (version = TPACKET_V1; version <= TPACKET_V3; version++) {
+		ret |= test_rx(version);
+		ret |= test_tx(version);
+	}
+
+	if (ret)
+		printf("[FAIL]\n");
+	else
+		printf("[PASS]\n");
+	return ret;
+}
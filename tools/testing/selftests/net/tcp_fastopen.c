@@ -0,0 +1,230 @@
+/*
+ * TCP Fast Open request/response latency.
+ *
+ * Forks a server that listens with TCP_FASTOPEN on 127.0.0.1 and answers
+ * every request on a fresh connection, then times a number of request/
+ * response exchanges from the client, each on a new connection:
+ *
+ *	tcp_fastopen [-n conns] [-p port] [-r rtt_ms]
+ *
+ * Plain connections connect() and then send the request, so the response
+ * arrives two round trips after the first SYN. Fast Open connections pass
+ * the request to sendto(MSG_FASTOPEN); once the first of them has fetched
+ * a cookie, the request rides in the SYN and the response arrives one
+ * round trip after it. Run on a loopback with an artificial delay (see
+ * tcp_fastopen.sh) the saving is one RTT per connection; with -r the test
+ * fails unless at least half of that RTT is saved.
+ *
+ * Needs net.ipv4.tcp_fastopen to enable both client and server (3).
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef TCP_FASTOPEN
+#define TCP_FASTOPEN	23
+#endif
+
+#ifndef MSG_FASTOPEN
+#define MSG_FASTOPEN	0x20000000
+#endif
+
+#define REQ_LEN		64
+#define RESP_LEN	256
+
+static int cfg_conns = 20;
+static int cfg_port = 8001;
+static int cfg_rtt_ms;
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		die("clock_gettime");
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void setup_addr(struct sockaddr_in *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_port = htons(cfg_port);
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+static void recv_all(int fd, char *buf, int len)
+{
+	int ret;
+
+	while (len) {
+		ret = recv(fd, buf, len, 0);
+		if (ret <= 0) {
+			if (ret == 0)
+				errno = ECONNRESET;
+			die("recv");
+		}
+		buf += ret;
+		len -= ret;
+	}
+}
+
+static void do_server(int fd)
+{
+	char buf[RESP_LEN];
+	int conn;
+
+	memset(buf, 's', sizeof(buf));
+	for (;;) {
+		conn = accept(fd, NULL, NULL);
+		if (conn < 0)
+			die("accept");
+		recv_all(conn, buf, REQ_LEN);
+		if (send(conn, buf, RESP_LEN, 0) != RESP_LEN)
+			die("send");
+		close(conn);
+	}
+}
+
+/* One request/response exchange on a new connection, in seconds */
+static double do_client(int fastopen)
+{
+	struct sockaddr_in addr;
+	char buf[RESP_LEN];
+	double start, elapsed;
+	int fd, ret;
+
+	setup_addr(&addr);
+	memset(buf, 'c', REQ_LEN);
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		die("socket");
+
+	start = now();
+	if (fastopen) {
+		ret = sendto(fd, buf, REQ_LEN, MSG_FASTOPEN,
+			     (void *)&addr, sizeof(addr));
+	} else {
+		if (connect(fd, (void *)&addr, sizeof(addr)))
+			die("connect");
+		ret = send(fd, buf, REQ_LEN, 0);
+	}
+	if (ret != REQ_LEN)
+		die(fastopen ? "sendto MSG_FASTOPEN" : "send");
+	recv_all(fd, buf, RESP_LEN);
+	elapsed = now() - start;
+
+	close(fd);
+	return elapsed;
+}
+
+/* Average over cfg_conns connections, in milliseconds */
+static double run(int fastopen)
+{
+	double total = 0;
+	int i;
+
+	/* the first Fast Open connection only fetches the cookie */
+	if (fastopen)
+		do_client(1);
+
+	for (i = 0; i < cfg_conns; i++)
+		total += do_client(fastopen);
+	return total * 1000 / cfg_conns;
+}
+
+static void parse_opts(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "n:p:r:")) != -1) {
+		switch (c) {
+		case 'n':
+			cfg_conns = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			cfg_port = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			cfg_rtt_ms = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n conns] [-p port] "
+				"[-r rtt_ms]\n", argv[0]);
+			exit(1);
+		}
+	}
+	if (cfg_conns <= 0) {
+		fprintf(stderr, "need at least one connection\n");
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in addr;
+	double plain, tfo;
+	int fd, one = 1, qlen = 16;
+	pid_t pid;
+
+	parse_opts(argc, argv);
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0)
+		die("socket");
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+		die("setsockopt SO_REUSEADDR");
+	if (setsockopt(fd, SOL_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen)))
+		die("setsockopt TCP_FASTOPEN");
+	setup_addr(&addr);
+	if (bind(fd, (void *)&addr, sizeof(addr)))
+		die("bind");
+	if (listen(fd, 64))
+		die("listen");
+
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid)
+		do_server(fd);
+	close(fd);
+
+	plain = run(0);
+	tfo = run(1);
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+
+	printf("plain:    %8.3f ms per request\n", plain);
+	printf("fastopen: %8.3f ms per request\n", tfo);
+	printf("saved:    %8.3f ms per request\n", plain - tfo);
+
+	if (cfg_rtt_ms && plain - tfo < cfg_rtt_ms / 2.0) {
+		fprintf(stderr, "FAIL: expected about %d ms saved\n",
+			cfg_rtt_ms);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,29 @@
+#!/bin/sh
+#
+# Run tcp_fastopen over a loopback with a 50 ms round trip time, in a
+# network namespace of its own so the delay does not leak into the host.
+# Fast Open should save one RTT on every request/response exchange.
+
+NS=tfo-test
+DELAY_MS=25
+
+if [ "$(id -u)" != 0 ]; then
+	echo "$0: must be run as root" >&2
+	exit 1
+fi
+
+old=$(cat /proc/sys/net/ipv4/tcp_fastopen)
+cleanup() {
+	echo "$old" > /proc/sys/net/ipv4/tcp_fastopen
+	ip netns del $NS 2>/dev/null
+}
+trap cleanup EXIT
+
+# client and server
+echo 3 > /proc/sys/net/ipv4/tcp_fastopen
+
+ip netns add $NS || exit 1
+ip netns exec $NS ip link set lo up || exit 1
+ip netns exec $NS tc qdisc add dev lo root netem delay ${DELAY_MS}ms || exit 1
+
+ip netns exec $NS ./tcp_fastopen -r $((2 * DELAY_MS)) "$@"
@@ -0,0 +1,251 @@
+/*
+ * Loopback UDP throughput, with and without UDP_SEGMENT and UDP_GRO.
+ *
+ * Forks a receiver bound to 127.0.0.1 and sends fixed size datagrams to
+ * it for a few seconds, then reports system calls, datagrams and bytes per
+ * second on both sides:
+ *
+ *	udpgso_bench [-s segsize] [-l secs] [-p port]		one datagram per call
+ *	udpgso_bench -g [-n segs] ...				UDP_SEGMENT sends
+ *	udpgso_bench -g -G ...					... and UDP_GRO receives
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP		17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT	103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO		104
+#endif
+
+#define UDP_MAX_SEGMENTS	64
+
+static int cfg_gso;
+static int cfg_gro;
+static int cfg_segsize = 1200;
+static int cfg_segs = 50;
+static int cfg_secs = 3;
+static int cfg_port = 8000;
+
+static void die(const char *what)
+{
+	perror(what);
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill_addr(struct sockaddr_in *sin)
+{
+	memset(sin, 0, sizeof(*sin));
+	sin->sin_family = AF_INET;
+	sin->sin_port = htons(cfg_port);
+	sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+/* segment size of a coalesced packet, 0 for a plain datagram */
+static int gro_size(struct msghdr *msg)
+{
+	struct cmsghdr *cm;
+
+	for (cm = CMSG_FIRSTHDR(msg); cm; cm = CMSG_NXTHDR(msg, cm))
+		if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+			return *(int *)CMSG_DATA(cm);
+	return 0;
+}
+
+static void do_receiver(int fd)
+{
+	unsigned long calls = 0, dgrams = 0;
+	unsigned long long bytes = 0;
+	char control[CMSG_SPACE(sizeof(int))];
+	double start = 0, last = 0;
+	static char buf[1 << 16];
+	struct msghdr msg;
+	struct iovec iov;
+	int ret, size;
+
+	for (;;) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		/* udp has no end of stream: stop after a second of silence */
+		if (poll(&pfd, 1, calls ? 1000 : 5000) != 1)
+			break;
+
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		ret = recvmsg(fd, &msg, 0);
+		if (ret < 0)
+			die("recvmsg");
+		if (!calls)
+			start = now();
+		last = now();
+
+		calls++;
+		bytes += ret;
+		size = gro_size(&msg);
+		dgrams += size ? (ret + size - 1) / size : 1;
+	}
+
+	if (last > start)
+		printf("rx: %8.0f calls/s %8.0f datagrams/s %8.1f MB/s\n",
+		       calls / (last - start), dgrams / (last - start),
+		       bytes / (last - start) / 1e6);
+	else
+		printf("rx: nothing received\n");
+}
+
+static void do_sender(int fd)
+{
+	unsigned long calls = 0, dgrams = 0;
+	unsigned long long bytes = 0;
+	struct sockaddr_in sin;
+	double start, end;
+	int len, ret;
+	char *buf;
+
+	len = cfg_gso ? cfg_segsize * cfg_segs : cfg_segsize;
+	buf = malloc(len);
+	if (!buf)
+		die("malloc");
+	memset(buf, 'a', len);
+
+	if (cfg_gso && setsockopt(fd, SOL_UDP, UDP_SEGMENT, &cfg_segsize,
+				  sizeof(cfg_segsize)))
+		die("setsockopt UDP_SEGMENT");
+
+	fill_addr(&sin);
+	if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)))
+		die("connect");
+
+	start = now();
+	end = start + cfg_secs;
+	while (now() < end) {
+		ret = send(fd, buf, len, 0);
+		if (ret < 0) {
+			/* receiver queue overflowed, or not up yet */
+			if (errno == ECONNREFUSED || errno == ENOBUFS)
+				continue;
+			die("send");
+		}
+		calls++;
+		bytes += ret;
+		dgrams += cfg_gso ? (ret + cfg_segsize - 1) / cfg_segsize : 1;
+	}
+	end = now() - start;
+
+	printf("tx: %8.0f calls/s %8.0f datagrams/s %8.1f MB/s\n",
+	       calls / end, dgrams / end, bytes / end / 1e6);
+	free(buf);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-g] [-G] [-s segsize] [-n segs] "
+		"[-l secs] [-p port]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct sockaddr_in sin;
+	int c, rfd, tfd, one = 1, rcvbuf = 1 << 22;
+	pid_t pid;
+
+	while ((c = getopt(argc, argv, "gGs:n:l:p:")) != -1) {
+		switch (c) {
+		case 'g':
+			cfg_gso = 1;
+			break;
+		case 'G':
+			cfg_gro = 1;
+			break;
+		case 's':
+			cfg_segsize = atoi(optarg);
+			break;
+		case 'n':
+			cfg_segs = atoi(optarg);
+			break;
+		case 'l':
+			cfg_secs = atoi(optarg);
+			break;
+		case 'p':
+			cfg_port = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (cfg_segsize <= 0 || cfg_segs <= 0 || cfg_segs > UDP_MAX_SEGMENTS ||
+	    cfg_segsize * cfg_segs > 0xFFFF - 28)
+		usage(argv[0]);
+
+	rfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (rfd < 0)
+		die("socket");
+	if (setsockopt(rfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)))
+		die("setsockopt SO_REUSEADDR");
+	if (setsockopt(rfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)))
+		die("setsockopt SO_RCVBUF");
+	if (cfg_gro && setsockopt(rfd, SOL_UDP, UDP_GRO, &one, sizeof(one)))
+		die("setsockopt UDP_GRO");
+	fill_addr(&sin);
+	if (bind(rfd, (struct sockaddr *)&sin, sizeof(sin)))
+		die("bind");
+
+	fflush(stdout);
+	pid = fork();
+	if (pid < 0)
+		die("fork");
+	if (!pid) {
+		do_receiver(rfd);
+		exit(0);
+	}
+	close(rfd);
+
+	tfd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (tfd < 0)
+		die("socket");
+	do_sender(tfd);
+	close(tfd);
+
+	fflush(stdout);
+	if (waitpid(pid, NULL, 0) < 0)
+		die("waitpid");
+	return 0;
+}
@@ -0,0 +1,117 @@
+#!/bin/sh
+#
+# Parallel read throughput of a loop-mounted squashfs image.
+#
+#	parallel_read.sh [-j max_readers] [-s file_mb] [-c comp] [-b block_size]
+#
+# Builds an image holding one file per reader, loop-mounts it, and reads
+# the files with 1, 2, 4, ... up to max_readers processes at once, each
+# process reading a file of its own.  The page cache is dropped before
+# every run, so all data goes through the decompressors.  Reports the
+# aggregate throughput and the speedup over a single reader.
+#
+# With CONFIG_SQUASHFS_DECOMP_SINGLE the readers take turns on one
+# decompressor and the throughput stays flat; DECOMP_MULTI and
+# DECOMP_MULTI_PERCPU should scale with the number of CPUs.  The mode is
+# chosen at build time, so compare kernels built with each of them.
+#
+# Needs root, mksquashfs and loop device support.
+
+readers=$(grep -c ^processor /proc/cpuinfo)
+file_mb=64
+comp=gzip
+block_size=131072
+
+usage() {
+	echo "usage: $0 [-j max_readers] [-s file_mb] [-c comp] [-b block_size]" >&2
+	exit 1
+}
+
+while getopts "j:s:c:b:" opt; do
+	case $opt in
+	j) readers=$OPTARG ;;
+	s) file_mb=$OPTARG ;;
+	c) comp=$OPTARG ;;
+	b) block_size=$OPTARG ;;
+	*) usage ;;
+	esac
+done
+
+if [ "$(id -u)" != 0 ]; then
+	echo "$0: must be run as root" >&2
+	exit 1
+fi
+if ! which mksquashfs >/dev/null 2>&1; then
+	echo "$0: mksquashfs not found" >&2
+	exit 1
+fi
+
+dir=$(mktemp -d) || exit 1
+cleanup() {
+	umount $dir/mnt 2>/dev/null
+	rm -rf $dir
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+mkdir $dir/src $dir/mnt || exit 1
+
+# base64 of random data compresses to about 3/4, so every block
+# costs real decompression work
+i=1
+while [ $i -le $readers ]; do
+	head -c $((file_mb * 1024 * 3 / 4))k /dev/urandom | base64 \
+		> $dir/src/file$i || exit 1
+	i=$((i + 1))
+done
+
+mksquashfs $dir/src $dir/image -comp $comp -b $block_size \
+	-noappend -no-progress >/dev/null || exit 1
+mount -t squashfs -o loop,ro $dir/image $dir/mnt || exit 1
+
+config=/proc/config.gz
+if [ -r $config ]; then
+	mode=$(zcat $config | grep -E '^CONFIG_SQUASHFS_(DECOMP|FILE)_[A-Z_]*=y')
+elif [ -r /boot/config-$(uname -r) ]; then
+	mode=$(grep -E '^CONFIG_SQUASHFS_(DECOMP|FILE)_[A-Z_]*=y' \
+		/boot/config-$(uname -r))
+fi
+echo "kernel $(uname -r), $(echo ${mode:-squashfs mode unknown} | \
+	sed 's/CONFIG_SQUASHFS_//g; s/=y//g')"
+echo "image: $readers files of $(du -m $dir/src/file1 | cut -f1) MB," \
+	"$comp, $block_size byte blocks"
+
+# /proc/uptime rather than date +%N, which busybox may not have
+now() {
+	cut -d' ' -f1 /proc/uptime
+}
+
+base=
+j=1
+while [ $j -le $readers ]; do
+	sync
+	echo 3 > /proc/sys/vm/drop_caches
+
+	start=$(now)
+	i=1
+	while [ $i -le $j ]; do
+		cat $dir/mnt/file$i > /dev/null &
+		i=$((i + 1))
+	done
+	wait
+	end=$(now)
+
+	mb=$(du -cm $(i=1; while [ $i -le $j ]; do
+		echo $dir/src/file$i; i=$((i + 1)); done) | tail -1 | cut -f1)
+	rate=$(awk "BEGIN { t = $end - $start; if (t < 0.01) t = 0.01;
+			    printf \"%.1f\", $mb / t }")
+	[ -z "$base" ] && base=$rate
+	printf "%3d readers: %8s MB/s  x%s\n" $j $rate \
+		$(awk "BEGIN { printf \"%.2f\", $rate / $base }")
+
+	if [ $j -lt $readers ] && [ $((j * 2)) -gt $readers ]; then
+		j=$readers
+	else
+		j=$((j * 2))
+	fi
+done